@@ -36,6 +36,7 @@ namespace QDP
     llvm::Value* r_hi           = llvm_derefParam( p_hi );
     llvm::Value* r_inputnum     = llvm_derefParam( p_inputnum );
 
+    llvm_set_block_reduce();
     llvm::Value* r_shared = llvm_get_shared_ptr( llvm_type<T2WT>::value );
 
     typedef typename JITType<T2>::Type_t T2JIT;
@@ -44,7 +45,6 @@ namespace QDP
 
     llvm::Value* r_block_idx  = llvm_call_special_ctaidx();
     llvm::Value* r_tidx       = llvm_call_special_tidx();
-    llvm::Value* r_ntidx       = llvm_call_special_ntidx(); // needed later
 
     IndexDomainVector args;
     args.push_back( make_pair( Layout::sitesOnNode() , r_tidx ) );  // sitesOnNode irrelevant since Scalar access later
@@ -80,106 +80,12 @@ namespace QDP
 
       sdata_jit = reg_idata_elem; // This should do the precision conversion (SP->DP)
 
-      llvm_bar_sync();
+      jit_block_reduce<T2>( sdata_jit , r_shared ,
+			    [&]() -> T2JIT& { return odata.elem( JitDeviceLayout::Scalar , r_block_idx , r_input ); } ,
+			    JitBlockSum() );
 
-      //llvm::Value* val_ntid = llvm_call_special_ntidx();
-
-      //
-      // Find next power of 2 loop
-      //
-      llvm::BasicBlock * block_power_loop_start = llvm_new_basic_block();
-      llvm::BasicBlock * block_power_loop_inc = llvm_new_basic_block();
-      llvm::BasicBlock * block_power_loop_exit = llvm_new_basic_block();
-      llvm::Value* r_pow_phi;
-
-      llvm_branch( block_power_loop_start );
-
-      llvm_set_insert_point( block_power_loop_start );
-
-      llvm::PHINode * r_pow = llvm_phi( llvm_type<int>::value , 2 );
-      r_pow->addIncoming( llvm_create_value(1) , block_input_loop_inc );   // entry_block, block_input_loop_exit
-
-      llvm_cond_branch( llvm_ge( r_pow , r_ntidx ) , block_power_loop_exit , block_power_loop_inc );
-      {
-	llvm_set_insert_point(block_power_loop_inc);
-	r_pow_phi = llvm_shl( r_pow , llvm_create_value(1) );
-	r_pow->addIncoming( r_pow_phi , block_power_loop_inc );
-	llvm_branch( block_power_loop_start );
-      }
-
-      llvm_set_insert_point(block_power_loop_exit);
-
-      llvm::Value* r_pow_shr1 = llvm_shr( r_pow , llvm_create_value(1) );
-
-      //
-      // Shared memory reduction loop
-      //
-      llvm::BasicBlock * block_red_loop_start = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_start_1 = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_start_2 = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_add = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_sync = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_end = llvm_new_basic_block();
-
-      llvm_branch( block_red_loop_start );
-      llvm_set_insert_point(block_red_loop_start);
-    
-      llvm::PHINode * r_red_pow = llvm_phi( llvm_type<int>::value , 2 );    
-      r_red_pow->addIncoming( r_pow_shr1 , block_power_loop_exit );
-      llvm_cond_branch( llvm_le( r_red_pow , llvm_create_value(0) ) , block_red_loop_end , block_red_loop_start_1 );
-
-      llvm_set_insert_point(block_red_loop_start_1);
-
-      llvm_cond_branch( llvm_ge( r_tidx , r_red_pow ) , block_red_loop_sync , block_red_loop_start_2 );
-
-      llvm_set_insert_point(block_red_loop_start_2);
-
-      llvm::Value * v = llvm_add( r_red_pow , r_tidx );
-      llvm_cond_branch( llvm_ge( v , r_ntidx ) , block_red_loop_sync , block_red_loop_add );
-
-      llvm_set_insert_point(block_red_loop_add);
-
-
-      IndexDomainVector args_new;
-      args_new.push_back( make_pair( Layout::sitesOnNode() , 
-				     llvm_add( r_tidx , r_red_pow ) ) );  // sitesOnNode irrelevant since Scalar access later
-
-      typename JITType<T2>::Type_t sdata_jit_plus;
-      sdata_jit_plus.setup( r_shared , JitDeviceLayout::Scalar , args_new );
-
-      typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg_plus;    // 
-      sdata_reg_plus.setup( sdata_jit_plus );
-
-      sdata_jit += sdata_reg_plus;
-
-
-      llvm_branch( block_red_loop_sync );
-
-      llvm_set_insert_point(block_red_loop_sync);
-      llvm_bar_sync();
-      llvm::Value* pow_1 = llvm_shr( r_red_pow , llvm_create_value(1) );
-      r_red_pow->addIncoming( pow_1 , block_red_loop_sync );
-
-      llvm_branch( block_red_loop_start );
-
-      llvm_set_insert_point(block_red_loop_end);
-
-
-      llvm::BasicBlock * block_store_global = llvm_new_basic_block();
-      llvm::BasicBlock * block_not_store_global = llvm_new_basic_block();
-      llvm_cond_branch( llvm_eq( r_tidx , llvm_create_value(0) ) , 
-			block_store_global , 
-			block_not_store_global );
-      llvm_set_insert_point(block_store_global);
-      typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg;   // this is stupid
-      sdata_reg.setup( sdata_jit );
-      odata.elem( JitDeviceLayout::Scalar , r_block_idx , r_input ) = sdata_reg;
-
-      llvm_branch( block_not_store_global );
-      llvm_set_insert_point(block_not_store_global);
-      
       r_input_inc = llvm_add( r_input , llvm_create_value(1) );
-      r_input->addIncoming( r_input_inc , block_not_store_global );  // block_input_loop_inc
+      r_input->addIncoming( r_input_inc , llvm_get_insert_block() );
     
       llvm_branch( block_input_loop_start );
     }
@@ -204,23 +110,17 @@ namespace QDP
     int lo = 0;
     int hi = size;
     
-    JitParam jit_lo( QDP_get_global_cache().addJitParamInt( lo ) );
-    JitParam jit_hi( QDP_get_global_cache().addJitParamInt( hi ) );
-    JitParam jit_inputnum( QDP_get_global_cache().addJitParamInt( (int)N ) );
     JitParam jit_in_ids( QDP_get_global_cache().addMulti( in_ids ) );
     JitParam jit_out_ids( QDP_get_global_cache().addMulti( out_ids ) );
   
-    std::vector<int> ids;
-    ids.push_back( jit_lo.get_id() );
-    ids.push_back( jit_hi.get_id() );
-    ids.push_back( jit_inputnum.get_id() );
-    ids.push_back( jit_in_ids.get_id() );
-    ids.push_back( jit_out_ids.get_id() );
+    QDPJitArgs args;
+    args.addInt( lo );
+    args.addInt( hi );
+    args.addInt( (int)N );
+    args.addId( jit_in_ids.get_id() );
+    args.addId( jit_out_ids.get_id() );
  
-    std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
-    kernel_geom_t now = getGeom( hi-lo , threads );
-
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &args[0] , 0);
+    jit_launch_explicit( function , hi-lo , threads , shared_mem_usage , args );
   }			  
     
 
@@ -238,7 +138,7 @@ namespace QDP
     if (function == NULL)
       {
 	//std::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-	function = function_multi_sum_convert_build<T1,T2,input_layout>();
+	function = jit_loaded_function( function_multi_sum_convert_build<T1,T2,input_layout>() );
 	//std::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
       }
     else
@@ -267,25 +167,19 @@ namespace QDP
     int lo = 0;
     int hi = size;
     
-    JitParam jit_lo( QDP_get_global_cache().addJitParamInt( lo ) );
-    JitParam jit_hi( QDP_get_global_cache().addJitParamInt( hi ) );
-    JitParam jit_inputnum( QDP_get_global_cache().addJitParamInt( (int)N ) );
     JitParam jit_in_ids( QDP_get_global_cache().addMulti( in_ids ) );
     JitParam jit_out_ids( QDP_get_global_cache().addMulti( out_ids ) );
   
-    std::vector<int> ids;
-    ids.push_back( jit_lo.get_id() );
-    ids.push_back( jit_hi.get_id() );
-    ids.push_back( jit_inputnum.get_id() );
-    ids.push_back( jit_in_ids.get_id() );
-    ids.push_back( jit_out_ids.get_id() );
-    ids.push_back( v_id );
-    ids.push_back( s.getIdSiteTable() );
+    QDPJitArgs args;
+    args.addInt( lo );
+    args.addInt( hi );
+    args.addInt( (int)N );
+    args.addId( jit_in_ids.get_id() );
+    args.addId( jit_out_ids.get_id() );
+    args.addId( v_id );
+    args.addId( s.getIdSiteTable() );
  
-    std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
-    kernel_geom_t now = getGeom( hi-lo , threads );
-
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &args[0] , 0);
+    jit_launch_explicit( function , hi-lo , threads , shared_mem_usage , args );
   }
 
 
@@ -327,6 +221,7 @@ namespace QDP
     llvm::Value* r_hi           = llvm_derefParam( p_hi );
     llvm::Value* r_inputnum     = llvm_derefParam( p_inputnum );
 
+    llvm_set_block_reduce();
     llvm::Value* r_shared = llvm_get_shared_ptr( llvm_type<T2WT>::value );
 
     typedef typename JITType<T2>::Type_t T2JIT;
@@ -336,7 +231,6 @@ namespace QDP
 
     llvm::Value* r_block_idx  = llvm_call_special_ctaidx();
     llvm::Value* r_tidx       = llvm_call_special_tidx();
-    llvm::Value* r_ntidx       = llvm_call_special_ntidx(); // needed later
 
     IndexDomainVector args;
     args.push_back( make_pair( Layout::sitesOnNode() , r_tidx ) );  // sitesOnNode irrelevant since Scalar access later
@@ -379,107 +273,12 @@ namespace QDP
 
       sdata_jit = op_jit( reg_idata_elem , reg_vdata_elem ); // This should do the precision conversion (SP->DP)
 
-      llvm_bar_sync();
+      jit_block_reduce<T2>( sdata_jit , r_shared ,
+			    [&]() -> T2JIT& { return odata.elem( JitDeviceLayout::Scalar , r_block_idx , r_input ); } ,
+			    JitBlockSum() );
 
-
-      //llvm::Value* val_ntid = llvm_call_special_ntidx();
-
-      //
-      // Find next power of 2 loop
-      //
-      llvm::BasicBlock * block_power_loop_start = llvm_new_basic_block();
-      llvm::BasicBlock * block_power_loop_inc = llvm_new_basic_block();
-      llvm::BasicBlock * block_power_loop_exit = llvm_new_basic_block();
-      llvm::Value* r_pow_phi;
-
-      llvm_branch( block_power_loop_start );
-
-      llvm_set_insert_point( block_power_loop_start );
-
-      llvm::PHINode * r_pow = llvm_phi( llvm_type<int>::value , 2 );
-      r_pow->addIncoming( llvm_create_value(1) , block_input_loop_inc );   // entry_block, block_input_loop_exit
-
-      llvm_cond_branch( llvm_ge( r_pow , r_ntidx ) , block_power_loop_exit , block_power_loop_inc );
-      {
-	llvm_set_insert_point(block_power_loop_inc);
-	r_pow_phi = llvm_shl( r_pow , llvm_create_value(1) );
-	r_pow->addIncoming( r_pow_phi , block_power_loop_inc );
-	llvm_branch( block_power_loop_start );
-      }
-
-      llvm_set_insert_point(block_power_loop_exit);
-
-      llvm::Value* r_pow_shr1 = llvm_shr( r_pow , llvm_create_value(1) );
-
-      //
-      // Shared memory reduction loop
-      //
-      llvm::BasicBlock * block_red_loop_start = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_start_1 = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_start_2 = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_add = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_sync = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_end = llvm_new_basic_block();
-
-      llvm_branch( block_red_loop_start );
-      llvm_set_insert_point(block_red_loop_start);
-    
-      llvm::PHINode * r_red_pow = llvm_phi( llvm_type<int>::value , 2 );    
-      r_red_pow->addIncoming( r_pow_shr1 , block_power_loop_exit );
-      llvm_cond_branch( llvm_le( r_red_pow , llvm_create_value(0) ) , block_red_loop_end , block_red_loop_start_1 );
-
-      llvm_set_insert_point(block_red_loop_start_1);
-
-      llvm_cond_branch( llvm_ge( r_tidx , r_red_pow ) , block_red_loop_sync , block_red_loop_start_2 );
-
-      llvm_set_insert_point(block_red_loop_start_2);
-
-      llvm::Value * v = llvm_add( r_red_pow , r_tidx );
-      llvm_cond_branch( llvm_ge( v , r_ntidx ) , block_red_loop_sync , block_red_loop_add );
-
-      llvm_set_insert_point(block_red_loop_add);
-
-
-      IndexDomainVector args_new;
-      args_new.push_back( make_pair( Layout::sitesOnNode() , 
-				     llvm_add( r_tidx , r_red_pow ) ) );  // sitesOnNode irrelevant since Scalar access later
-
-      typename JITType<T2>::Type_t sdata_jit_plus;
-      sdata_jit_plus.setup( r_shared , JitDeviceLayout::Scalar , args_new );
-
-      typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg_plus;    // 
-      sdata_reg_plus.setup( sdata_jit_plus );
-
-      sdata_jit += sdata_reg_plus;
-
-
-      llvm_branch( block_red_loop_sync );
-
-      llvm_set_insert_point(block_red_loop_sync);
-      llvm_bar_sync();
-      llvm::Value* pow_1 = llvm_shr( r_red_pow , llvm_create_value(1) );
-      r_red_pow->addIncoming( pow_1 , block_red_loop_sync );
-
-      llvm_branch( block_red_loop_start );
-
-      llvm_set_insert_point(block_red_loop_end);
-
-
-      llvm::BasicBlock * block_store_global = llvm_new_basic_block();
-      llvm::BasicBlock * block_not_store_global = llvm_new_basic_block();
-      llvm_cond_branch( llvm_eq( r_tidx , llvm_create_value(0) ) , 
-			block_store_global , 
-			block_not_store_global );
-      llvm_set_insert_point(block_store_global);
-      typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg;   // this is stupid
-      sdata_reg.setup( sdata_jit );
-      odata.elem( JitDeviceLayout::Scalar , r_block_idx , r_input ) = sdata_reg;
-
-      llvm_branch( block_not_store_global );
-      llvm_set_insert_point(block_not_store_global);
-      
       r_input_inc = llvm_add( r_input , llvm_create_value(1) );
-      r_input->addIncoming( r_input_inc , block_not_store_global );  // block_input_loop_inc
+      r_input->addIncoming( r_input_inc , llvm_get_insert_block() );
     
       llvm_branch( block_input_loop_start );
     }
@@ -511,7 +310,7 @@ namespace QDP
     if (function == NULL)
       {
 	//std::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-	function = function_multi_localInnerProduct_sum_convert_build<T1,T2,T3,input_layout>();
+	function = jit_loaded_function( function_multi_localInnerProduct_sum_convert_build<T1,T2,T3,input_layout>() );
 	//std::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
       }
     else
@@ -97,6 +97,7 @@ using std::ostream;
 
 #include "cuda.h"
 #include "qdp_llvm.h"
+#include "qdp_jit_pool.h"
 
 
 #include "qdp_forward.h"
@@ -217,6 +218,8 @@ namespace QDP {
 #include "qdp_jitf_summulti.h"
 #include "qdp_jitf_globalmax.h"
 #include "qdp_jitf_gaussian.h"
+#include "qdp_jitf_fuse.h"
+#include "qdp_jitf_sumbatch.h"
 
 // Include threading code here if applicable
 #include "qdp_dispatch.h"
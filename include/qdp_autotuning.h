@@ -3,7 +3,74 @@
 
 namespace QDP {
 
+  //
+  // Launch configuration explored by the autotuner
+  //
+  struct launch_cfg_t {
+    launch_cfg_t(): block(0), spt(1), square(false), cache(CU_FUNC_CACHE_PREFER_NONE) {}
+    int  block;    // threads per block
+    int  spt;      // sites per thread
+    bool square;   // 2D grid with about as many blocks in y as in x
+    int  cache;    // L1/shared memory preference (CUfunc_cache)
+  };
+
+  // Which parts of the configuration a kernel allows to vary
+  struct tune_space_t {
+    int  max_block;
+    bool vary_block;
+    bool vary_spt;
+    bool vary_shape;
+    bool vary_cache;
+  };
+
+
+  //
+  // Search strategy of the autotuner. One instance per kernel.
+  //
+  // The tuner launches the configuration returned by first() and
+  // reports the time of each trial to next() (negative if the
+  // configuration could not be launched) which returns the next
+  // configuration to try, or false if the search is finished. The
+  // tuner keeps the fastest configuration and stops the search early
+  // once the time budget is used up.
+  //
+  class TuneStrategy {
+  public:
+    virtual ~TuneStrategy() {}
+    virtual launch_cfg_t first() = 0;
+    virtual bool next( double time , launch_cfg_t& cfg ) = 0;
+  };
+
+  TuneStrategy* jit_tune_create_strategy( const tune_space_t& space );
+
+  void jit_tune_set_strategy( const char * c_str );
+  void jit_tune_set_budget( int ms );
+
+
   void jit_launch(CUfunction function,int th_count,std::vector<int>& ids);
+  void jit_launch(CUfunction function,int th_count,QDPJitArgs& args);
+
+  // Launch of a kernel with a given block size (the reductions). Only
+  // the L1/shared memory preference is tuned.
+  void jit_launch_explicit( CUfunction function , int th_count , int threads , int shared_mem_usage , QDPJitArgs& args );
+
+  // Host target: The threads of a block run one after the other in
+  // order of the thread index on one host thread. Kernels get this as
+  // their last argument (see llvm_special).
+  struct jit_host_block_t {
+    void* shared;   // shared memory of the block
+    int   ntid;     // threads per block
+    int   nctaid;   // number of blocks
+  };
+
+  void jit_launch_host_block( CUfunction function , int blocks , int threads , int shared_mem_usage , void** args );
+
+  // Persistent autotuning results
+  void        jit_tune_set_db( const char * c_str );
+  bool        jit_tune_db_enabled();
+  std::string jit_tune_db_fname();
+  int         jit_tune_db_size();
+  int         jit_tune_db_hits();
 
   //int jit_autotuning(CUfunction function,int lo,int hi,void ** param);
 
@@ -6,6 +6,13 @@
 #include <vector>
 #include <stack>
 #include <list>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <cstring>
 //#include "string.h"
 //#include "math.h"
 
@@ -17,13 +24,150 @@ namespace QDP
 {
   template<class T> class multi1d;
 
-  class QDPJitArgs;
+  struct QDPCacheLocalIds;
+
+
+  //
+  // Labels the cache entries this thread adds while the object lives.
+  // The memory report groups live and peak bytes by label. The label
+  // must be a string that outlives the cache, e.g. a literal.
+  //
+  class QDPCacheSite
+  {
+  public:
+    explicit QDPCacheSite( const char* label );
+    ~QDPCacheSite();
+  private:
+    const char* prev;
+  };
+
+
+  //
+  // Kernel arguments built on the stack. Cache ids are resolved to
+  // device pointers by QDPCache::get_kernel_args, scalars are passed by
+  // value and never enter the cache. Heap memory is used only beyond
+  // max_inline arguments.
+  //
+  // The library kernels (reductions, gather, ..) take at most 7
+  // arguments. An expression kernel takes 5 for the subset, 1 for the
+  // destination and the address ids of the expression, 3 per shifted
+  // leaf. The largest expected expression, a 4D Wilson hopping term with
+  // 8 shifts and 8 links, needs 6 + 8*3 + 8 = 38. The memory report
+  // shows the most arguments seen and how often the heap was used.
+  //
+  class QDPJitArgs
+  {
+  public:
+    enum { max_inline = 40 };
+
+    QDPJitArgs(): n(0), ptrs(inline_ptrs) {}
+    QDPJitArgs( const QDPJitArgs& ) = delete;
+    QDPJitArgs& operator=( const QDPJitArgs& ) = delete;
+
+    void addId( int id )         { slot_t& s = push( false ); s.id = id; }
+    void addInt( int i )         { push( true ).value.int_ = i; }
+    void addInt64( int64_t i )   { push( true ).value.int64_ = i; }
+    void addBool( bool b )       { push( true ).value.bool_ = b; }
+    void addFloat( float f )     { push( true ).value.float_ = f; }
+    void addDouble( double d )   { push( true ).value.double_ = d; }
+
+    template<class C>
+    void addIds( const C& ids )  { for ( auto i : ids ) addId( i ); }
+
+    int size() const { return n; }
+
+    // Kernel parameter pointers, valid after get_kernel_args. There is
+    // room for one more parameter after the last.
+    void** data() { return ptrs; }
+
+  private:
+    friend class QDPCache;
+
+    struct slot_t {
+      int  id;
+      bool scalar;
+      union { int int_; int64_t int64_; bool bool_; float float_; double double_; } value;
+    };
+
+    slot_t& push( bool scalar ) {
+      slot_t* s;
+      if ( n < max_inline && heap_slots.empty() ) {
+	s = &inline_slots[n];
+      } else {
+	if ( heap_slots.empty() )
+	  heap_slots.assign( inline_slots , inline_slots + n );
+	heap_slots.push_back( slot_t() );
+	s = &heap_slots.back();
+      }
+      ++n;
+      s->id = -1;
+      s->scalar = scalar;
+      return *s;
+    }
+
+    slot_t& slot( int i ) { return heap_slots.empty() ? inline_slots[i] : heap_slots[i]; }
+
+    int                  n;
+    slot_t               inline_slots[ max_inline ];
+    void*                inline_ptrs[ max_inline + 1 ];
+    std::vector<slot_t>  heap_slots;
+    std::vector<void*>   heap_ptrs;
+    void**               ptrs;
+  };
+
+
+
+  //
+  // Selects the entry to evict from device memory when an allocation
+  // does not fit. The cache passes the entries that may be evicted in
+  // LRU order (least recently used first) and the size of the
+  // allocation that failed.
+  //
+  class CacheEvictionPolicy
+  {
+  public:
+    struct candidate_t {
+      int           id;
+      size_t        size;
+      bool          clean;   // host copy is current, no copy back needed
+      unsigned long uses;    // number of recent kernel uses (aged)
+    };
+
+    CacheEvictionPolicy(): bytes_spilled(0), bytes_dropped(0), bytes_reuploaded(0), evictions(0) {}
+    virtual ~CacheEvictionPolicy() {}
+
+    virtual const char* name() const = 0;
+
+    // Returns the index of the candidate to evict
+    virtual size_t select( const std::vector<candidate_t>& cand , size_t needed ) = 0;
+
+    size_t bytes_spilled;     // copied back to the host
+    size_t bytes_dropped;     // evicted without copy back
+    size_t bytes_reuploaded;  // copied to the device again after eviction
+    size_t evictions;
+  };
+
+  // Policies: lru (default), size, clean, lfu
+  CacheEvictionPolicy* qdp_cache_create_policy( const std::string& name );
+
 
   namespace {
     typedef QDPPoolAllocator<QDPCUDAAllocator>     CUDADevicePoolAllocator;
   }
 
-    
+  //
+  // Thread safety. These may be called from several host threads at
+  // once, e.g. inside an OpenMP region:
+  //   add, registrate, registrateOwnHostMem, addJitParam*, addMulti,
+  //   signoff, getSize, and getHostPtr / assureOnHost of distinct
+  //   entries whose host copy is current.
+  // Each thread takes free ids in batches from the shared registry, the
+  // LRU tracker is sharded by id and the host memory comes from the
+  // thread-safe default allocator. Everything else (kernel arguments,
+  // eviction, compaction, prefetch, the scalar arena, addDeviceStatic,
+  // signoffViaPtr, the reports) belongs to the master thread and must not
+  // overlap a parallel region that adds or signs off entries.
+  //
   class QDPCache
   {
   public:
@@ -33,7 +177,8 @@ namespace QDP
       OwnDeviceMemory = 2,
       JitParam = 4,
       Static = 8,
-      Multi = 16
+      Multi = 16,
+      Scalar = 32    // device memory may come from the scalar arena
     };
 
     enum class Status { undef , host , device };
@@ -47,6 +192,11 @@ namespace QDP
     typedef void (* LayoutFptr)(bool toDev,void * outPtr,void * inPtr);
 
     std::vector<void*> get_kernel_args(std::vector<int>& ids , bool for_kernel = true );
+    void get_kernel_args( QDPJitArgs& args );
+
+    // Ids the next kernel only reads. get_kernel_args marks all other
+    // arguments dirty, and a clean entry is evicted without a copy back.
+    void setKernelReadOnly( const std::vector<int>& ids );
     
     int addJitParamFloat(float i);
     int addJitParamDouble(double i);
@@ -79,9 +229,81 @@ namespace QDP
     
     CUDADevicePoolAllocator& get_allocator() { return pool_allocator; }
 
+    // Starts the upload of the given entries. Only free device memory
+    // is used, nothing is evicted. The layout change and the copy on the
+    // transfer stream run on the prefetch thread, the upload is waited
+    // for when an entry is used.
+    void prefetch( const std::vector<int>& ids );
+    void prefetchShutdown();
+
+    // Prefetch the arguments of the kernel that followed the current
+    // kernel the last time it ran. Kernels are told apart by the handle
+    // given to setKernelHandle.
+    void setPrefetchLookahead( bool b ) { lookahead = b; }
+
+    // Compact the device pool before spilling when the free memory
+    // would suffice but is fragmented
+    void setPoolCompaction( bool b ) { pool_compact = b; }
+
+    // Scalar entries get their device memory from slabs that are
+    // bump allocated and reused generation by generation instead of
+    // from the pool one by one. Their uploads are batched per kernel.
+    void setScalarArena( bool b ) { scalar_arena = b; }
+
+    // Starts a new scalar generation. The slabs of the generation
+    // before the current one are reused, scalars still living there
+    // move back to the host. A generation also ends when it has used
+    // arena_generation_slabs slabs.
+    void newScalarGeneration();
+
+    // Host copies of entries of at least min_bytes are kept in memory
+    // mapped files in dir (e.g. on local NVMe) instead of host memory.
+    // The page cache holds the recently used part, the rest stays on
+    // the disk.
+    void setHostMmap( const std::string& dir , size_t min_bytes );
+
+    void setEvictionPolicy( const std::string& name );
+    CacheEvictionPolicy& getEvictionPolicy() { return *policy; }
+    void printEvictionStats();
+
+    // Memory telemetry. The kernel handle attributes the working set of
+    // the next get_kernel_args to a kernel, the look-ahead uses it too. With a telemetry file the
+    // per-kernel peaks and a time series of the device memory are
+    // recorded, the series is written at printMemoryReport as CSV or,
+    // for a name ending in .json, as JSON together with the tables.
+    void setKernelHandle( const void* function ) { telemetry_kernel = function; }
+    void setTelemetryFile( const std::string& fname );
+    void printMemoryReport();
+
   private:
     class Entry;
+    friend struct QDPCacheLocalIds;
+
+    // Entries live in chunks that never move, an id can be looked up
+    // while another thread adds a chunk
+    class EntryTable
+    {
+    public:
+      enum { chunk_bits = 10 , chunk_size = 1 << chunk_bits , max_chunks = 16384 };
+
+      EntryTable();
+      Entry& operator[]( int id );
+      size_t size() const;
+      void grow();
+
+    private:
+      std::atomic<Entry*>  chunks[ max_chunks ];
+      std::atomic<size_t>  count;
+    };
+
     void growStack();
+    void releaseId( int id );
+    void track( Entry& e );
+    void printLargestEntries( int count );
+    void recordTelemetry( size_t working_set );
+    void writeTelemetry();
+    void untrack( Entry& e );
+    bool poolAllocate( void** ptr , size_t size );
 
     void lockId(int id);
     int getNewId();
@@ -97,15 +319,140 @@ namespace QDP
     void assureHost(Entry& e);
     bool isOnDevice(int id);
     
-    bool spill_lru();
+    bool spill( size_t needed );
+    bool compact( size_t needed );
+    void prefetchWait();
+    void prefetchWorker();
+    void prepareKernelIds( const std::vector<int>& ids , bool for_kernel );
+
+    // Device pointer table of a multi-id, shared by all multi-ids with
+    // the same ids and uploaded only when a pointer changes. The table
+    // is freed when the last multi-id on the device lets go of it.
+    struct MultiTable {
+      void*              dev;
+      std::vector<void*> ptrs;
+      int                refs;   // multi-ids using the table
+    };
+    void assureMultiTable( Entry& e );
+    void releaseMultiTable( Entry& e );
+    void* prefetchStaging( size_t size );
+
+    enum { arena_slab_size = 65536 , arena_max_object = 4096 , arena_alignment = 16 , arena_generation_slabs = 16 };
+    struct ScalarSlab {
+      void*  dev;
+      char*  host;     // upload staging
+      size_t used;
+    };
+    bool arenaAllocate( Entry& e );
+    void arenaStage( Entry& e );
+    void arenaFlush();
+
+    void* hostMapAllocate( size_t size );
+    void  hostMapAdvise( Entry& e , int advice );
     void printTracker();
     
   private:
-    vector<Entry>       vecEntry;
-    stack<int>          stackFree;
-    list<int>           lstTracker;
+    EntryTable          vecEntry;
+    stack<int>          stackFree;   // guarded by mtxRegistry
+    std::mutex          mtxRegistry;
+    std::mutex          mtxPool;
+
+    // LRU tracker, sharded by id so that threads adding and signing off
+    // entries rarely meet on a lock. A shard is in order of last use,
+    // the stamps of the entries order the shards against each other.
+    enum { tracker_shards = 16 };
+    struct TrackerShard {
+      std::mutex mtx;
+      list<int>  lst;        // holds no JIT parameters
+    };
+    TrackerShard& shard( int id ) { return tracker[ id % tracker_shards ]; }
+    void touch( Entry& e );
+    void trackedIds( std::vector<int>& ids );   // least recently used first
+    TrackerShard        tracker[ tracker_shards ];
+    std::atomic<unsigned long> track_stamp;
     vector<int>         vecLocked;   // with duplicate entries
     CUDADevicePoolAllocator pool_allocator;
+    CacheEvictionPolicy* policy;
+    unsigned long       epoch;       // counts the kernel argument sets
+    bool                kernel_setup;
+    bool                pool_compact;
+    bool                lookahead;
+    vector<int>         vecPrefetched;      // uploads in flight
+    struct PrefetchJob {
+      LayoutFptr fptr;
+      void*      dev;
+      void*      hst;
+      void*      stage;
+      size_t     size;
+    };
+    std::thread         prefetchThread;
+    std::mutex          mtxPrefetch;
+    std::condition_variable cvPrefetch;
+    std::deque<PrefetchJob> prefetchJobs;   // guarded by mtxPrefetch
+    int                 prefetchBusy;       // jobs queued or running
+    bool                prefetchStop;
+    vector< std::pair<void*,size_t> > vecStagingFree;  // pinned staging buffers
+    vector< std::pair<void*,size_t> > vecStagingBusy;
+    size_t              bytes_prefetched;
+    const void*         lastKernel;
+    map< const void* , vector<int> > mapNextKernel;   // arguments of the next kernel
+    map< vector<int> , MultiTable > mapMultiTable;   // guarded by mtxMulti
+    std::mutex          mtxMulti;
+    vector<int>         vecAllIds;       // scratch space of get_kernel_args
+    vector<int>         vecKernelIds;
+    vector<void*>       vecMultiPtrs;
+    vector<int>         vecReadOnly; // read-only arguments of the next kernel
+    bool                scalar_arena;
+    vector<ScalarSlab>  arenaCurrent;    // slabs of the current generation, the last one is filled
+    vector<ScalarSlab>  arenaPrevious;
+    vector<ScalarSlab>  arenaSpare;
+    vector< std::pair<int,void*> > arenaIdsCurrent;   // allocations of a generation
+    vector< std::pair<int,void*> > arenaIdsPrevious;
+    size_t              arenaRunLo;      // staged uploads into the last slab
+    size_t              arenaRunHi;
+    unsigned long       arena_generations;
+    unsigned long       arena_uploads;   // batched uploads and the scalars in them
+    unsigned long       arena_staged;
+
+    struct cstr_less {
+      bool operator()( const char* a , const char* b ) const { return strcmp( a , b ) < 0; }
+    };
+    struct SiteStats {
+      std::atomic<size_t>        live;      // bytes of the live entries
+      std::atomic<size_t>        peak;
+      std::atomic<size_t>        largest;   // largest entry ever added
+      std::atomic<unsigned long> entries;   // added in total
+    };
+    SiteStats* siteStats( const char* site );
+    struct KernelStats {
+      size_t        peak;      // working set, bytes of all arguments
+      unsigned long launches;
+    };
+    struct Sample {
+      unsigned long kernel;    // epoch
+      size_t        resident;
+      size_t        spilled;
+      size_t        uploaded;
+      size_t        downloaded;
+      size_t        working_set;
+    };
+    map< const char* , SiteStats* , cstr_less > mapSite;   // guarded by mtxSite, never shrinks
+    std::mutex          mtxSite;
+    map< const void* , KernelStats > mapKernel;
+    vector<Sample>      vecSample;
+    unsigned long       sample_stride;    // kernels per sample, doubles when the series is full
+    std::string         telemetry_file;
+    const void*         telemetry_kernel;
+    size_t              bytes_uploaded;
+    size_t              bytes_downloaded;
+    unsigned long       uploads;
+    unsigned long       downloads;
+    std::string         host_mmap_dir;
+    size_t              host_mmap_min;
+    std::atomic<size_t> bytes_mapped;     // host copies in mapped files
+    std::atomic<size_t> bytes_mapped_peak;
+    int                 args_peak;       // most kernel arguments (QDPJitArgs)
+    unsigned long       args_heap;       // launches with more than QDPJitArgs::max_inline
   };
 
   QDPCache& QDP_get_global_cache();
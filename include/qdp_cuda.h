@@ -17,6 +17,7 @@ namespace QDP {
   //int CudaGetConfig(CUdevice_attribute what);
   int CudaGetConfig(int what);
   void CudaGetSM(int* maj,int* min);
+  std::string CudaGetDeviceName();
 
   void CudaLaunchKernel( CUfunction f, 
 			 unsigned int  gridDimX, unsigned int  gridDimY, unsigned int  gridDimZ, 
@@ -39,9 +40,11 @@ namespace QDP {
   void CudaSyncTransferStream();
   void CudaCreateStreams();
   void CudaRecordAndWaitEvent();
+  void CudaTransferWaitKernel();  // transfer stream waits for the kernels issued so far
   void * CudaGetKernelStream();
 
   void CudaSetDevice(int dev);
+  void CudaSetCurrentContext();   // for a host thread that issues CUDA calls
   void CudaGetDeviceCount(int * count);
   void CudaGetDeviceProps();
 
@@ -53,6 +56,7 @@ namespace QDP {
   void CudaMemcpyD2HAsync( void * dest , const void * src , size_t size );
   void CudaMemcpyH2D( void * dest , const void * src , size_t size );
   void CudaMemcpyD2H( void * dest , const void * src , size_t size );
+  void CudaMemcpyD2D( void * dest , const void * src , size_t size );
 
   bool CudaMalloc( void **mem , const size_t size );
   //  void CudaMallocHost( void **mem , size_t size );
@@ -24,6 +24,10 @@ namespace QDP
     static void free(const void *mem) {
       CudaFree( mem );
     }
+
+    static void copy( void* dest , const void* src , size_t n_bytes ) {
+      CudaMemcpyD2D( dest , src , n_bytes );
+    }
   };
 
 
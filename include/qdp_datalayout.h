@@ -13,6 +13,13 @@ namespace QDP {
   llvm::Value * datalayout( JitDeviceLayout lay , IndexDomainVector a );
   //llvm::Value * datalayout_stack(IndexDomainVector a);
 
+  // Host side conversion of lattice data between the host layout
+  // (site slowest, then spin, color, reality) and the coalesced device
+  // layout (reality slowest, then color, spin, site). word_size is the
+  // size of the word type in bytes.
+  void datalayout_transpose( bool toDev , void * out , const void * in , size_t word_size ,
+			     int lim_rea , int lim_col , int lim_spi , int sites );
+
 } // namespace QDP
 
 #endif
@@ -57,16 +57,32 @@ namespace QDP {
       GPUDirect = direct;
     };
 
+    //! Send the halos of double precision shifts in single precision
+    bool getHaloSingle() { return haloSingle; }
+    void setHaloSingle(bool single) {
+      QDP_info_primary("Setting single precision halos = %d",(int)single);
+      haloSingle = single;
+    };
+
+    //! Generate code for the host CPU instead of the GPU
+    bool getHostTarget() { return hostTarget; }
+    void setHostTarget(bool host) {
+      QDP_info_primary("Setting host target = %d",(int)host);
+      hostTarget = host;
+    };
+
     unsigned getMaxKernelArg() { return maxKernelArg; }
     unsigned getMajor() { return major; }
+    const std::string& getDeviceName() { return device_name; }
     unsigned getMinor() { return minor; }
 
     bool getAsyncTransfers() { return asyncTransfers; }
 
     void autoDetect();
+    void autoDetectHost();
 
   private:
-    DeviceParams(): boolNoReadSM(false), GPUDirect(false), syncDevice(false), maxKernelArg(512){}; // Private constructor
+    DeviceParams(): boolNoReadSM(false), GPUDirect(false), syncDevice(false), hostTarget(false), maxKernelArg(512){}; // Private constructor
     DeviceParams(const DeviceParams&);                                           // Prevent copy-construction
     DeviceParams& operator=(const DeviceParams&);
     size_t roundDown2pow(size_t x);
@@ -77,6 +93,8 @@ namespace QDP {
     std::string envvar;
     bool GPUDirect;
     bool syncDevice;
+    bool hostTarget;
+    bool haloSingle = false;
     bool asyncTransfers;
     bool unifiedAddressing;
     bool divRnd;
@@ -96,6 +114,8 @@ namespace QDP {
     unsigned major;
     unsigned minor;
 
+    std::string device_name;
+
   };
 
 
@@ -39,7 +39,7 @@ namespace QDP
     static CUfunction function;
 
     if (function == NULL)
-      function = function_localInnerProduct_subtype_type_build(ret, l , r );
+      function = jit_loaded_function( function_localInnerProduct_subtype_type_build(ret, l , r ) );
 
     function_localInnerProduct_subtype_type_exec(function, ret, l, r, l.subset() );
     
@@ -61,7 +61,7 @@ namespace QDP
     static CUfunction function;
 
     if (function == NULL)
-      function = function_localInnerProduct_type_subtype_build(ret, l , r );
+      function = jit_loaded_function( function_localInnerProduct_type_subtype_build(ret, l , r ) );
 
     function_localInnerProduct_type_subtype_exec(function, ret, l, r, r.subset() );
     
@@ -0,0 +1,73 @@
+// -*- C++ -*-
+
+#ifndef QDP_JIT_POOL_H
+#define QDP_JIT_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <vector>
+
+namespace QDP {
+
+  //
+  // Worker pool for LLVM optimization and PTX code generation
+  //
+  // Each worker owns its LLVMContext. Modules are handed over as
+  // bitcode so that nothing is shared with the global TheContext.
+  // Workers are started with the first submitted job.
+  //
+  class JitCompilePool {
+  public:
+    static JitCompilePool& Instance()
+    {
+      static JitCompilePool singleton;
+      return singleton;
+    }
+
+    void setThreads( int n );
+    int  getThreads() const { return threads; }
+
+    // Returns the PTX for the module given as bitcode. If db_id is
+    // given the caller holds the PTX DB lease for it, the worker appends
+    // the kernel and releases the lease as soon as it is compiled.
+    std::shared_future<std::string> submit( const std::string& bitcode , const std::string& db_id = "" );
+
+    void shutdown();
+
+  private:
+    JitCompilePool(): threads(0), stop(false) {}
+    ~JitCompilePool() { shutdown(); }
+    JitCompilePool(const JitCompilePool&);
+    JitCompilePool& operator=(const JitCompilePool&);
+
+    void worker();
+
+    typedef std::packaged_task< std::string( llvm::LLVMContext& ) > job_t;
+
+    int threads;
+    bool stop;
+    std::vector< std::thread > workers;
+    std::deque< job_t > jobs;
+    std::mutex mtx;
+    std::condition_variable cv;
+  };
+
+
+  // Kernels compiled in the background are represented by a
+  // placeholder CUfunction until they are needed. The CUDA module
+  // is loaded on the calling thread at that point.
+  CUfunction jit_pending_function( std::shared_future<std::string> ptx , const std::string& fname );
+  CUfunction jit_resolve_function( CUfunction f );
+
+  // Loads the kernel of a placeholder and frees the placeholder, f must
+  // not be used afterwards. Returns f if it is no placeholder. The
+  // callers of the build functions keep the result of this in their
+  // static CUfunction, so launches don't resolve anything.
+  CUfunction jit_loaded_function( CUfunction f );
+
+}
+
+#endif
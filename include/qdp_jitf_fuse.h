@@ -0,0 +1,305 @@
+#ifndef QDP_JITF_FUSE_H
+#define QDP_JITF_FUSE_H
+
+namespace QDP {
+
+  //
+  // Fused evaluation of several assignments over the same subset
+  //
+  //   jit_fuse( s , fuse_assign( a , b + c ) , fuse_assign( d , a * e ) );
+  //
+  // evaluates the statements in order in one kernel, site by site. This
+  // is an explicit call taking all statements at once, not a scope that
+  // collects the ordinary assignments issued inside it. The statements
+  // are recorded for the duration of the call, so temporaries in the
+  // expressions live long enough. Without shifts every statement
+  // reads and writes only the site at hand, so running them one after
+  // the other per site gives the same result as separate evaluations. A
+  // lattice written by one statement and read by a later one is then
+  // read back right after it was written instead of being streamed
+  // through device memory again.
+  //
+  // Statements containing a shift read other sites (and may need
+  // communication). If any statement has one, the statements are
+  // evaluated separately.
+  //
+
+
+  // Expression contains a shift
+  template<class T>
+  struct ExprHasMap { enum { value = false }; };
+
+  template<class A>
+  struct ExprHasMap< UnaryNode<FnMap, A> > { enum { value = true }; };
+
+  template<class Op, class A>
+  struct ExprHasMap< UnaryNode<Op, A> > { enum { value = ExprHasMap<A>::value }; };
+
+  template<class Op, class A, class B>
+  struct ExprHasMap< BinaryNode<Op, A, B> > { enum { value = ExprHasMap<A>::value || ExprHasMap<B>::value }; };
+
+  template<class Op, class A, class B, class C>
+  struct ExprHasMap< TrinaryNode<Op, A, B, C> > { enum { value = ExprHasMap<A>::value || ExprHasMap<B>::value || ExprHasMap<C>::value }; };
+
+
+  // Layout of the right hand side leaves
+  template<class C>
+  struct FuseLayout;
+
+  template<class T>
+  struct FuseLayout< OLattice<T> > { static JitDeviceLayout value() { return JitDeviceLayout::Coalesced; } };
+
+  template<class T>
+  struct FuseLayout< OScalar<T> > { static JitDeviceLayout value() { return JitDeviceLayout::Scalar; } };
+
+
+  //
+  // One recorded statement  dest op rhs
+  //
+  template<class T, class Op, class RHS, class C1>
+  struct FusedStmt
+  {
+    typedef QDPExpr<RHS,C1> Expr_t;
+
+    enum { has_map = ExprHasMap<RHS>::value };
+
+    FusedStmt( OLattice<T>& dest , const Op& op , const Expr_t& rhs ): dest(dest), op(op), rhs(rhs) {}
+
+    // Kernel side of the statement. The parameters are added in the
+    // same order as the addresses in addresses().
+    struct JIT
+    {
+      typedef typename LeafFunctor<OLattice<T>, ParamLeaf>::Type_t  Dest_t;
+      typedef typename AddOpParam<Op,ParamLeaf>::Type_t             Op_t;
+      typedef typename ForEach<Expr_t, ParamLeaf, TreeCombine>::Type_t View_t;
+
+      JIT( const FusedStmt& s , const ParamLeaf& p ):
+	dest_jit( forEach( s.dest , p , TreeCombine() ) ),
+	op_jit( AddOpParam<Op,ParamLeaf>::apply( s.op , p ) ),
+	rhs_view( forEach( s.rhs , p , TreeCombine() ) )
+      {}
+
+      void emit( llvm::Value* r_idx )
+      {
+	op_jit( dest_jit.elem( JitDeviceLayout::Coalesced , r_idx ),
+		forEach( rhs_view , ViewLeaf( FuseLayout<C1>::value() , r_idx ) , OpCombine() ) );
+      }
+
+      Dest_t dest_jit;
+      Op_t   op_jit;
+      View_t rhs_view;
+    };
+
+    void addresses( const AddressLeaf& a ) const
+    {
+      forEach( dest , a , NullCombine() );
+      AddOpAddress<Op,AddressLeaf>::apply( op , a );
+      forEach( rhs , a , NullCombine() );
+    }
+
+    void evaluate_single( const Subset& s ) const
+    {
+      evaluate( dest , op , rhs , s );
+    }
+
+    OLattice<T>& dest;
+    Op           op;
+    Expr_t       rhs;
+  };
+
+
+  template<class T, class Op, class RHS, class C1>
+  FusedStmt<T,Op,RHS,C1> fuse_stmt( OLattice<T>& dest , const Op& op , const QDPExpr<RHS,C1>& rhs )
+  {
+    return FusedStmt<T,Op,RHS,C1>( dest , op , rhs );
+  }
+
+  template<class T, class RHS, class C1>
+  FusedStmt<T,OpAssign,RHS,C1> fuse_assign( OLattice<T>& dest , const QDPExpr<RHS,C1>& rhs )
+  {
+    return fuse_stmt( dest , OpAssign() , rhs );
+  }
+
+  template<class T, class T1, class C1>
+  auto fuse_assign( OLattice<T>& dest , const QDPType<T1,C1>& rhs ) -> decltype( fuse_stmt( dest , OpAssign() , PETE_identity(rhs) ) )
+  {
+    return fuse_stmt( dest , OpAssign() , PETE_identity(rhs) );
+  }
+
+  template<class T, class RHS, class C1>
+  FusedStmt<T,OpAddAssign,RHS,C1> fuse_add_assign( OLattice<T>& dest , const QDPExpr<RHS,C1>& rhs )
+  {
+    return fuse_stmt( dest , OpAddAssign() , rhs );
+  }
+
+  template<class T, class T1, class C1>
+  auto fuse_add_assign( OLattice<T>& dest , const QDPType<T1,C1>& rhs ) -> decltype( fuse_stmt( dest , OpAddAssign() , PETE_identity(rhs) ) )
+  {
+    return fuse_stmt( dest , OpAddAssign() , PETE_identity(rhs) );
+  }
+
+  template<class T, class RHS, class C1>
+  FusedStmt<T,OpSubtractAssign,RHS,C1> fuse_sub_assign( OLattice<T>& dest , const QDPExpr<RHS,C1>& rhs )
+  {
+    return fuse_stmt( dest , OpSubtractAssign() , rhs );
+  }
+
+  template<class T, class T1, class C1>
+  auto fuse_sub_assign( OLattice<T>& dest , const QDPType<T1,C1>& rhs ) -> decltype( fuse_stmt( dest , OpSubtractAssign() , PETE_identity(rhs) ) )
+  {
+    return fuse_stmt( dest , OpSubtractAssign() , PETE_identity(rhs) );
+  }
+
+
+
+  template<class... S>
+  struct FuseHasMap { enum { value = false }; };
+
+  template<class S0, class... S>
+  struct FuseHasMap<S0,S...> { enum { value = S0::has_map || FuseHasMap<S...>::value }; };
+
+
+  // Kernel sides of all statements, built in statement order
+  template<class... S>
+  struct FusedJIT
+  {
+    FusedJIT( const ParamLeaf& p ) {}
+    void emit( llvm::Value* r_idx ) {}
+  };
+
+  template<class S0, class... S>
+  struct FusedJIT<S0,S...>
+  {
+    FusedJIT( const ParamLeaf& p , const S0& s0 , const S&... s ): head( s0 , p ), tail( p , s... ) {}
+
+    void emit( llvm::Value* r_idx )
+    {
+      head.emit( r_idx );
+      tail.emit( r_idx );
+    }
+
+    typename S0::JIT head;
+    FusedJIT<S...>   tail;
+  };
+
+
+  inline void fuse_addresses( const AddressLeaf& a , std::vector<size_t>& begin ) {}
+
+  template<class S0, class... S>
+  void fuse_addresses( const AddressLeaf& a , std::vector<size_t>& begin , const S0& s0 , const S&... s )
+  {
+    begin.push_back( a.ids.size() );
+    s0.addresses( a );
+    fuse_addresses( a , begin , s... );
+  }
+
+
+  inline void fuse_evaluate_single( const Subset& sub ) {}
+
+  template<class S0, class... S>
+  void fuse_evaluate_single( const Subset& sub , const S0& s0 , const S&... s )
+  {
+    s0.evaluate_single( sub );
+    fuse_evaluate_single( sub , s... );
+  }
+
+
+
+  template<class... S>
+  CUfunction
+  function_fused_build( const S&... stmts )
+  {
+    if (ptx_db::db_enabled) {
+      CUfunction func = llvm_ptx_db( __PRETTY_FUNCTION__ );
+      if (func)
+	return func;
+    }
+
+    std::vector<ParamRef> params = jit_function_preamble_param();
+
+    ParamLeaf param_leaf;
+
+    FusedJIT<S...> stmts_jit( param_leaf , stmts... );
+
+    llvm::Value * r_idx = jit_function_preamble_get_idx( params );
+
+    stmts_jit.emit( r_idx );
+
+    return jit_function_epilogue_get_cuf("jit_fused.ptx" , __PRETTY_FUNCTION__ );
+  }
+
+
+
+  template<class... S>
+  void
+  function_fused_exec( CUfunction function , const Subset& s , const S&... stmts )
+  {
+    AddressLeaf addr_leaf(s);
+    std::vector<size_t> begin;
+    fuse_addresses( addr_leaf , begin , stmts... );
+    begin.push_back( addr_leaf.ids.size() );
+
+    // Read/write sets: the first id of a statement is its destination,
+    // the others are read. Count the reads of lattices written by an
+    // earlier statement, these no longer make a round trip through
+    // device memory.
+    int raw = 0;
+    for ( size_t k = 1 ; k + 1 < begin.size() ; ++k )
+      for ( size_t i = begin[k] + 1 ; i < begin[k+1] ; ++i )
+	for ( size_t j = 0 ; j < k ; ++j )
+	  if ( addr_leaf.ids[i] >= 0 && addr_leaf.ids[i] == addr_leaf.ids[ begin[j] ] ) {
+	    ++raw;
+	    break;
+	  }
+    jit_stats_fused( sizeof...(S) , raw );
+
+    int th_count = s.hasOrderedRep() ? s.numSiteTable() : Layout::sitesOnNode();
+
+    QDPJitArgs args;
+    args.addBool( s.hasOrderedRep() );
+    args.addInt( th_count );
+    args.addInt( s.start() );
+    args.addInt( s.end() );
+    args.addId( s.getIdMemberTable() );
+    args.addIds( addr_leaf.ids );
+
+    // Only the destinations are written
+    std::vector<int> ro( 1 , s.getIdMemberTable() );
+    for ( size_t k = 0 ; k + 1 < begin.size() ; ++k )
+      for ( size_t i = begin[k] + 1 ; i < begin[k+1] ; ++i ) {
+	bool written = false;
+	for ( size_t j = 0 ; j + 1 < begin.size() ; ++j )
+	  written = written || addr_leaf.ids[i] == addr_leaf.ids[ begin[j] ];
+	if (!written)
+	  ro.push_back( addr_leaf.ids[i] );
+      }
+    QDP_get_global_cache().setKernelReadOnly( ro );
+
+    jit_launch(function,th_count,args);
+  }
+
+
+
+  template<class... S>
+  void jit_fuse( const Subset& s , const S&... stmts )
+  {
+    if (FuseHasMap<S...>::value) {
+      fuse_evaluate_single( s , stmts... );
+      return;
+    }
+
+    static CUfunction function;
+
+    // Build the function
+    if (function == NULL)
+      {
+	function = jit_loaded_function( function_fused_build( stmts... ) );
+      }
+
+    // Execute the function
+    function_fused_exec( function , s , stmts... );
+  }
+
+}
+
+#endif
@@ -18,68 +18,80 @@ namespace QDP {
 			  int in_id, int out_id);
 
 
-  // T1 input
-  // T2 output
-  template< class T1 , class T2 , JitDeviceLayout input_layout >
-  CUfunction 
-  function_sum_convert_ind_build()
+  //
+  // Combine operations of the block reduction. Called with the value
+  // in shared memory (or the global destination) and the value of the
+  // other thread.
+  //
+  struct JitBlockSum
   {
-    if (ptx_db::db_enabled) {
-      CUfunction func = llvm_ptx_db( __PRETTY_FUNCTION__ );
-      if (func)
-	return func;
+    template<class J, class R>
+    void operator()( J& sdata , const R& other ) const
+    {
+      sdata += other;
     }
+  };
 
-    llvm_start_new_function();
-
-    ParamRef p_lo     = llvm_add_param<int>();
-    ParamRef p_hi     = llvm_add_param<int>();
-
-    typedef typename WordType<T1>::Type_t T1WT;
-    typedef typename WordType<T2>::Type_t T2WT;
-
-    ParamRef p_site_perm  = llvm_add_param< int* >(); // Siteperm  array
-    ParamRef p_idata      = llvm_add_param< T1WT* >();  // Input  array
-    ParamRef p_odata      = llvm_add_param< T2WT* >();  // output array
-
-    OLatticeJIT<typename JITType<T1>::Type_t> idata(  p_idata );   // want coal   access later
-    OLatticeJIT<typename JITType<T2>::Type_t> odata(  p_odata );   // want scalar access later
-
-    llvm_derefParam( p_lo ); // r_lo
-    llvm::Value* r_hi     = llvm_derefParam( p_hi );
-
-    llvm_derefParam( p_idata );  // Input  array
-    llvm_derefParam( p_odata );  // output array
-
-    llvm::Value* r_shared = llvm_get_shared_ptr( llvm_type<T2WT>::value );
-
-    typedef typename JITType<T2>::Type_t T2JIT;
-
-    llvm::Value* r_idx = llvm_thread_idx();
+  struct JitBlockMax
+  {
+    template<class J, class R>
+    void operator()( J& sdata , const R& other ) const
+    {
+      R sdata_reg;
+      sdata_reg.setup( sdata );
+      sdata = where( sdata_reg > other , sdata_reg , other );
+    }
+  };
+
+
+  //
+  // Shared memory tree reduction of one block. Each thread has put its
+  // value into sdata_jit (its slot in r_shared). Thread 0 stores the
+  // block result into dest(), which returns the global destination.
+  //
+  // All threads of the block must reach this, it contains barriers.
+  // This is the only place where threads of a block exchange data.
+  //
+  // Host target: The threads of a block run one after the other in
+  // order (jit_launch_host_block). Thread 0 stores its value, the
+  // other threads combine theirs into the destination.
+  //
+  template< class T , class Op , class Dest >
+  void
+  jit_block_reduce( typename JITType<T>::Type_t& sdata_jit,
+		    llvm::Value* r_shared,
+		    const Dest& dest,
+		    const Op& op )
+  {
+    typedef typename REGType< typename JITType<T>::Type_t >::Type_t TREG;
 
-    llvm::Value* r_block_idx  = llvm_call_special_ctaidx();
     llvm::Value* r_tidx       = llvm_call_special_tidx();
-    llvm::Value* r_ntidx       = llvm_call_special_ntidx(); // needed later
-
-    IndexDomainVector args;
-    args.push_back( make_pair( Layout::sitesOnNode() , r_tidx ) );  // sitesOnNode irrelevant since Scalar access later
-    T2JIT sdata_jit;
-    sdata_jit.setup( r_shared , JitDeviceLayout::Scalar , args );
-    zero_rep( sdata_jit );
-
-    llvm_cond_exit( llvm_ge( r_idx , r_hi ) );
-
-    llvm::Value* r_idx_perm = llvm_array_type_indirection( p_site_perm , r_idx );
-
-    typename REGType< typename JITType<T1>::Type_t >::Type_t reg_idata_elem;   // this is stupid
-    reg_idata_elem.setup( idata.elem( input_layout , r_idx_perm ) );
-
-    sdata_jit = reg_idata_elem; // This should do the precision conversion (SP->DP)
+    llvm::Value* r_ntidx      = llvm_call_special_ntidx();
+
+    if (DeviceParams::Instance().getHostTarget()) {
+      TREG sdata_reg;
+      sdata_reg.setup( sdata_jit );
+
+      llvm::BasicBlock * block_store = llvm_new_basic_block();
+      llvm::BasicBlock * block_combine = llvm_new_basic_block();
+      llvm::BasicBlock * block_exit = llvm_new_basic_block();
+      llvm_cond_branch( llvm_eq( r_tidx , llvm_create_value(0) ) , block_store , block_combine );
+      {
+	llvm_set_insert_point(block_store);
+	dest() = sdata_reg;
+	llvm_branch( block_exit );
+      }
+      {
+	llvm_set_insert_point(block_combine);
+	op( dest() , sdata_reg );
+	llvm_branch( block_exit );
+      }
+      llvm_set_insert_point(block_exit);
+      return;
+    }
 
     llvm_bar_sync();
 
-    llvm::Value* val_ntid = llvm_call_special_ntidx();
-
     llvm::BasicBlock * entry_block = llvm_get_insert_block();
     //
     // Find next power of 2 loop
@@ -96,7 +108,7 @@ namespace QDP {
     llvm::PHINode * r_pow = llvm_phi( llvm_type<int>::value , 2 );
     r_pow->addIncoming( llvm_create_value(1) , entry_block );
 
-    llvm_cond_branch( llvm_ge( r_pow , val_ntid ) , block_power_loop_exit , block_power_loop_inc );
+    llvm_cond_branch( llvm_ge( r_pow , r_ntidx ) , block_power_loop_exit , block_power_loop_inc );
     {
       llvm_set_insert_point(block_power_loop_inc);
       r_pow_phi = llvm_shl( r_pow , llvm_create_value(1) );
@@ -136,19 +148,16 @@ namespace QDP {
 
     llvm_set_insert_point(block_red_loop_add);
 
-
     IndexDomainVector args_new;
-    args_new.push_back( make_pair( Layout::sitesOnNode() , 
-				   llvm_add( r_tidx , r_red_pow ) ) );  // sitesOnNode irrelevant since Scalar access later
+    args_new.push_back( make_pair( Layout::sitesOnNode() , v ) );  // sitesOnNode irrelevant since Scalar access later
 
-    typename JITType<T2>::Type_t sdata_jit_plus;
+    typename JITType<T>::Type_t sdata_jit_plus;
     sdata_jit_plus.setup( r_shared , JitDeviceLayout::Scalar , args_new );
 
-    typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg_plus;    // 
+    TREG sdata_reg_plus;
     sdata_reg_plus.setup( sdata_jit_plus );
 
-    sdata_jit += sdata_reg_plus;
-
+    op( sdata_jit , sdata_reg_plus );
 
     llvm_branch( block_red_loop_sync );
 
@@ -161,29 +170,42 @@ namespace QDP {
 
     llvm_set_insert_point(block_red_loop_end);
 
-
     llvm::BasicBlock * block_store_global = llvm_new_basic_block();
     llvm::BasicBlock * block_not_store_global = llvm_new_basic_block();
     llvm_cond_branch( llvm_eq( r_tidx , llvm_create_value(0) ) , 
 		      block_store_global , 
 		      block_not_store_global );
     llvm_set_insert_point(block_store_global);
-    typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg;   // this is stupid
+    TREG sdata_reg;
     sdata_reg.setup( sdata_jit );
-    odata.elem( JitDeviceLayout::Scalar , r_block_idx ) = sdata_reg;
+    dest() = sdata_reg;
     llvm_branch( block_not_store_global );
     llvm_set_insert_point(block_not_store_global);
-
-    return jit_function_epilogue_get_cuf("jit_sum_ind.ptx" , __PRETTY_FUNCTION__ );
   }
 
 
+  //
+  // Block sum, thread 0 stores the block result in odata[block_idx]
+  //
+  template< class T2 >
+  void
+  jit_sum_block_reduce( typename JITType<T2>::Type_t& sdata_jit,
+			llvm::Value* r_shared,
+			OLatticeJIT<typename JITType<T2>::Type_t>& odata )
+  {
+    llvm::Value* r_block_idx  = llvm_call_special_ctaidx();
+
+    jit_block_reduce<T2>( sdata_jit , r_shared ,
+			  [&]() -> typename JITType<T2>::Type_t& { return odata.elem( JitDeviceLayout::Scalar , r_block_idx ); } ,
+			  JitBlockSum() );
+  }
+
 
   // T1 input
   // T2 output
   template< class T1 , class T2 , JitDeviceLayout input_layout >
   CUfunction 
-  function_sum_convert_build()
+  function_sum_convert_ind_build()
   {
     if (ptx_db::db_enabled) {
       CUfunction func = llvm_ptx_db( __PRETTY_FUNCTION__ );
@@ -199,6 +221,7 @@ namespace QDP {
     typedef typename WordType<T1>::Type_t T1WT;
     typedef typename WordType<T2>::Type_t T2WT;
 
+    ParamRef p_site_perm  = llvm_add_param< int* >(); // Siteperm  array
     ParamRef p_idata      = llvm_add_param< T1WT* >();  // Input  array
     ParamRef p_odata      = llvm_add_param< T2WT* >();  // output array
 
@@ -211,15 +234,14 @@ namespace QDP {
     llvm_derefParam( p_idata );  // Input  array
     llvm_derefParam( p_odata );  // output array
 
+    llvm_set_block_reduce();
     llvm::Value* r_shared = llvm_get_shared_ptr( llvm_type<T2WT>::value );
 
     typedef typename JITType<T2>::Type_t T2JIT;
 
     llvm::Value* r_idx = llvm_thread_idx();
 
-    llvm::Value* r_block_idx  = llvm_call_special_ctaidx();
     llvm::Value* r_tidx       = llvm_call_special_tidx();
-    llvm::Value* r_ntidx       = llvm_call_special_ntidx(); // needed later
 
     IndexDomainVector args;
     args.push_back( make_pair( Layout::sitesOnNode() , r_tidx ) );  // sitesOnNode irrelevant since Scalar access later
@@ -229,111 +251,78 @@ namespace QDP {
 
     llvm_cond_exit( llvm_ge( r_idx , r_hi ) );
 
-    //llvm::Value* r_idx_perm = llvm_array_type_indirection( p_site_perm , r_idx );
+    llvm::Value* r_idx_perm = llvm_array_type_indirection( p_site_perm , r_idx );
 
     typename REGType< typename JITType<T1>::Type_t >::Type_t reg_idata_elem;   // this is stupid
-    //reg_idata_elem.setup( idata.elem( input_layout , r_idx_perm ) );
-    reg_idata_elem.setup( idata.elem( input_layout , r_idx ) );
+    reg_idata_elem.setup( idata.elem( input_layout , r_idx_perm ) );
 
     sdata_jit = reg_idata_elem; // This should do the precision conversion (SP->DP)
 
-    llvm_bar_sync();
-
-    llvm::Value* val_ntid = llvm_call_special_ntidx();
-
-    llvm::BasicBlock * entry_block = llvm_get_insert_block();
-    //
-    // Find next power of 2 loop
-    //
-    llvm::BasicBlock * block_power_loop_start = llvm_new_basic_block();
-    llvm::BasicBlock * block_power_loop_inc = llvm_new_basic_block();
-    llvm::BasicBlock * block_power_loop_exit = llvm_new_basic_block();
-    llvm::Value* r_pow_phi;
+    jit_sum_block_reduce<T2>( sdata_jit , r_shared , odata );
 
-    llvm_branch( block_power_loop_start );
+    return jit_function_epilogue_get_cuf("jit_sum_ind.ptx" , __PRETTY_FUNCTION__ );
+  }
 
-    llvm_set_insert_point( block_power_loop_start );
 
-    llvm::PHINode * r_pow = llvm_phi( llvm_type<int>::value , 2 );
-    r_pow->addIncoming( llvm_create_value(1) , entry_block );
 
-    llvm_cond_branch( llvm_ge( r_pow , val_ntid ) , block_power_loop_exit , block_power_loop_inc );
-    {
-      llvm_set_insert_point(block_power_loop_inc);
-      r_pow_phi = llvm_shl( r_pow , llvm_create_value(1) );
-      r_pow->addIncoming( r_pow_phi , block_power_loop_inc );
-      llvm_branch( block_power_loop_start );
+  // T1 input
+  // T2 output
+  template< class T1 , class T2 , JitDeviceLayout input_layout >
+  CUfunction 
+  function_sum_convert_build()
+  {
+    if (ptx_db::db_enabled) {
+      CUfunction func = llvm_ptx_db( __PRETTY_FUNCTION__ );
+      if (func)
+	return func;
     }
 
-    llvm_set_insert_point(block_power_loop_exit);
-
-    llvm::Value* r_pow_shr1 = llvm_shr( r_pow , llvm_create_value(1) );
-
-    //
-    // Shared memory reduction loop
-    //
-    llvm::BasicBlock * block_red_loop_start = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_start_1 = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_start_2 = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_add = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_sync = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_end = llvm_new_basic_block();
-
-    llvm_branch( block_red_loop_start );
-    llvm_set_insert_point(block_red_loop_start);
-    
-    llvm::PHINode * r_red_pow = llvm_phi( llvm_type<int>::value , 2 );    
-    r_red_pow->addIncoming( r_pow_shr1 , block_power_loop_exit );
-    llvm_cond_branch( llvm_le( r_red_pow , llvm_create_value(0) ) , block_red_loop_end , block_red_loop_start_1 );
-
-    llvm_set_insert_point(block_red_loop_start_1);
+    llvm_start_new_function();
 
-    llvm_cond_branch( llvm_ge( r_tidx , r_red_pow ) , block_red_loop_sync , block_red_loop_start_2 );
+    ParamRef p_lo     = llvm_add_param<int>();
+    ParamRef p_hi     = llvm_add_param<int>();
 
-    llvm_set_insert_point(block_red_loop_start_2);
+    typedef typename WordType<T1>::Type_t T1WT;
+    typedef typename WordType<T2>::Type_t T2WT;
 
-    llvm::Value * v = llvm_add( r_red_pow , r_tidx );
-    llvm_cond_branch( llvm_ge( v , r_ntidx ) , block_red_loop_sync , block_red_loop_add );
+    ParamRef p_idata      = llvm_add_param< T1WT* >();  // Input  array
+    ParamRef p_odata      = llvm_add_param< T2WT* >();  // output array
 
-    llvm_set_insert_point(block_red_loop_add);
+    OLatticeJIT<typename JITType<T1>::Type_t> idata(  p_idata );   // want coal   access later
+    OLatticeJIT<typename JITType<T2>::Type_t> odata(  p_odata );   // want scalar access later
 
+    llvm_derefParam( p_lo ); // r_lo
+    llvm::Value* r_hi     = llvm_derefParam( p_hi );
 
-    IndexDomainVector args_new;
-    args_new.push_back( make_pair( Layout::sitesOnNode() , 
-				   llvm_add( r_tidx , r_red_pow ) ) );  // sitesOnNode irrelevant since Scalar access later
+    llvm_derefParam( p_idata );  // Input  array
+    llvm_derefParam( p_odata );  // output array
 
-    typename JITType<T2>::Type_t sdata_jit_plus;
-    sdata_jit_plus.setup( r_shared , JitDeviceLayout::Scalar , args_new );
+    llvm_set_block_reduce();
+    llvm::Value* r_shared = llvm_get_shared_ptr( llvm_type<T2WT>::value );
 
-    typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg_plus;    // 
-    sdata_reg_plus.setup( sdata_jit_plus );
+    typedef typename JITType<T2>::Type_t T2JIT;
 
-    sdata_jit += sdata_reg_plus;
+    llvm::Value* r_idx = llvm_thread_idx();
 
+    llvm::Value* r_tidx       = llvm_call_special_tidx();
 
-    llvm_branch( block_red_loop_sync );
+    IndexDomainVector args;
+    args.push_back( make_pair( Layout::sitesOnNode() , r_tidx ) );  // sitesOnNode irrelevant since Scalar access later
+    T2JIT sdata_jit;
+    sdata_jit.setup( r_shared , JitDeviceLayout::Scalar , args );
+    zero_rep( sdata_jit );
 
-    llvm_set_insert_point(block_red_loop_sync);
-    llvm_bar_sync();
-    llvm::Value* pow_1 = llvm_shr( r_red_pow , llvm_create_value(1) );
-    r_red_pow->addIncoming( pow_1 , block_red_loop_sync );
+    llvm_cond_exit( llvm_ge( r_idx , r_hi ) );
 
-    llvm_branch( block_red_loop_start );
+    //llvm::Value* r_idx_perm = llvm_array_type_indirection( p_site_perm , r_idx );
 
-    llvm_set_insert_point(block_red_loop_end);
+    typename REGType< typename JITType<T1>::Type_t >::Type_t reg_idata_elem;   // this is stupid
+    //reg_idata_elem.setup( idata.elem( input_layout , r_idx_perm ) );
+    reg_idata_elem.setup( idata.elem( input_layout , r_idx ) );
 
+    sdata_jit = reg_idata_elem; // This should do the precision conversion (SP->DP)
 
-    llvm::BasicBlock * block_store_global = llvm_new_basic_block();
-    llvm::BasicBlock * block_not_store_global = llvm_new_basic_block();
-    llvm_cond_branch( llvm_eq( r_tidx , llvm_create_value(0) ) , 
-		      block_store_global , 
-		      block_not_store_global );
-    llvm_set_insert_point(block_store_global);
-    typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg;   // this is stupid
-    sdata_reg.setup( sdata_jit );
-    odata.elem( JitDeviceLayout::Scalar , r_block_idx ) = sdata_reg;
-    llvm_branch( block_not_store_global );
-    llvm_set_insert_point(block_not_store_global);
+    jit_sum_block_reduce<T2>( sdata_jit , r_shared , odata );
 
     return jit_function_epilogue_get_cuf("jit_sum_ind.ptx" , __PRETTY_FUNCTION__ );
   }
@@ -370,6 +359,7 @@ namespace QDP {
     llvm_derefParam( p_idata );  // Input  array
     llvm_derefParam( p_odata );  // output array
 
+    llvm_set_block_reduce();
     llvm::Value* r_shared = llvm_get_shared_ptr( llvm_type<WT>::value );
 
 
@@ -377,12 +367,7 @@ namespace QDP {
 
     llvm::Value* r_idx = llvm_thread_idx();   
 
-    llvm::Value* r_block_idx  = llvm_call_special_ctaidx();
     llvm::Value* r_tidx       = llvm_call_special_tidx();
-    llvm::Value* r_ntidx       = llvm_call_special_ntidx(); // needed later
-
-    typename REGType< typename JITType<T1>::Type_t >::Type_t reg_idata_elem;   // this is stupid
-    reg_idata_elem.setup( idata.elem( JitDeviceLayout::Scalar , r_idx ) ); 
 
     IndexDomainVector args;
     args.push_back( make_pair( Layout::sitesOnNode() , r_tidx ) );  // sitesOnNode irrelevant since Scalar access later
@@ -401,110 +386,108 @@ namespace QDP {
     }
     {
       llvm_set_insert_point(block_not_zero);
+      typename REGType< typename JITType<T1>::Type_t >::Type_t reg_idata_elem;   // this is stupid
+      reg_idata_elem.setup( idata.elem( JitDeviceLayout::Scalar , r_idx ) ); 
       sdata_jit = reg_idata_elem; // This should do the precision conversion (SP->DP)
       llvm_branch( block_zero_exit );
     }
     llvm_set_insert_point(block_zero_exit);
 
-    llvm_bar_sync();
-
-    llvm::Value* val_ntid = llvm_call_special_ntidx();
+    jit_sum_block_reduce<T1>( sdata_jit , r_shared , odata );
 
-    //
-    // Find next power of 2 loop
-    //
-    llvm::BasicBlock * block_power_loop_start = llvm_new_basic_block();
-    llvm::BasicBlock * block_power_loop_inc = llvm_new_basic_block();
-    llvm::BasicBlock * block_power_loop_exit = llvm_new_basic_block();
-    llvm::Value* r_pow_phi;
-
-    llvm_branch( block_power_loop_start );
-
-    llvm_set_insert_point( block_power_loop_start );
+    return jit_function_epilogue_get_cuf("jit_sum.ptx" , __PRETTY_FUNCTION__ );
+  }
 
-    llvm::PHINode * r_pow = llvm_phi( llvm_type<int>::value , 2 );
-    r_pow->addIncoming( llvm_create_value(1) , block_zero_exit );
 
-    llvm_cond_branch( llvm_ge( r_pow , val_ntid ) , block_power_loop_exit , block_power_loop_inc );
-    {
-      llvm_set_insert_point(block_power_loop_inc);
-      r_pow_phi = llvm_shl( r_pow , llvm_create_value(1) );
-      r_pow->addIncoming( r_pow_phi , block_power_loop_inc );
-      llvm_branch( block_power_loop_start );
+  //
+  // First reduction pass that evaluates the expression at each site of
+  // the subset instead of reading a materialized lattice. Each operand
+  // is read once and no full volume temporary is needed.
+  //
+  // RHS must not contain shifts.
+  //
+  template< class T2 , class RHS , class T1 >
+  CUfunction 
+  function_sum_expr_build( const QDPExpr<RHS,OLattice<T1> >& rhs )
+  {
+    if (ptx_db::db_enabled) {
+      CUfunction func = llvm_ptx_db( __PRETTY_FUNCTION__ );
+      if (func)
+	return func;
     }
 
-    llvm_set_insert_point(block_power_loop_exit);
+    llvm_start_new_function();
 
-    llvm::Value* r_pow_shr1 = llvm_shr( r_pow , llvm_create_value(1) );
+    ParamRef p_lo     = llvm_add_param<int>();
+    ParamRef p_hi     = llvm_add_param<int>();
+    ParamRef p_site_perm  = llvm_add_param< int* >(); // Siteperm  array
 
-    //
-    // Shared memory reduction loop
-    //
-    llvm::BasicBlock * block_red_loop_start = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_start_1 = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_start_2 = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_add = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_sync = llvm_new_basic_block();
-    llvm::BasicBlock * block_red_loop_end = llvm_new_basic_block();
+    ParamLeaf param_leaf;
 
-    llvm_branch( block_red_loop_start );
-    llvm_set_insert_point(block_red_loop_start);
-    
-    llvm::PHINode * r_red_pow = llvm_phi( llvm_type<int>::value , 2 );    
-    r_red_pow->addIncoming( r_pow_shr1 , block_power_loop_exit );
-    llvm_cond_branch( llvm_le( r_red_pow , llvm_create_value(0) ) , block_red_loop_end , block_red_loop_start_1 );
+    typedef typename ForEach<QDPExpr<RHS,OLattice<T1> >, ParamLeaf, TreeCombine>::Type_t View_t;
+    View_t rhs_view(forEach(rhs, param_leaf, TreeCombine()));
 
-    llvm_set_insert_point(block_red_loop_start_1);
-
-    llvm_cond_branch( llvm_ge( r_tidx , r_red_pow ) , block_red_loop_sync , block_red_loop_start_2 );
+    typedef typename WordType<T2>::Type_t T2WT;
 
-    llvm_set_insert_point(block_red_loop_start_2);
+    ParamRef p_odata      = llvm_add_param< T2WT* >();  // output array
 
-    llvm::Value * v = llvm_add( r_red_pow , r_tidx );
-    llvm_cond_branch( llvm_ge( v , r_ntidx ) , block_red_loop_sync , block_red_loop_add );
+    OLatticeJIT<typename JITType<T2>::Type_t> odata(  p_odata );   // want scalar access later
 
-    llvm_set_insert_point(block_red_loop_add);
+    llvm_derefParam( p_lo ); // r_lo
+    llvm::Value* r_hi     = llvm_derefParam( p_hi );
 
+    llvm_set_block_reduce();
+    llvm::Value* r_shared = llvm_get_shared_ptr( llvm_type<T2WT>::value );
 
-    IndexDomainVector args_new;
-    args_new.push_back( make_pair( Layout::sitesOnNode() , 
-				   llvm_add( r_tidx , r_red_pow ) ) );  // sitesOnNode irrelevant since Scalar access later
+    typedef typename JITType<T2>::Type_t T2JIT;
 
-    typename JITType<T1>::Type_t sdata_jit_plus;
-    sdata_jit_plus.setup( r_shared , JitDeviceLayout::Scalar , args_new );
+    llvm::Value* r_idx = llvm_thread_idx();
+    llvm::Value* r_tidx       = llvm_call_special_tidx();
 
-    typename REGType< typename JITType<T1>::Type_t >::Type_t sdata_reg_plus;    // 
-    sdata_reg_plus.setup( sdata_jit_plus );
+    IndexDomainVector args;
+    args.push_back( make_pair( Layout::sitesOnNode() , r_tidx ) );  // sitesOnNode irrelevant since Scalar access later
+    T2JIT sdata_jit;
+    sdata_jit.setup( r_shared , JitDeviceLayout::Scalar , args );
+    zero_rep( sdata_jit );
 
-    sdata_jit += sdata_reg_plus;
+    llvm_cond_exit( llvm_ge( r_idx , r_hi ) );
 
+    llvm::Value* r_idx_perm = llvm_array_type_indirection( p_site_perm , r_idx );
 
-    llvm_branch( block_red_loop_sync );
+    sdata_jit = forEach(rhs_view, ViewLeaf( JitDeviceLayout::Coalesced , r_idx_perm ), OpCombine()); // precision conversion (SP->DP)
 
-    llvm_set_insert_point(block_red_loop_sync);
-    llvm_bar_sync();
-    llvm::Value* pow_1 = llvm_shr( r_red_pow , llvm_create_value(1) );
-    r_red_pow->addIncoming( pow_1 , block_red_loop_sync );
+    jit_sum_block_reduce<T2>( sdata_jit , r_shared , odata );
 
-    llvm_branch( block_red_loop_start );
+    return jit_function_epilogue_get_cuf("jit_sum_expr.ptx" , __PRETTY_FUNCTION__ );
+  }
 
-    llvm_set_insert_point(block_red_loop_end);
 
-    llvm::BasicBlock * block_store_global = llvm_new_basic_block();
-    llvm::BasicBlock * block_not_store_global = llvm_new_basic_block();
-    llvm_cond_branch( llvm_eq( r_tidx , llvm_create_value(0) ) , 
-		      block_store_global , 
-		      block_not_store_global );
-    llvm_set_insert_point(block_store_global);
-    typename REGType< typename JITType<T1>::Type_t >::Type_t sdata_reg;   // this is stupid
-    sdata_reg.setup( sdata_jit );
-    odata.elem( JitDeviceLayout::Scalar , r_block_idx ) = sdata_reg;
-    llvm_branch( block_not_store_global );
-    llvm_set_insert_point(block_not_store_global);
 
-    return jit_function_epilogue_get_cuf("jit_sum.ptx" , __PRETTY_FUNCTION__ );
+  template< class RHS , class T1 >
+  void
+  function_sum_expr_exec( CUfunction function, const QDPExpr<RHS,OLattice<T1> >& rhs, const Subset& s,
+			  int size, int threads, int blocks, int shared_mem_usage,
+			  int out_id )
+  {
+    AddressLeaf addr_leaf(s);
+    forEach(rhs, addr_leaf, NullCombine());
+
+    int lo = 0;
+    int hi = size;
+
+    QDPJitArgs args;
+    args.addInt( lo );
+    args.addInt( hi );
+    args.addId( s.getIdSiteTable() );
+    args.addIds( addr_leaf.ids );
+    args.addId( out_id );
+ 
+    addr_leaf.setReadOnlyFrom( 0 , { s.getIdSiteTable() } );
+
+    jit_launch_explicit( function , hi-lo , threads , shared_mem_usage , args );
   }
 
+
 } // namespace
 
 #endif
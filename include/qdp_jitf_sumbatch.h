@@ -0,0 +1,243 @@
+#ifndef QDP_JITF_SUMBATCH_H
+#define QDP_JITF_SUMBATCH_H
+
+namespace QDP {
+
+  //
+  // One reduction of a batch  dest = sum(rhs)
+  //
+  // The first reduction pass of all reductions of a batch is done by
+  // one kernel. Each reduction uses its own slice of shared memory and
+  // writes its block results to its own output buffer.
+  //
+  template<class T, class RHS, class T1>
+  struct SumBatchItem
+  {
+    typedef QDPExpr<RHS,OLattice<T1> > Expr_t;
+    typedef typename UnaryReturn<OLattice<T1>, FnSum>::Type_t::SubType_t T2;
+
+    // The kernel writes sizeof(T2) bytes per block to the result
+    static_assert( std::is_same<T,T2>::value , "sum_into: destination type does not match the type of the sum" );
+
+    enum { has_map = ExprHasMap<RHS>::value };
+
+    SumBatchItem( OScalar<T>& dest , const Expr_t& rhs ): dest(dest), rhs(rhs) {}
+
+    struct JIT
+    {
+      typedef typename ForEach<Expr_t, ParamLeaf, TreeCombine>::Type_t View_t;
+      typedef typename WordType<T2>::Type_t T2WT;
+
+      JIT( const SumBatchItem& s , const ParamLeaf& p ):
+	rhs_view( forEach( s.rhs , p , TreeCombine() ) ),
+	odata( llvm_add_param< T2WT* >() )
+      {}
+
+      // Shared memory of this reduction starts offset bytes per thread
+      // into the shared buffer
+      void setup( llvm::Value* r_tidx , llvm::Value* r_ntidx , int offset )
+      {
+	llvm_set_block_reduce();
+	r_shared = llvm_createGEP( llvm_get_shared_ptr( llvm_type<T2WT>::value ) ,
+				   llvm_mul( r_ntidx , llvm_create_value( offset / sizeof(T2WT) ) ) );
+
+	IndexDomainVector args;
+	args.push_back( make_pair( Layout::sitesOnNode() , r_tidx ) );  // sitesOnNode irrelevant since Scalar access later
+	sdata_jit.setup( r_shared , JitDeviceLayout::Scalar , args );
+	zero_rep( sdata_jit );
+      }
+
+      void eval( llvm::Value* r_idx_perm )
+      {
+	sdata_jit = forEach( rhs_view , ViewLeaf( JitDeviceLayout::Coalesced , r_idx_perm ) , OpCombine() );
+      }
+
+      void reduce()
+      {
+	jit_sum_block_reduce<T2>( sdata_jit , r_shared , odata );
+      }
+
+      View_t rhs_view;
+      OLatticeJIT<typename JITType<T2>::Type_t> odata;
+      typename JITType<T2>::Type_t sdata_jit;
+      llvm::Value* r_shared;
+    };
+
+    void addresses( const AddressLeaf& a , int out_id ) const
+    {
+      forEach( rhs , a , NullCombine() );
+      a.setId( out_id );
+    }
+
+    OScalar<T>& dest;
+    Expr_t      rhs;
+  };
+
+
+  template<class T, class RHS, class T1>
+  SumBatchItem<T,RHS,T1> sum_into( OScalar<T>& dest , const QDPExpr<RHS,OLattice<T1> >& rhs )
+  {
+    return SumBatchItem<T,RHS,T1>( dest , rhs );
+  }
+
+  template<class T, class T1>
+  auto sum_into( OScalar<T>& dest , const OLattice<T1>& rhs ) -> decltype( sum_into( dest , PETE_identity(rhs) ) )
+  {
+    return sum_into( dest , PETE_identity(rhs) );
+  }
+
+  template<class T, class T1>
+  auto norm2_into( OScalar<T>& dest , const T1& s1 ) -> decltype( sum_into( dest , localNorm2(s1) ) )
+  {
+    return sum_into( dest , localNorm2(s1) );
+  }
+
+  template<class T, class T1, class T2>
+  auto innerProduct_into( OScalar<T>& dest , const T1& s1 , const T2& s2 ) -> decltype( sum_into( dest , localInnerProduct(s1,s2) ) )
+  {
+    return sum_into( dest , localInnerProduct(s1,s2) );
+  }
+
+  template<class T, class T1, class T2>
+  auto innerProductReal_into( OScalar<T>& dest , const T1& s1 , const T2& s2 ) -> decltype( sum_into( dest , localInnerProductReal(s1,s2) ) )
+  {
+    return sum_into( dest , localInnerProductReal(s1,s2) );
+  }
+
+
+
+  // Kernel sides of all reductions, built in batch order
+  template<class... S>
+  struct SumBatchJIT
+  {
+    SumBatchJIT( const ParamLeaf& p ) {}
+    void setup( llvm::Value* r_tidx , llvm::Value* r_ntidx , int offset ) {}
+    void eval( llvm::Value* r_idx_perm ) {}
+    void reduce() {}
+  };
+
+  template<class S0, class... S>
+  struct SumBatchJIT<S0,S...>
+  {
+    SumBatchJIT( const ParamLeaf& p , const S0& s0 , const S&... s ): head( s0 , p ), tail( p , s... ) {}
+
+    void setup( llvm::Value* r_tidx , llvm::Value* r_ntidx , int offset )
+    {
+      head.setup( r_tidx , r_ntidx , offset );
+      tail.setup( r_tidx , r_ntidx , offset + sizeof(typename S0::T2) );
+    }
+
+    void eval( llvm::Value* r_idx_perm )
+    {
+      head.eval( r_idx_perm );
+      tail.eval( r_idx_perm );
+    }
+
+    void reduce()
+    {
+      head.reduce();
+      tail.reduce();
+    }
+
+    typename S0::JIT head;
+    SumBatchJIT<S...> tail;
+  };
+
+
+  // Shared memory per thread
+  template<class... S>
+  struct SumBatchSize { enum { value = 0 }; };
+
+  template<class S0, class... S>
+  struct SumBatchSize<S0,S...> { enum { value = sizeof(typename S0::T2) + SumBatchSize<S...>::value }; };
+
+
+
+  template<class... S>
+  CUfunction
+  function_sum_batch_build( const S&... items )
+  {
+    if (ptx_db::db_enabled) {
+      CUfunction func = llvm_ptx_db( __PRETTY_FUNCTION__ );
+      if (func)
+	return func;
+    }
+
+    llvm_start_new_function();
+
+    ParamRef p_lo     = llvm_add_param<int>();
+    ParamRef p_hi     = llvm_add_param<int>();
+    ParamRef p_site_perm  = llvm_add_param< int* >(); // Siteperm  array
+
+    ParamLeaf param_leaf;
+
+    SumBatchJIT<S...> items_jit( param_leaf , items... );
+
+    llvm_derefParam( p_lo ); // r_lo
+    llvm::Value* r_hi     = llvm_derefParam( p_hi );
+
+    llvm::Value* r_idx = llvm_thread_idx();
+    llvm::Value* r_tidx       = llvm_call_special_tidx();
+    llvm::Value* r_ntidx      = llvm_call_special_ntidx();
+
+    items_jit.setup( r_tidx , r_ntidx , 0 );
+
+    llvm::BasicBlock * block_eval = llvm_new_basic_block();
+    llvm::BasicBlock * block_eval_exit = llvm_new_basic_block();
+    llvm_cond_branch( llvm_ge( r_idx , r_hi ) , block_eval_exit , block_eval );
+    {
+      llvm_set_insert_point(block_eval);
+      llvm::Value* r_idx_perm = llvm_array_type_indirection( p_site_perm , r_idx );
+      items_jit.eval( r_idx_perm );
+      llvm_branch( block_eval_exit );
+    }
+    llvm_set_insert_point(block_eval_exit);
+
+    items_jit.reduce();
+
+    return jit_function_epilogue_get_cuf("jit_sum_batch.ptx" , __PRETTY_FUNCTION__ );
+  }
+
+
+
+  inline void function_sum_batch_addresses( const AddressLeaf& a , const std::vector<int>& out_ids , int k ) {}
+
+  template<class S0, class... S>
+  void function_sum_batch_addresses( const AddressLeaf& a , const std::vector<int>& out_ids , int k , const S0& s0 , const S&... s )
+  {
+    s0.addresses( a , out_ids[k] );
+    function_sum_batch_addresses( a , out_ids , k+1 , s... );
+  }
+
+
+  template<class... S>
+  void
+  function_sum_batch_exec( CUfunction function, const Subset& s,
+			   int size, int threads, int blocks, int shared_mem_usage,
+			   const std::vector<int>& out_ids , const S&... items )
+  {
+    AddressLeaf addr_leaf(s);
+    function_sum_batch_addresses( addr_leaf , out_ids , 0 , items... );
+
+    int lo = 0;
+    int hi = size;
+
+    QDPJitArgs args;
+    args.addInt( lo );
+    args.addInt( hi );
+    args.addId( s.getIdSiteTable() );
+    args.addIds( addr_leaf.ids );
+
+    // Everything but the block result buffers is read only
+    std::vector<int> ro( 1 , s.getIdSiteTable() );
+    for ( auto i : addr_leaf.ids )
+      if ( std::find( out_ids.begin() , out_ids.end() , i ) == out_ids.end() )
+	ro.push_back( i );
+    QDP_get_global_cache().setKernelReadOnly( ro );
+
+    jit_launch_explicit( function , hi-lo , threads , shared_mem_usage , args );
+  }
+
+}
+
+#endif
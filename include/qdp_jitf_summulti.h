@@ -53,6 +53,7 @@ namespace QDP {
     llvm_derefParam( p_idata );  // Input  array
     llvm_derefParam( p_odata );  // output array
 
+    llvm_set_block_reduce();
     llvm::Value* r_shared = llvm_get_shared_ptr( llvm_type<T2WT>::value );
 
     typedef typename JITType<T2>::Type_t T2JIT;
@@ -62,12 +63,10 @@ namespace QDP {
     llvm::Value* r_nblock_idx = llvm_call_special_nctaidx();
     llvm::Value* r_block_idx  = llvm_call_special_ctaidx();
     llvm::Value* r_tidx       = llvm_call_special_tidx();
-    llvm::Value* r_ntidx       = llvm_call_special_ntidx(); // needed later
 
 
     llvm::BasicBlock * block_subset_loop_start = llvm_new_basic_block();
     llvm::BasicBlock * block_subset_loop_body  = llvm_new_basic_block();
-    llvm::BasicBlock * block_subset_loop_body_cont1  = llvm_new_basic_block();
     llvm::BasicBlock * block_subset_loop_exit  = llvm_new_basic_block();
 
     llvm::BasicBlock * entry_block = llvm_get_insert_block();
@@ -84,12 +83,7 @@ namespace QDP {
       llvm_set_insert_point(block_subset_loop_body);
       llvm::Value* r_subset_inc = llvm_add( r_subset , llvm_create_value(1) );
 
-      llvm::BasicBlock * block_store_global = llvm_new_basic_block();
-      llvm::BasicBlock * block_not_store_global = llvm_new_basic_block();
-
-      r_subset->addIncoming( r_subset_inc , block_not_store_global );  // change this
-
-      
+      //
       // Loop body begin: r_subset
       //
 
@@ -101,116 +95,31 @@ namespace QDP {
 
       llvm::Value* r_size = llvm_array_type_indirection( p_sizes , r_subset );
 
-      llvm::BasicBlock * block_red_loop_end = llvm_new_basic_block();
-      
-      llvm_cond_branch( llvm_ge( r_idx , r_size ) , block_red_loop_end , block_subset_loop_body_cont1 ); //block_subset_loop_inc , block_not_store_global
-      llvm_set_insert_point(block_subset_loop_body_cont1 );
-      
-      llvm::Value* r_sitetable = llvm_array_type_indirection( p_sitetables , r_subset );
-      llvm::Value* r_idx_perm  = llvm_array_type_indirection( r_sitetable , r_idx );
-
-      typename REGType< typename JITType<T1>::Type_t >::Type_t reg_idata_elem;
-      reg_idata_elem.setup( idata.elem( input_layout , r_idx_perm ) );
-
-      sdata_jit = reg_idata_elem; // This should do the precision conversion (SP->DP)
-
-      llvm_bar_sync();
-
-      llvm::Value* val_ntid = llvm_call_special_ntidx();
-
-      //
-      // Find next power of 2 loop
-      //
-      llvm::BasicBlock * block_power_loop_start = llvm_new_basic_block();
-      llvm::BasicBlock * block_power_loop_inc = llvm_new_basic_block();
-      llvm::BasicBlock * block_power_loop_exit = llvm_new_basic_block();
-      llvm::Value* r_pow_phi;
-
-      llvm_branch( block_power_loop_start );
-
-      llvm_set_insert_point( block_power_loop_start );
-
-      llvm::PHINode * r_pow = llvm_phi( llvm_type<int>::value , 2 );
-      r_pow->addIncoming( llvm_create_value(1) , block_subset_loop_body_cont1 );
-
-      llvm_cond_branch( llvm_ge( r_pow , val_ntid ) , block_power_loop_exit , block_power_loop_inc );
+      // Threads outside of the subset keep zero and take part in the reduction
+      llvm::BasicBlock * block_load = llvm_new_basic_block();
+      llvm::BasicBlock * block_load_exit = llvm_new_basic_block();
+      llvm_cond_branch( llvm_ge( r_idx , r_size ) , block_load_exit , block_load );
       {
-	llvm_set_insert_point(block_power_loop_inc);
-	r_pow_phi = llvm_shl( r_pow , llvm_create_value(1) );
-	r_pow->addIncoming( r_pow_phi , block_power_loop_inc );
-	llvm_branch( block_power_loop_start );
-      }
-
-      llvm_set_insert_point(block_power_loop_exit);
-
-      llvm::Value* r_pow_shr1 = llvm_shr( r_pow , llvm_create_value(1) );
+	llvm_set_insert_point(block_load);
 
-      //
-      // Shared memory reduction loop
-      //
-      llvm::BasicBlock * block_red_loop_start = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_start_1 = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_start_2 = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_add = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_sync = llvm_new_basic_block();
-
-      llvm_branch( block_red_loop_start );
-      llvm_set_insert_point(block_red_loop_start);
-    
-      llvm::PHINode * r_red_pow = llvm_phi( llvm_type<int>::value , 2 );    
-      r_red_pow->addIncoming( r_pow_shr1 , block_power_loop_exit );
-      llvm_cond_branch( llvm_le( r_red_pow , llvm_create_value(0) ) , block_red_loop_end , block_red_loop_start_1 );
-
-      llvm_set_insert_point(block_red_loop_start_1);
-
-      llvm_cond_branch( llvm_ge( r_tidx , r_red_pow ) , block_red_loop_sync , block_red_loop_start_2 );
-
-      llvm_set_insert_point(block_red_loop_start_2);
-
-      llvm::Value * v = llvm_add( r_red_pow , r_tidx );
-      llvm_cond_branch( llvm_ge( v , r_ntidx ) , block_red_loop_sync , block_red_loop_add );
-
-      llvm_set_insert_point(block_red_loop_add);
-
-
-      IndexDomainVector args_new;
-      args_new.push_back( make_pair( Layout::sitesOnNode() , 
-				     llvm_add( r_tidx , r_red_pow ) ) );  // sitesOnNode irrelevant since Scalar access later
+	llvm::Value* r_sitetable = llvm_array_type_indirection( p_sitetables , r_subset );
+	llvm::Value* r_idx_perm  = llvm_array_type_indirection( r_sitetable , r_idx );
 
-      typename JITType<T2>::Type_t sdata_jit_plus;
-      sdata_jit_plus.setup( r_shared , JitDeviceLayout::Scalar , args_new );
-
-      typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg_plus;    // 
-      sdata_reg_plus.setup( sdata_jit_plus );
-
-      sdata_jit += sdata_reg_plus;
-
-
-      llvm_branch( block_red_loop_sync );
-
-      llvm_set_insert_point(block_red_loop_sync);
-      llvm_bar_sync();
-      llvm::Value* pow_1 = llvm_shr( r_red_pow , llvm_create_value(1) );
-      r_red_pow->addIncoming( pow_1 , block_red_loop_sync );
-
-      llvm_branch( block_red_loop_start );
-
-      llvm_set_insert_point(block_red_loop_end);
+	typename REGType< typename JITType<T1>::Type_t >::Type_t reg_idata_elem;
+	reg_idata_elem.setup( idata.elem( input_layout , r_idx_perm ) );
 
+	sdata_jit = reg_idata_elem; // This should do the precision conversion (SP->DP)
+	llvm_branch( block_load_exit );
+      }
+      llvm_set_insert_point(block_load_exit);
 
-      llvm_cond_branch( llvm_eq( r_tidx , llvm_create_value(0) ) , 
-			block_store_global , 
-			block_not_store_global );
-      llvm_set_insert_point(block_store_global);
-      typename REGType< typename JITType<T2>::Type_t >::Type_t sdata_reg;   
-      sdata_reg.setup( sdata_jit );
-      
       llvm::Value* store_idx = llvm_add( llvm_mul( r_nblock_idx , r_subset ) , r_block_idx ); //   store:   subset * nblock  +  block
-	
-      odata.elem( JitDeviceLayout::Scalar , store_idx ) = sdata_reg;
-      llvm_branch( block_not_store_global );
-      llvm_set_insert_point(block_not_store_global);
 
+      jit_block_reduce<T2>( sdata_jit , r_shared ,
+			    [&]() -> T2JIT& { return odata.elem( JitDeviceLayout::Scalar , store_idx ); } ,
+			    JitBlockSum() );
+
+      r_subset->addIncoming( r_subset_inc , llvm_get_insert_block() );
 
       llvm_branch( block_subset_loop_start );
     }
@@ -252,6 +161,7 @@ namespace QDP {
     llvm_derefParam( p_idata );  // Input  array
     llvm_derefParam( p_odata );  // output array
 
+    llvm_set_block_reduce();
     llvm::Value* r_shared = llvm_get_shared_ptr( llvm_type<TWT>::value );
 
     typedef typename JITType<T>::Type_t TJIT;
@@ -261,12 +171,10 @@ namespace QDP {
     llvm::Value* r_nblock_idx = llvm_call_special_nctaidx();
     llvm::Value* r_block_idx  = llvm_call_special_ctaidx();
     llvm::Value* r_tidx       = llvm_call_special_tidx();
-    llvm::Value* r_ntidx       = llvm_call_special_ntidx(); // needed later
 
 
     llvm::BasicBlock * block_subset_loop_start = llvm_new_basic_block();
     llvm::BasicBlock * block_subset_loop_body  = llvm_new_basic_block();
-    llvm::BasicBlock * block_subset_loop_body_cont1  = llvm_new_basic_block();
     llvm::BasicBlock * block_subset_loop_exit  = llvm_new_basic_block();
 
     llvm::BasicBlock * entry_block = llvm_get_insert_block();
@@ -283,12 +191,7 @@ namespace QDP {
       llvm_set_insert_point(block_subset_loop_body);
       llvm::Value* r_subset_inc = llvm_add( r_subset , llvm_create_value(1) );
 
-      llvm::BasicBlock * block_store_global = llvm_new_basic_block();
-      llvm::BasicBlock * block_not_store_global = llvm_new_basic_block();
-
-      r_subset->addIncoming( r_subset_inc , block_not_store_global );  // change this
-
-      
+      //
       // Loop body begin: r_subset
       //
       llvm::Value* r_size = llvm_array_type_indirection( p_sizes , r_subset );
@@ -300,115 +203,30 @@ namespace QDP {
       sdata_jit.setup( r_shared , JitDeviceLayout::Scalar , args );
       zero_rep( sdata_jit );
 
-      llvm::BasicBlock * block_red_loop_end = llvm_new_basic_block();
-
-      llvm_cond_branch( llvm_ge( r_idx , r_size ) , block_red_loop_end , block_subset_loop_body_cont1 ); //block_subset_loop_inc , block_not_store_global
-      llvm_set_insert_point(block_subset_loop_body_cont1 );
-
-      llvm::Value* r_in_idx = llvm_add( llvm_mul( r_subset , r_size ) , r_idx );
-
-      typename REGType< typename JITType<T>::Type_t >::Type_t reg_idata_elem;
-      reg_idata_elem.setup( idata.elem( JitDeviceLayout::Scalar , r_in_idx ) );
-
-      sdata_jit = reg_idata_elem; // This should do the precision conversion (SP->DP)
-
-      llvm_bar_sync();
-
-      llvm::Value* val_ntid = llvm_call_special_ntidx();
-
-      //
-      // Find next power of 2 loop
-      //
-      llvm::BasicBlock * block_power_loop_start = llvm_new_basic_block();
-      llvm::BasicBlock * block_power_loop_inc = llvm_new_basic_block();
-      llvm::BasicBlock * block_power_loop_exit = llvm_new_basic_block();
-      llvm::Value* r_pow_phi;
-
-      llvm_branch( block_power_loop_start );
-
-      llvm_set_insert_point( block_power_loop_start );
-
-      llvm::PHINode * r_pow = llvm_phi( llvm_type<int>::value , 2 );
-      r_pow->addIncoming( llvm_create_value(1) , block_subset_loop_body_cont1 );
-
-      llvm_cond_branch( llvm_ge( r_pow , val_ntid ) , block_power_loop_exit , block_power_loop_inc );
+      // Threads outside of the subset keep zero and take part in the reduction
+      llvm::BasicBlock * block_load = llvm_new_basic_block();
+      llvm::BasicBlock * block_load_exit = llvm_new_basic_block();
+      llvm_cond_branch( llvm_ge( r_idx , r_size ) , block_load_exit , block_load );
       {
-	llvm_set_insert_point(block_power_loop_inc);
-	r_pow_phi = llvm_shl( r_pow , llvm_create_value(1) );
-	r_pow->addIncoming( r_pow_phi , block_power_loop_inc );
-	llvm_branch( block_power_loop_start );
-      }
-
-      llvm_set_insert_point(block_power_loop_exit);
-
-      llvm::Value* r_pow_shr1 = llvm_shr( r_pow , llvm_create_value(1) );
+	llvm_set_insert_point(block_load);
 
-      //
-      // Shared memory reduction loop
-      //
-      llvm::BasicBlock * block_red_loop_start = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_start_1 = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_start_2 = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_add = llvm_new_basic_block();
-      llvm::BasicBlock * block_red_loop_sync = llvm_new_basic_block();
-
-      llvm_branch( block_red_loop_start );
-      llvm_set_insert_point(block_red_loop_start);
-    
-      llvm::PHINode * r_red_pow = llvm_phi( llvm_type<int>::value , 2 );    
-      r_red_pow->addIncoming( r_pow_shr1 , block_power_loop_exit );
-      llvm_cond_branch( llvm_le( r_red_pow , llvm_create_value(0) ) , block_red_loop_end , block_red_loop_start_1 );
-
-      llvm_set_insert_point(block_red_loop_start_1);
-
-      llvm_cond_branch( llvm_ge( r_tidx , r_red_pow ) , block_red_loop_sync , block_red_loop_start_2 );
-
-      llvm_set_insert_point(block_red_loop_start_2);
-
-      llvm::Value * v = llvm_add( r_red_pow , r_tidx );
-      llvm_cond_branch( llvm_ge( v , r_ntidx ) , block_red_loop_sync , block_red_loop_add );
-
-      llvm_set_insert_point(block_red_loop_add);
-
-
-      IndexDomainVector args_new;
-      args_new.push_back( make_pair( Layout::sitesOnNode() , 
-				     llvm_add( r_tidx , r_red_pow ) ) );  // sitesOnNode irrelevant since Scalar access later
+	llvm::Value* r_in_idx = llvm_add( llvm_mul( r_subset , r_size ) , r_idx );
 
-      typename JITType<T>::Type_t sdata_jit_plus;
-      sdata_jit_plus.setup( r_shared , JitDeviceLayout::Scalar , args_new );
-
-      typename REGType< typename JITType<T>::Type_t >::Type_t sdata_reg_plus;    // 
-      sdata_reg_plus.setup( sdata_jit_plus );
-
-      sdata_jit += sdata_reg_plus;
-
-
-      llvm_branch( block_red_loop_sync );
-
-      llvm_set_insert_point(block_red_loop_sync);
-      llvm_bar_sync();
-      llvm::Value* pow_1 = llvm_shr( r_red_pow , llvm_create_value(1) );
-      r_red_pow->addIncoming( pow_1 , block_red_loop_sync );
-
-      llvm_branch( block_red_loop_start );
-
-      llvm_set_insert_point(block_red_loop_end);
+	typename REGType< typename JITType<T>::Type_t >::Type_t reg_idata_elem;
+	reg_idata_elem.setup( idata.elem( JitDeviceLayout::Scalar , r_in_idx ) );
 
+	sdata_jit = reg_idata_elem; // This should do the precision conversion (SP->DP)
+	llvm_branch( block_load_exit );
+      }
+      llvm_set_insert_point(block_load_exit);
 
-      llvm_cond_branch( llvm_eq( r_tidx , llvm_create_value(0) ) , 
-			block_store_global , 
-			block_not_store_global );
-      llvm_set_insert_point(block_store_global);
-      typename REGType< typename JITType<T>::Type_t >::Type_t sdata_reg;   
-      sdata_reg.setup( sdata_jit );
-      
       llvm::Value* store_idx = llvm_add( llvm_mul( r_nblock_idx , r_subset ) , r_block_idx ); //   store:   subset * nblock  +  block
-	
-      odata.elem( JitDeviceLayout::Scalar , store_idx ) = sdata_reg;
-      llvm_branch( block_not_store_global );
-      llvm_set_insert_point(block_not_store_global);
 
+      jit_block_reduce<T>( sdata_jit , r_shared ,
+			   [&]() -> TJIT& { return odata.elem( JitDeviceLayout::Scalar , store_idx ); } ,
+			   JitBlockSum() );
+
+      r_subset->addIncoming( r_subset_inc , llvm_get_insert_block() );
 
       llvm_branch( block_subset_loop_start );
     }
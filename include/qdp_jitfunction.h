@@ -417,25 +417,21 @@ function_lat_sca_exec(CUfunction function, OLattice<T>& dest, const Op& op, cons
 
   forEach(dest, addr_leaf, NullCombine());
   AddOpAddress<Op,AddressLeaf>::apply(op,addr_leaf);
+  size_t rhs_begin = addr_leaf.ids.size();
   forEach(rhs, addr_leaf, NullCombine());
 
   int th_count = s.hasOrderedRep() ? s.numSiteTable() : Layout::sitesOnNode();
 
-  JitParam jit_ordered( QDP_get_global_cache().addJitParamBool( s.hasOrderedRep() ) );
-  JitParam jit_th_count( QDP_get_global_cache().addJitParamInt( th_count ) );
-  JitParam jit_start( QDP_get_global_cache().addJitParamInt( s.start() ) );
-  JitParam jit_end( QDP_get_global_cache().addJitParamInt( s.end() ) );
-  
-  std::vector<int> ids;
-  ids.push_back( jit_ordered.get_id() );
-  ids.push_back( jit_th_count.get_id() );
-  ids.push_back( jit_start.get_id() );
-  ids.push_back( jit_end.get_id() );
-  ids.push_back( s.getIdMemberTable() );
-  for(unsigned i=0; i < addr_leaf.ids.size(); ++i)
-    ids.push_back( addr_leaf.ids[i] );
+  QDPJitArgs args;
+  args.addBool( s.hasOrderedRep() );
+  args.addInt( th_count );
+  args.addInt( s.start() );
+  args.addInt( s.end() );
+  args.addId( s.getIdMemberTable() );
+  args.addIds( addr_leaf.ids );
  
-  jit_launch(function,th_count,ids);
+  addr_leaf.setReadOnlyFrom( rhs_begin , { s.getIdMemberTable() } );
+  jit_launch(function,th_count,args);
 }
 
 
@@ -820,7 +816,7 @@ function_gather_build( const QDPExpr<RHS,OLattice<T1> >& rhs )
   ParamRef p_lo      = llvm_add_param<int>();
   ParamRef p_hi      = llvm_add_param<int>();
   ParamRef p_soffset = llvm_add_param<int*>();
-  ParamRef p_sndbuf  = llvm_add_param<WT*>();
+  ParamRef p_sndbuf  = HaloWord<WT>::add_param();
 
   ParamLeaf param_leaf;
 
@@ -859,18 +855,14 @@ void
 
   int hi = map.soffset(subset).size();
 
-  JitParam jit_lo( QDP_get_global_cache().addJitParamInt( 0 ) );        // lo, leave it in
-  JitParam jit_hi( QDP_get_global_cache().addJitParamInt( hi ) );
-
-  std::vector<int> ids;
-  ids.push_back( jit_lo.get_id() );
-  ids.push_back( jit_hi.get_id() );
-  ids.push_back( map.getSoffsetsId(subset) );
-  ids.push_back( send_buf_id );
-  for(unsigned i=0; i < addr_leaf.ids.size(); ++i) 
-    ids.push_back( addr_leaf.ids[i] );
+  QDPJitArgs args;
+  args.addInt( 0 );        // lo, leave it in
+  args.addInt( hi );
+  args.addId( map.getSoffsetsId(subset) );
+  args.addId( send_buf_id );
+  args.addIds( addr_leaf.ids );
  
-  jit_launch(function,hi,ids);
+  jit_launch(function,hi,args);
 #if 0  
   int lo = 0;
   int hi = map.soffset(subset).size();
@@ -905,34 +897,30 @@ function_exec(CUfunction function, OLattice<T>& dest, const Op& op, const QDPExp
 
   ShiftPhase1 phase1(s);
   int offnode_maps = forEach(rhs, phase1 , BitOrCombine());
+  FnMapRsrc::start_pending();
 
   AddressLeaf addr_leaf(s);
   forEach(dest, addr_leaf, NullCombine());
   AddOpAddress<Op,AddressLeaf>::apply(op,addr_leaf);
+  size_t rhs_begin = addr_leaf.ids.size();
   forEach(rhs, addr_leaf, NullCombine());
 
   if (offnode_maps == 0)
     {
       int th_count = s.hasOrderedRep() ? s.numSiteTable() : Layout::sitesOnNode();
 
-      JitParam jit_ordered( QDP_get_global_cache().addJitParamBool( s.hasOrderedRep() ) );
-      JitParam jit_th_count( QDP_get_global_cache().addJitParamInt( th_count ) );
-      JitParam jit_start( QDP_get_global_cache().addJitParamInt( s.start() ) );
-      JitParam jit_end( QDP_get_global_cache().addJitParamInt( s.end() ) );
-      JitParam jit_do_soffset_index( QDP_get_global_cache().addJitParamBool( false ) );   // do soffset index
-
-      std::vector<int> ids;
-      ids.push_back( jit_ordered.get_id() );
-      ids.push_back( jit_th_count.get_id() );
-      ids.push_back( jit_start.get_id() );
-      ids.push_back( jit_end.get_id() );
-      ids.push_back( jit_do_soffset_index.get_id() );
-      ids.push_back( -1 );  // soffset index table
-      ids.push_back( s.getIdMemberTable() );
-      for(unsigned i=0; i < addr_leaf.ids.size(); ++i) 
-	ids.push_back( addr_leaf.ids[i] );
+      QDPJitArgs args;
+      args.addBool( s.hasOrderedRep() );
+      args.addInt( th_count );
+      args.addInt( s.start() );
+      args.addInt( s.end() );
+      args.addBool( false );   // do soffset index
+      args.addId( -1 );  // soffset index table
+      args.addId( s.getIdMemberTable() );
+      args.addIds( addr_leaf.ids );
  
-      jit_launch(function,th_count,ids);
+      addr_leaf.setReadOnlyFrom( rhs_begin , { s.getIdMemberTable() } );
+      jit_launch(function,th_count,args);
     }
   else
     {
@@ -940,51 +928,40 @@ function_exec(CUfunction function, OLattice<T>& dest, const Op& op, const QDPExp
       {
 	int th_count = MasterMap::Instance().getCountInner(s,offnode_maps);
       
-	JitParam jit_ordered( QDP_get_global_cache().addJitParamBool( s.hasOrderedRep() ) );
-	JitParam jit_th_count( QDP_get_global_cache().addJitParamInt( th_count ) );
-	JitParam jit_start( QDP_get_global_cache().addJitParamInt( s.start() ) );
-	JitParam jit_end( QDP_get_global_cache().addJitParamInt( s.end() ) );
-	JitParam jit_do_soffset_index( QDP_get_global_cache().addJitParamBool( true ) );   // do soffset index
-
-	std::vector<int> ids;
-	ids.push_back( jit_ordered.get_id() );
-	ids.push_back( jit_th_count.get_id() );
-	ids.push_back( jit_start.get_id() );
-	ids.push_back( jit_end.get_id() );
-	ids.push_back( jit_do_soffset_index.get_id() );
-	ids.push_back( MasterMap::Instance().getIdInner(s,offnode_maps) );
-	ids.push_back( s.getIdMemberTable() );
-	for(unsigned i=0; i < addr_leaf.ids.size(); ++i) 
-	  ids.push_back( addr_leaf.ids[i] );
+	QDPJitArgs args;
+	args.addBool( s.hasOrderedRep() );
+	args.addInt( th_count );
+	args.addInt( s.start() );
+	args.addInt( s.end() );
+	args.addBool( true );   // do soffset index
+	args.addId( MasterMap::Instance().getIdInner(s,offnode_maps) );
+	args.addId( s.getIdMemberTable() );
+	args.addIds( addr_leaf.ids );
  
-	jit_launch(function,th_count,ids);
+	addr_leaf.setReadOnlyFrom( rhs_begin , { s.getIdMemberTable() , MasterMap::Instance().getIdInner(s,offnode_maps) } );
+	jit_launch(function,th_count,args);
       }
       
       // 2nd call: face
       {
 	ShiftPhase2 phase2;
 	forEach(rhs, phase2 , NullCombine());
+	FnMapRsrc::sync_received();
 
 	int th_count = MasterMap::Instance().getCountFace(s,offnode_maps);
       
-	JitParam jit_ordered( QDP_get_global_cache().addJitParamBool( s.hasOrderedRep() ) );
-	JitParam jit_th_count( QDP_get_global_cache().addJitParamInt( th_count ) );
-	JitParam jit_start( QDP_get_global_cache().addJitParamInt( s.start() ) );
-	JitParam jit_end( QDP_get_global_cache().addJitParamInt( s.end() ) );
-	JitParam jit_do_soffset_index( QDP_get_global_cache().addJitParamBool( true ) );   // do soffset index
-
-	std::vector<int> ids;
-	ids.push_back( jit_ordered.get_id() );
-	ids.push_back( jit_th_count.get_id() );
-	ids.push_back( jit_start.get_id() );
-	ids.push_back( jit_end.get_id() );
-	ids.push_back( jit_do_soffset_index.get_id() );
-	ids.push_back( MasterMap::Instance().getIdFace(s,offnode_maps) );
-	ids.push_back( s.getIdMemberTable() );
-	for(unsigned i=0; i < addr_leaf.ids.size(); ++i) 
-	  ids.push_back( addr_leaf.ids[i] );
+	QDPJitArgs args;
+	args.addBool( s.hasOrderedRep() );
+	args.addInt( th_count );
+	args.addInt( s.start() );
+	args.addInt( s.end() );
+	args.addBool( true );   // do soffset index
+	args.addId( MasterMap::Instance().getIdFace(s,offnode_maps) );
+	args.addId( s.getIdMemberTable() );
+	args.addIds( addr_leaf.ids );
  
-	jit_launch(function,th_count,ids);
+	addr_leaf.setReadOnlyFrom( rhs_begin , { s.getIdMemberTable() , MasterMap::Instance().getIdFace(s,offnode_maps) } );
+	jit_launch(function,th_count,args);
       }
 
       
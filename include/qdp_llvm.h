@@ -115,6 +115,10 @@ namespace QDP {
 
   void llvm_set_debug( const char * str );
   void llvm_set_opt( const char * c_str );
+  void llvm_set_target( const char * c_str );
+  void llvm_set_prewarm( const char * c_str );
+  void llvm_set_threads( int n );
+  void llvm_prewarm_start();
   void llvm_set_ptxdb( const char * c_str );
   void llvm_debug_write_set_name( const char* pretty, const char* additional );
 
@@ -151,6 +155,10 @@ namespace QDP {
   };
 
   std::string getPTXfromCUFunc(CUfunction f);
+  std::string getIdfromCUFunc(CUfunction f);
+  // Kernel was built with the 'sites per thread' argument (no thread block features)
+  bool llvm_function_takes_spt(CUfunction f);
+  void llvm_move_function_id( CUfunction from , CUfunction to );
   
   void llvm_append_mattr( const char * attr );
 
@@ -261,10 +269,16 @@ namespace QDP {
   llvm::Value * llvm_call_special_ntidx();
   llvm::Value * llvm_call_special_ctaidx();
   llvm::Value * llvm_call_special_nctaidx();
+  llvm::Value * llvm_call_special_nctaidy();
 
   llvm::Value * llvm_alloca( llvm::Type* type , int elements );
   llvm::Value * llvm_get_shared_ptr( llvm::Type *ty );
 
+  // The kernel being built exchanges data between the threads of a
+  // block through jit_block_reduce only. Required for shared memory on
+  // the host target.
+  void llvm_set_block_reduce();
+
   void llvm_bar_sync();
 
   llvm::Value * llvm_thread_idx();
@@ -273,6 +287,10 @@ namespace QDP {
 
   CUfunction llvm_get_cufunction(const char* fname, const char* pretty);
 
+  CUfunction  get_fptr_from_ptx( const char* fname , const std::string& kernel );
+  void        llvm_ptx_db_store( const std::string& id , const std::string& ptx );
+  std::string llvm_compile_bitcode( llvm::LLVMContext& context , const std::string& bitcode );
+
 
   llvm::Value* llvm_sin_f32( llvm::Value* lhs );
   llvm::Value* llvm_acos_f32( llvm::Value* lhs );
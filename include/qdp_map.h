@@ -36,6 +36,11 @@ public:
   //! Maps a lattice coordinate under a map to a new lattice coordinate
   /*! sign > 0 for map, sign < 0 for the inverse map */
   virtual multi1d<int> operator() (const multi1d<int>& coordinate, int sign) const = 0;
+
+  //! Is this a nearest neighbor shift?
+  /*! If so, the map moves a coordinate by one site in direction dir, forward
+   *  for sign > 0, and Map::make doesn't need to call operator() for each site */
+  virtual bool isShift(int& dir, int& sign) const {return false;}
 };
     
 
@@ -53,6 +58,9 @@ public:
 
   //! Returns the array size - the number of directions which are to be used
   virtual int numArray() const = 0;
+
+  //! Is this the nearest neighbor shift (sign > 0 forward by one site in dir)?
+  virtual bool isShift() const {return false;}
 };
 
 
@@ -195,6 +203,7 @@ public:
     return myId;
   }
   bool get_offnodeP() const { return offnodeP; }
+  bool get_shiftP() const   { return shiftP; }
   bool hasOffnode() const   { return offnodeP; }
   const multi1d<int>& get_destnodes() const {
     return destnodes;
@@ -241,12 +250,16 @@ private:
   // Indicate off-node communications is needed;
   bool offnodeP;
 
+  // Made from a nearest neighbor shift, every node sends and receives
+  // the same way
+  bool shiftP = false;
+
 
   // LAZY
-  multi1d< multi1d<int> > lazy_fcoord;
-  multi1d< multi1d<int> > lazy_bcoord;
+  multi1d<int>            lazy_fline;                 // [linear] linear index of the source site on its node
   mutable multi1d<int>    srcnode;
-  multi1d< multi1d<int> > lazy_destnodes0_fcoord;
+  multi1d<int>            lazy_destnodes0_fnode;      // [linear] source node and index of the sites on destnodes[0]
+  multi1d<int>            lazy_destnodes0_fline;
   mutable multi1d<bool>   lazy_done;                  // [subset no.]
 };
 
@@ -291,6 +304,33 @@ struct TagVisitor<FnMap, PrintTag> : public ParenPrinter<FnMap>
 
 
 
+// The word type of the halo buffers. Double precision words travel in
+// single precision with -halo-single, the loads and stores of the
+// shift kernels convert.
+template<class WT>
+struct HaloWord {
+  static bool reduced() { return false; }
+  static ParamRef add_param() { return llvm_add_param<WT*>(); }
+};
+
+template<>
+struct HaloWord<double> {
+  static bool reduced() { return DeviceParams::Instance().getHaloSingle(); }
+  static ParamRef add_param() { return reduced() ? llvm_add_param<float*>() : llvm_add_param<double*>(); }
+};
+
+// Size in bytes of the halo of a number of sites
+template<class T>
+int halo_bytes(int sites)
+{
+  typedef typename WordType<T>::Type_t WT;
+  if (HaloWord<WT>::reduced())
+    return sites * ( sizeof(T) / sizeof(WT) ) * sizeof(float);
+  return sites * sizeof(T);
+}
+
+
+
 template<class A>
 struct ForEach<UnaryNode<FnMap, A>, ParamLeaf, TreeCombine>
   {
@@ -310,7 +350,7 @@ struct ForEach<UnaryNode<FnMap, A>, ParamLeaf, TreeCombine>
 
       IndexRet index_pack;
       index_pack.p_multi_index = llvm_add_param<int*>();
-      index_pack.p_recv_buf    = llvm_add_param<AWordType_t*>(); // This deduces it's type from A
+      index_pack.p_recv_buf    = HaloWord<AWordType_t>::add_param(); // This deduces it's type from A
 
       return Type_t( FnMapJIT( expr.operation() , index_pack ) , 
 		     ForEach< A, ParamLeaf, TreeCombine >::apply( expr.child() , p , c ) );
@@ -457,8 +497,8 @@ struct ForEach<UnaryNode<FnMap, A>, ShiftPhase1 , BitOrCombine>
 	QDP_info("Map: off-node communications required");
 #endif
 
-	int dstnum = map.get_destnodes_num(f.subset)[0]*sizeof(InnerType_t);
-	int srcnum = map.get_srcenodes_num(f.subset)[0]*sizeof(InnerType_t);
+	int dstnum = halo_bytes<InnerType_t>( map.get_destnodes_num(f.subset)[0] );
+	int srcnum = halo_bytes<InnerType_t>( map.get_srcenodes_num(f.subset)[0] );
 
 	const FnMapRsrc& rRSrc = fnmap.getResource(srcnum,dstnum);
 
@@ -475,12 +515,12 @@ struct ForEach<UnaryNode<FnMap, A>, ShiftPhase1 , BitOrCombine>
 
 	if (function == NULL)
 	  {
-	    function = function_gather_build<InnerType_t>( subexpr );
+	    function = jit_loaded_function( function_gather_build<InnerType_t>( subexpr ) );
 	  }
 
 	function_gather_exec(function, rRSrc.getSendBufId() , map , subexpr , f.subset );
 
-	rRSrc.send_receive();
+	rRSrc.send_receive( map.get_shiftP() );
 	
 	returnVal = maps_involved | map.getId();
       }
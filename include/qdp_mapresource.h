@@ -5,6 +5,8 @@
 
 namespace QDP {
 
+  struct HaloMessage;
+
   // The MPI resources class for an FnMap.
   // An instance for each (dest/src node,msg_size) combination
   // exists so they can be reused over the whole program lifetime.
@@ -32,13 +34,31 @@ public:
     //QDPIO::cout << "~FnMapRsrc()\n";
   }
 
+  // The exchange is pipelined over the shifts of an expression:
+  // send_receive queues the copy of the gathered send buffer to the
+  // host on the transfer stream, start_pending waits for all queued
+  // copies once and starts the messages. qmp_wait queues the copy of
+  // the received data to the device, so it overlaps the wait for the
+  // next shift. sync_received waits for those copies before the face
+  // kernel.
+  // Shifts that send to the same node more than once share one message
+  // per neighbor, see start_pending.
   void qmp_wait() const;
-  void send_receive() const;
+  void send_receive(bool shift = false) const;
+  static void start_pending();
+  static void sync_received();
+  static void cleanup_aggregates();
 
   void * getSendBufDevPtr() const { return send_buf_dev; }
   void * getRecvBufDevPtr() const { return recv_buf_dev; }
 
   bool bSet;
+  mutable bool staged = false;   // send buffer copy queued, message not started
+  mutable bool shift = false;    // may be aggregated
+  mutable HaloMessage * aggSend = nullptr;
+  mutable HaloMessage * aggRecv = nullptr;
+  mutable int aggSendOffset, aggRecvOffset;
+  int destnode, srcnode;
   mutable void * send_buf;
   mutable void * recv_buf;
   void * send_buf_dev;
@@ -83,6 +103,7 @@ class FnMapRsrcMatrix {
 
   void cleanup() {
     //QDPIO::cout << "FnMapRsrcMatrix cleanup\n";
+    FnMapRsrc::cleanup_aggregates();
     for(unsigned int i=0;i<numSendMsgSize;i++) {
       for(unsigned int q=0;q<numDestNode;q++) {
 	//QDPIO::cout << "cleanup m2d(" << i << "," << q << ")\n";
@@ -15,40 +15,38 @@ namespace QDP {
     // const multi1d<int>& getInnerSites(const Subset& s,int bitmask) const;
     // const multi1d<int>& getFaceSites(const Subset& s,int bitmask) const;
 
-    int getCountInner(const Subset& s,int bitmask) const;
-    int getCountFace(const Subset& s,int bitmask) const;
-    int getIdInner(const Subset& s,int bitmask) const;
-    int getIdFace(const Subset& s,int bitmask) const;
+    // Inner and face sites of a combination of off-node maps (bitmask
+    // of map ids). The tables are built when a combination is first
+    // used and dropped when it wasn't used for a while.
+    int getCountInner(const Subset& s,int bitmask);
+    int getCountFace(const Subset& s,int bitmask);
+    int getIdInner(const Subset& s,int bitmask);
+    int getIdFace(const Subset& s,int bitmask);
 
   private:
     void complement(multi1d<int>& out, const multi1d<int>& orig) const;
     void remove_neg(multi1d<int>& out, const multi1d<int>& orig) const;
-    void remove_neg_in_subset(multi1d<int>& out, const multi1d<int>& orig, int s_no) const;
     void uniquify_list_inplace(multi1d<int>& out , const multi1d<int>& ll) const;
 
-    MasterMap() {
-      //QDPIO::cout << "constructing master map with " << MasterSet::Instance().numSubsets() << " subsets\n";
+    struct Tables {
+      std::vector<int> inner;    // sites that receive from none of the maps
+      std::vector<int> face;     // sites that receive from at least one
+      int              idInner;
+      int              idFace;
+      unsigned long    lastUse;
+    };
 
-      powerSet.resize( MasterSet::Instance().numSubsets() );
-      powerSetC.resize( MasterSet::Instance().numSubsets() );
-      idInner.resize( MasterSet::Instance().numSubsets() );
-      idFace.resize( MasterSet::Instance().numSubsets() );
+    enum { max_tables = 64 };    // per subset
 
-      // powerSet.reserve(2048);
-      // powerSetC.reserve(2048);
+    Tables& tables(const Subset& s,int bitmask);
+    void build(Tables& t,const Subset& s,int bitmask);
+    void drop(Tables& t);
 
-      for (int s_no = 0 ; s_no < MasterSet::Instance().numSubsets() ; ++s_no ) {
-	powerSet[s_no].resize(1);
-	powerSet[s_no][0] = new multi1d<int>;
-      }
-    }
+    MasterMap(): use(0) {}
 
     std::vector<const Map*> vecPMap;
-    std::vector< std::vector< multi1d<int>* > > powerSet;  // Power set of roffsets
-    std::vector< std::vector< multi1d<int>* > > powerSetC; // Power set of complements
-    std::vector< std::vector< int > > idInner;
-    std::vector< std::vector< int > > idFace;
-
+    std::vector< std::map< int , Tables > > mapTables;  // by subset, then bitmask
+    unsigned long use;
   };
 
 } // namespace QDP
@@ -151,7 +151,7 @@ namespace QDP {
 
       QDPCache::Status status = accessed_on_host ? QDPCache::Status::host : QDPCache::Status::undef;
 
-      myId = QDP_get_global_cache().add( sizeof(T) , QDPCache::Flags::OwnHostMemory , status , &F , NULL , NULL );
+      myId = QDP_get_global_cache().add( sizeof(T) , QDPCache::Flags::OwnHostMemory | QDPCache::Flags::Scalar , status , &F , NULL , NULL );
     }
     inline void free_mem() {
       if (myId >= 0)
@@ -447,41 +447,12 @@ void evaluate(OScalar<T>& dest, const Op& op, const QDPExpr<RHS,OScalar<T1> >& r
 
 
 
-      typename WordType<T>::Type_t * in_data  = (typename WordType<T>::Type_t *)inPtr;
-      typename WordType<T>::Type_t * out_data = (typename WordType<T>::Type_t *)outPtr;
-
       size_t lim_rea = GetLimit<T,2>::Limit_v; //T::ThisSize;
       size_t lim_col = GetLimit<T,1>::Limit_v; //T::ThisSize;
       size_t lim_spi = GetLimit<T,0>::Limit_v; //T::ThisSize;
 
-      // QDP_info_primary("lim_rea = %d" , lim_rea );
-      // QDP_info_primary("lim_col = %d" , lim_col );
-      // QDP_info_primary("lim_spi = %d" , lim_spi );
-
-      for ( int site = 0 ; site < Layout::sitesOnNode() ; site++ ) {
-	for ( size_t reality = 0 ; reality < lim_rea ; reality++ ) {
-	  for ( size_t color = 0 ; color < lim_col ; color++ ) {
-	    for ( size_t spin = 0 ; spin < lim_spi ; spin++ ) {
-	      size_t hst_idx = 
-		reality + 
-		lim_rea * color +
-		lim_rea * lim_col * spin +
-		lim_rea * lim_col * lim_spi * site;
-	      size_t dev_idx = 
-		site + 
-		Layout::sitesOnNode() * spin +
-		Layout::sitesOnNode() * lim_spi * color +
-		Layout::sitesOnNode() * lim_spi * lim_col * reality;
-	      if (toDev)
-		out_data[dev_idx] = in_data[hst_idx];
-	      else {
-		//std::cout << hst_idx  << " <= " << dev_idx << "\n";
-		out_data[hst_idx] = in_data[dev_idx];
-	      }
-	    }
-	  }
-	}
-      }
+      datalayout_transpose( toDev , outPtr , inPtr , sizeof(typename WordType<T>::Type_t) ,
+			    lim_rea , lim_col , lim_spi , Layout::sitesOnNode() );
     }
 
     int getId() const {
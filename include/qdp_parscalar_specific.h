@@ -124,7 +124,7 @@ void evaluate(OScalar<T>& dest, const Op& op, const QDPExpr<RHS,OScalar<T1> >& r
   if (function == NULL)
     {
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-      function = function_sca_sca_build(dest, op, rhs);
+      function = jit_loaded_function( function_sca_sca_build(dest, op, rhs) );
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
     }
   else
@@ -164,7 +164,7 @@ void evaluate(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OScalar<T1> >&
   if (function == NULL)
     {
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-      function = function_lat_sca_build(dest, op, rhs);
+      function = jit_loaded_function( function_lat_sca_build(dest, op, rhs) );
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
     }
   else
@@ -239,7 +239,7 @@ void evaluate(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLattice<T1> >&
   if (function == NULL)
     {
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-      function = function_build(dest0, op, rhs);
+      function = jit_loaded_function( function_build(dest0, op, rhs) );
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
     }
   else
@@ -303,7 +303,7 @@ void evaluate(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLattice<T1> >&
   if (function == NULL)
     {
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-      function = function_build(dest, op, rhs);
+      function = jit_loaded_function( function_build(dest, op, rhs) );
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
     }
   else
@@ -333,7 +333,7 @@ void evaluate_subtype_type(OSubLattice<T>& dest, const Op& op, const QDPExpr<RHS
   static CUfunction function;
 
   if (function == NULL)
-    function = function_subtype_type_build(dest, op, rhs);
+    function = jit_loaded_function( function_subtype_type_build(dest, op, rhs) );
 
   function_subtype_type_exec(function, dest, op, rhs, s);
 }
@@ -345,7 +345,7 @@ void operator_type_subtype(OLattice<T>& dest, const Op& op, const QDPSubType<T1,
   static CUfunction function;
 
   if (function == NULL)
-    function = operator_type_subtype_build(dest, op, rhs);
+    function = jit_loaded_function( operator_type_subtype_build(dest, op, rhs) );
 
   operator_type_subtype_exec(function, dest, op, rhs, s);
 }
@@ -357,7 +357,7 @@ void operator_subtype_subtype(OSubLattice<T>& dest, const Op& op, const QDPSubTy
   static CUfunction function;
 
   if (function == NULL)
-    function = operator_subtype_subtype_build(dest, op, rhs);
+    function = jit_loaded_function( operator_subtype_subtype_build(dest, op, rhs) );
 
   operator_subtype_subtype_exec(function, dest, op, rhs, s);
 }
@@ -371,7 +371,7 @@ void evaluate_subtype(OSubLattice<T>& dest, const Op& op, const QDPExpr<RHS,OSca
   static CUfunction function;
 
   if (function == NULL)
-    function = function_lat_sca_subtype_build(dest, op, rhs);
+    function = jit_loaded_function( function_lat_sca_subtype_build(dest, op, rhs) );
 
   function_lat_sca_subtype_exec(function, dest, op, rhs, s);
 }
@@ -408,7 +408,7 @@ void copymask(OLattice<T2>& dest, const OLattice<T1>& mask, const OLattice<T2>&
 
   if (function == NULL)
     {
-      function = function_copymask_build( dest , mask , s1 );
+      function = jit_loaded_function( function_copymask_build( dest , mask , s1 ) );
     }
 
   function_copymask_exec(function, dest , mask , s1 );
@@ -458,7 +458,7 @@ random(OLattice<T>& d, const Subset& s)
   static CUfunction function;
   Seed seed_tmp;
   if (function == NULL)
-    function = function_random_build( d , seed_tmp );
+    function = jit_loaded_function( function_random_build( d , seed_tmp ) );
   function_random_exec(function, d, s , seed_tmp );
   //RNG::ran_seed = seed_tmp;  // The seed from any site is the same as the new global seed
 
@@ -531,7 +531,7 @@ random(OLattice<T>& d, const Subset& s)
   if (function == NULL)
     {
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-      function = function_random_build( d , seed_tmp );
+      function = jit_loaded_function( function_random_build( d , seed_tmp ) );
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
     }
   else
@@ -601,7 +601,7 @@ void gaussian(OLattice<T>& d, const Subset& s)
   if (function == NULL)
     {
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-      function = function_gaussian_build( d , r1 , r2 );
+      function = jit_loaded_function( function_gaussian_build( d , r1 , r2 ) );
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
     }
   else
@@ -654,7 +654,7 @@ bool isfinite(const OLattice<T>& dest)
   Boolean ret = true;
   
   if (function == NULL)
-    function = function_isfinite_build( ret , dest );
+    function = jit_loaded_function( function_isfinite_build( ret , dest ) );
 
   function_isfinite_exec( function , ret , dest );
 
@@ -679,7 +679,7 @@ void zero_rep(OLattice<T>& dest, const Subset& s)
 
   if (function == NULL)
     {
-      function = function_zero_rep_build( dest );
+      function = jit_loaded_function( function_zero_rep_build( dest ) );
     }
   else
     {
@@ -706,7 +706,7 @@ void zero_rep_subtype(OSubLattice<T>& dest, const Subset& s)
 
   if (function == NULL)
     {
-      function = function_zero_rep_subtype_build( dest );
+      function = jit_loaded_function( function_zero_rep_subtype_build( dest ) );
     }
   else
     {
@@ -808,6 +808,11 @@ template<class RHS, class T>
 typename UnaryReturn<OLattice<T>, FnSum>::Type_t
 sum(const QDPExpr<RHS,OLattice<T> >& s1, const Subset& s)
 {
+  // Expressions without shifts are evaluated in the reduction kernel.
+  // Shifts need communication, those are evaluated first.
+  if (!ExprHasMap<RHS>::value)
+    return sum_expr(s1,s);
+
   // We don't profile this because this is a combination of eval and sum
 
   OLattice<T> l;
@@ -859,6 +864,9 @@ template<class RHS, class T>
 typename UnaryReturn<OLattice<T>, FnSum>::Type_t
 sum(const QDPExpr<RHS,OLattice<T> >& s1)
 {
+  if (!ExprHasMap<RHS>::value)
+    return sum_expr(s1,all);
+
   // We don't profile this because this is a combination of eval and sum
 
   OLattice<T> l;
@@ -1716,7 +1724,7 @@ pokeSite(OLattice<T1>& l, const OScalar<T1>& r, const multi1d<int>& coord)
   if (function == NULL)
     {
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-      function = function_pokeSite_build(l, r);
+      function = jit_loaded_function( function_pokeSite_build(l, r) );
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
     }
   else
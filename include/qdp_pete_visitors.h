@@ -82,6 +82,17 @@ struct AddressLeaf
   void setId( int id ) const {
     ids.push_back( id );
   }
+
+  // The ids from position first on are only read by the next kernel,
+  // except those that also appear before first (the destination).
+  // ro holds further read-only arguments, e.g. site tables.
+  void setReadOnlyFrom( size_t first , std::vector<int> ro = std::vector<int>() ) const {
+    first = std::min( first , ids.size() );
+    for ( size_t i = first ; i < ids.size() ; ++i )
+      if ( std::find( ids.begin() , ids.begin() + first , ids[i] ) == ids.begin() + first )
+	ro.push_back( ids[i] );
+    QDP_get_global_cache().setKernelReadOnly( ro );
+  }
   void setLit( float f ) const {
     ids.push_back( QDP_get_global_cache().addJitParamFloat(f) );
     ids_signoff.push_back( ids.back() );
@@ -4,7 +4,9 @@
 #define QDP_POOL_ALLOCATOR
 
 #include <string>
-#include <list>
+#include <map>
+#include <set>
+#include <cassert>
 #include <iostream>
 #include <algorithm>
 
@@ -15,6 +17,12 @@ namespace QDP
 {
 
 
+  //
+  // Best-fit allocator on a pool of memory. The blocks are indexed by
+  // address, so that a freed block coalesces with its free neighbours,
+  // and the free blocks are indexed by size (then address). Allocate
+  // and free are O(log n) in the number of blocks.
+  //
   template<class Allocator>
   class QDPPoolAllocator {
   public:
@@ -23,8 +31,8 @@ namespace QDP
     static QDPPoolAllocator& Instance();
     void sayHi ();
 
-    typedef typename std::list< entry_t >              listEntry_t;
-    typedef std::list< typename  listEntry_t::iterator> listEntryIter_t;
+    typedef std::map< void* , entry_t >              mapEntry_t;   // all blocks by address
+    typedef std::set< std::pair< size_t , void* > >  setFree_t;    // free blocks by size
 
   public:
 
@@ -34,6 +42,17 @@ namespace QDP
     void   printListPool();
     void   printPoolInfo();
     size_t getPoolSize();
+    size_t getFreeBytes();
+    size_t getLargestFree();
+    size_t getUsedBytes() const { return bytes_used; }
+    size_t getPeakUsedBytes() const { return bytes_used_peak; }
+
+    // Slides the allocated blocks towards the start of the pool so that
+    // the free space merges. movable(ptr) tells whether the block at ptr
+    // may be relocated, relocated(from,to) is called for each block that
+    // was. Returns the number of bytes moved.
+    template<class Movable, class Relocated>
+    size_t compact( Movable movable , Relocated relocated );
 
     bool allocate( void** ptr, size_t n_bytes );
 
@@ -58,12 +77,12 @@ namespace QDP
     void *             unaligned;
     size_t             poolSize;
     size_t             bytes_allocated;
-    listEntry_t        listEntry;
-    listEntryIter_t    listAllocOrder;
-    typename listEntry_t::iterator iterNextNotAllocated;
-
-    bool findNextNotAllocated( typename listEntry_t::iterator & start , size_t & size );
-
+    mapEntry_t         mapEntry;
+    setFree_t          setFree;
+    size_t             compactions;
+    size_t             bytes_moved;
+    size_t             bytes_used;        // in allocated blocks
+    size_t             bytes_used_peak;
   };
 
 
@@ -105,7 +124,7 @@ namespace QDP
 
 
   template<class Allocator>
-    QDPPoolAllocator<Allocator>::QDPPoolAllocator(): bufferAllocated(false) {
+    QDPPoolAllocator<Allocator>::QDPPoolAllocator(): bufferAllocated(false), compactions(0), bytes_moved(0), bytes_used(0), bytes_used_peak(0) {
 #ifdef GPU_DEBUG    
       QDP_debug("Pool allocator construct");
 #endif      
@@ -127,17 +146,6 @@ namespace QDP
 
 
 
-  template<class T>
-  struct SizeNotAllocated: public std::binary_function< typename T::entry_t, size_t , bool > {
-    bool operator () ( const typename T::entry_t & ent , const size_t & size ) const {
-      return ( 
-	      (!ent.allocated) &&
-	      (ent.size >= size) 
-	       );
-    }
-  };
-
-
   template<class Allocator>
   void QDPPoolAllocator<Allocator>::freeInternalBuffer() {
     if (bufferAllocated) {
@@ -163,15 +171,15 @@ namespace QDP
 #endif      
       Allocator::free( unaligned );
 #ifdef GPU_DEBUG      
-      QDP_debug("listEntry size (should be 1) = %d" , listEntry.size());
+      QDP_debug("mapEntry size (should be 1) = %d" , mapEntry.size());
 #endif      
-      if (listEntry.size() != 1)
-	QDP_error_exit("pool allocator problem, listEntry not 1");
-      while ( listEntry.size() )
-	listEntry.pop_front();
+      if (mapEntry.size() != 1)
+	QDP_error_exit("pool allocator problem, mapEntry not 1");
+      mapEntry.clear();
+      setFree.clear();
     }
 
-    if ( listEntry.size() > 0 )
+    if ( mapEntry.size() > 0 )
       QDP_error_exit("Pool allocator: list of entries not zero");
 
     bytes_allocated = poolSize + 2 * QDP_ALIGNMENT_SIZE;
@@ -190,9 +198,8 @@ namespace QDP
     e.ptr = poolPtr;
     e.size = poolSize;
     e.allocated = false;
-    listEntry.push_back(e);
-
-    iterNextNotAllocated = listEntry.begin();
+    mapEntry.insert( std::make_pair( e.ptr , e ) );
+    setFree.insert( std::make_pair( e.size , e.ptr ) );
 
     bufferAllocated=true;
   }
@@ -201,47 +208,105 @@ namespace QDP
   template<class Allocator>
   void QDPPoolAllocator<Allocator>::printPoolInfo() {
     QDP_info("CUDA memory allocated: start pointer = %p, size = %lu" , (void*)unaligned , (unsigned long)bytes_allocated );
+
+    // Fragmentation is the fraction of free memory outside the largest free block
+    size_t free_bytes = getFreeBytes();
+    size_t largest    = getLargestFree();
+    double frag = free_bytes ? 1.0 - (double)largest / (double)free_bytes : 0.0;
+
+    QDP_info("Pool: size = %lu, free = %lu in %lu blocks, largest free block = %lu, fragmentation = %.3f" ,
+	     (unsigned long)poolSize , (unsigned long)free_bytes , (unsigned long)setFree.size() , (unsigned long)largest , frag );
+    QDP_info("Pool: compactions = %lu, bytes moved = %lu" , (unsigned long)compactions , (unsigned long)bytes_moved );
+    QDP_info("Pool: in use = %lu, high-water mark = %lu" , (unsigned long)bytes_used , (unsigned long)bytes_used_peak );
   }
 
 
   template<class Allocator>
-  void QDPPoolAllocator<Allocator>::printListPool() {
-    QDP_info("Memory pool");
-    int c=0;
-    for ( typename listEntry_t::iterator p = listEntry.begin(); p != listEntry.end() ; p++ ) {
-
-      typename listEntryIter_t::iterator q = listAllocOrder.begin();
-      bool found=false;
-      int d=0;
-      while ((!found) && ( q != listAllocOrder.end() )) {
-	if (*q == p)
-	  found=true;
-	else {
-	  d++;
-	  q++;
+  size_t QDPPoolAllocator<Allocator>::getFreeBytes() {
+    size_t n = 0;
+    for ( typename setFree_t::iterator f = setFree.begin() ; f != setFree.end() ; ++f )
+      n += f->first;
+    return n;
+  }
+
+
+  template<class Allocator>
+  size_t QDPPoolAllocator<Allocator>::getLargestFree() {
+    return setFree.empty() ? 0 : setFree.rbegin()->first;
+  }
+
+
+  template<class Allocator>
+  template<class Movable, class Relocated>
+  size_t QDPPoolAllocator<Allocator>::compact( Movable movable , Relocated relocated ) {
+    if (!bufferAllocated)
+      return 0;
+
+    mapEntry_t blocks;
+    size_t moved = 0;
+    size_t dest = (size_t)poolPtr;   // end of the compacted part
+
+    for ( typename mapEntry_t::iterator p = mapEntry.begin() ; p != mapEntry.end() ; ++p ) {
+      entry_t e = p->second;
+      if (!e.allocated)
+	continue;
+
+      size_t src = (size_t)e.ptr;
+
+      if ( src > dest ) {
+	if ( movable( e.ptr ) ) {
+	  // Copy in pieces no larger than the gap, source and destination
+	  // of a piece must not overlap
+	  size_t gap = src - dest;
+	  for ( size_t off = 0 ; off < e.size ; off += gap )
+	    Allocator::copy( (void*)(dest + off) , (void*)(src + off) , std::min( gap , e.size - off ) );
+
+	  relocated( e.ptr , (void*)dest );
+	  e.ptr = (void*)dest;
+	  moved += e.size;
+	} else {
+	  entry_t hole;
+	  hole.ptr = (void*)dest;
+	  hole.size = src - dest;
+	  hole.allocated = false;
+	  blocks.insert( std::make_pair( hole.ptr , hole ) );
 	}
       }
 
-      if (iterNextNotAllocated==p)
-	QDP_info("%d ptr=%p size=%d %d (cand) allocOrder=%d", c++ , p->ptr , p->size , p->allocated ,d);
-      else
-	QDP_info("%d ptr=%p size=%d %d allocOrder=%d", c++ , p->ptr , p->size , p->allocated ,d);
+      blocks.insert( std::make_pair( e.ptr , e ) );
+      dest = (size_t)e.ptr + e.size;
+    }
+
+    size_t end = (size_t)poolPtr + poolSize;
+    if ( dest < end ) {
+      entry_t tail;
+      tail.ptr = (void*)dest;
+      tail.size = end - dest;
+      tail.allocated = false;
+      blocks.insert( std::make_pair( tail.ptr , tail ) );
     }
+
+    mapEntry.swap( blocks );
+
+    setFree.clear();
+    for ( typename mapEntry_t::iterator p = mapEntry.begin() ; p != mapEntry.end() ; ++p )
+      if ( !p->second.allocated )
+	setFree.insert( std::make_pair( p->second.size , p->first ) );
+
+    compactions++;
+    bytes_moved += moved;
+
+    return moved;
   }
 
 
   template<class Allocator>
-  bool QDPPoolAllocator<Allocator>::findNextNotAllocated( typename QDPPoolAllocator<Allocator>::listEntry_t::iterator & start , 
-							  size_t & size ) {
-    typename QDPPoolAllocator<Allocator>::listEntry_t::iterator save = start;
-    start = std::find_if( start , listEntry.end(), std::bind2nd( SizeNotAllocated<QDPPoolAllocator<Allocator> >(), size ) );
-    if ( start == listEntry.end()) {
-      start = std::find_if( listEntry.begin() , save , std::bind2nd( SizeNotAllocated<QDPPoolAllocator<Allocator> >(), size ) );
-      if ( start == save) {
-	return false;
-      }
+  void QDPPoolAllocator<Allocator>::printListPool() {
+    QDP_info("Memory pool");
+    int c=0;
+    for ( typename mapEntry_t::iterator p = mapEntry.begin(); p != mapEntry.end() ; p++ ) {
+      QDP_info("%d ptr=%p size=%lu %d", c++ , p->second.ptr , (unsigned long)p->second.size , p->second.allocated );
     }
-    return true;
   }
 
 
@@ -270,56 +335,39 @@ namespace QDP
       QDP_error_exit("QDPPoolAllocator<Allocator>::allocate ( size == 0 )");
 #endif
 
-    typename QDPPoolAllocator::listEntry_t::iterator candidate = iterNextNotAllocated;
-    if (candidate == listEntry.end() || candidate->allocated) {
-      //QDP_info("Pool allocator (alignment=%u): no candidate, means pool full!",(unsigned)Allocator::ALIGNMENT_SIZE);
-      //printListPool();
+    // Smallest free block that fits, the lowest address among equal sizes
+    typename setFree_t::iterator f = setFree.lower_bound( std::make_pair( size , (void*)NULL ) );
+    if (f == setFree.end()) {
+#ifdef GPU_DEBUG
+      QDP_debug("Pool allocator: out of memory");
+#endif
       return false;
     }
 
-    do {
-      if (candidate->size >= size) {
-	if (candidate->size == size) {
-
-	  candidate->allocated = true;
-
-	  // we seek a spot of at least the mininmum size
-	  findNextNotAllocated( iterNextNotAllocated , alignment );
-
-	  listAllocOrder.push_front(candidate);
-	  *ptr = candidate->ptr;
-
-	  return true;
-
-	} else {
-
-	  entry_t e;
-	  e.ptr = candidate->ptr;
-	  e.size = size;
-	  e.allocated = true;
-	
-	  candidate->ptr = (void*)( (size_t)(candidate->ptr) + size );
-	  candidate->size = candidate->size - size;
+    typename mapEntry_t::iterator candidate = mapEntry.find( f->second );
+    assert( candidate != mapEntry.end() );
+    setFree.erase( f );
 
-	  if (candidate->size==0)
-	    QDP_error_exit("QDPPoolAllocator<Allocator>::allocate ( candidate->size == 0 ),%u",(unsigned)size);
+    entry_t& e = candidate->second;
 
-	  iterNextNotAllocated = listEntry.insert( candidate , e );
-	  listAllocOrder.push_front( iterNextNotAllocated );
+    if (e.size > size) {
+      entry_t rest;
+      rest.ptr = (void*)( (size_t)(e.ptr) + size );
+      rest.size = e.size - size;
+      rest.allocated = false;
 
-	  iterNextNotAllocated++;
+      mapEntry.insert( std::next( candidate ) , std::make_pair( rest.ptr , rest ) );
+      setFree.insert( std::make_pair( rest.size , rest.ptr ) );
 
-	  *ptr = e.ptr;
+      e.size = size;
+    }
 
-	  return true;
+    e.allocated = true;
+    bytes_used += e.size;
+    bytes_used_peak = std::max( bytes_used_peak , bytes_used );
+    *ptr = e.ptr;
 
-	}
-      }
-    } while ( findNextNotAllocated( ++candidate , size ) );
-#ifdef GPU_DEBUG
-    QDP_debug("Pool allocator: out of memory");
-#endif
-    return false;
+    return true;
   }
 
 
@@ -328,46 +376,34 @@ namespace QDP
   template<class Allocator>
   void QDPPoolAllocator<Allocator>::free(const void *mem) {
 
-    typename listEntryIter_t::iterator q = listAllocOrder.begin();
+    typename mapEntry_t::iterator p = mapEntry.find( const_cast<void*>(mem) );
 
-    bool found=false;
-    while ((!found) && ( q != listAllocOrder.end() )) {
-      if ((*q)->ptr == mem) 
-	found=true;
-      else {
-	q++;
-      }
-    }
-
-    if (!found) {
+    if ( p == mapEntry.end() || !p->second.allocated ) {
       QDP_error_exit("pool allocator: free: address not found %p",mem);
     }
 
-    typename listEntry_t::iterator p = *q;
-    p->allocated = false;
+    p->second.allocated = false;
+    bytes_used -= p->second.size;
 
-    if ( p != listEntry.begin() ) {
-      typename listEntry_t::iterator prev = p;
-      prev--;
-      if (!prev->allocated) {
-	prev->size += p->size;
-	listEntry.erase(p);
-	p = prev;
-      }
+    // Coalesce with the free neighbours
+    typename mapEntry_t::iterator next = std::next( p );
+    if ( next != mapEntry.end() && !next->second.allocated ) {
+      setFree.erase( std::make_pair( next->second.size , next->first ) );
+      p->second.size += next->second.size;
+      mapEntry.erase( next );
     }
 
-    if ( p != --listEntry.end() ) {
-      typename listEntry_t::iterator next = p;
-      next++;
-      if (!next->allocated) {
-	p->size += next->size;
-	listEntry.erase(next);
+    if ( p != mapEntry.begin() ) {
+      typename mapEntry_t::iterator prev = std::prev( p );
+      if ( !prev->second.allocated ) {
+	setFree.erase( std::make_pair( prev->second.size , prev->first ) );
+	prev->second.size += p->second.size;
+	mapEntry.erase( p );
+	p = prev;
       }
     }
 
-    iterNextNotAllocated = p;
-
-    listAllocOrder.erase(q);
+    setFree.insert( std::make_pair( p->second.size , p->first ) );
 
     return;
   }
@@ -0,0 +1,108 @@
+// -*- C++ -*-
+
+#ifndef QDP_PTX_DB_H
+#define QDP_PTX_DB_H
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <vector>
+#include <string>
+
+namespace QDP {
+
+  //
+  // Append-only on-disk PTX kernel database
+  //
+  // The file is a log of records
+  //
+  //   magic | key size | PTX size | crc32(key,PTX) | key | PTX
+  //
+  // At startup the file is memory-mapped and only the record headers
+  // and keys are read to build the index. PTX bodies are paged in and
+  // checked against their checksum on first lookup. A record that
+  // extends past the end of the file (e.g. after a crash during an
+  // append) ends the valid part of the log and is dropped with the
+  // next append.
+  //
+  // The file may be shared by all ranks of a job. Appends are
+  // serialized with a file lock. To compile each kernel only once per
+  // job a rank takes a lease (a lock file in <fname>.lock/) on the key
+  // before compiling it. Other ranks missing the same key wait for
+  // the compiling rank to append it (see wait_or_lease). A lease older
+  // than lease_timeout seconds, or one whose holder process on this
+  // host is gone, is considered stale and is broken. A rank doesn't
+  // wait longer than lease_timeout seconds, it compiles the kernel
+  // itself without lease then.
+  // release_lease only removes leases held by this process.
+  // Opened without leases (e.g. the tune DB, whose records are cheap
+  // to reproduce) no <fname>.lock/ is created and a rank never waits,
+  // wait_or_lease and lease always leave the key to the caller.
+  //
+  // Kernels compiled in the background are appended from the worker
+  // threads of the JIT compile pool, the public members are thread-safe.
+  //
+  class PTXDB {
+  public:
+    PTXDB();
+    ~PTXDB();
+
+    void open( const std::string& fname , bool use_leases = true );
+    void close();
+
+    bool contains( const std::string& key ) const;
+    bool find( const std::string& key , std::string& ptx );
+    // Does nothing if key is in the file already
+    void append( const std::string& key , const std::string& ptx );
+
+    // Pick up records appended by other processes
+    void refresh();
+
+    // Returns true if the PTX for key was found (possibly after waiting
+    // for another rank to compile it). Returns false if the caller is
+    // expected to compile and append it, usually holding the lease.
+    bool wait_or_lease( const std::string& key , std::string& ptx );
+    void release_lease( const std::string& key );
+
+    // Returns true if the caller took the lease for key, which is not
+    // in the file yet. Does not wait for other ranks.
+    bool lease( const std::string& key );
+
+    size_t size() const { std::lock_guard<std::recursive_mutex> guard(mtx); return index.size(); }
+    std::vector< std::string > keys() const;
+
+  private:
+    PTXDB(const PTXDB&);
+    PTXDB& operator=(const PTXDB&);
+
+    struct entry_t {
+      size_t offset;   // offset of the record header in the mapped file
+      bool   loaded;   // PTX is in 'bodies'
+    };
+
+    bool scan();
+    bool check_record( size_t offset , std::string& ptx ) const;
+    void remap();
+    void lock();
+    void unlock();
+    bool try_lease( const std::string& key );
+    std::string lease_name( const std::string& key ) const;
+
+    std::string fname;
+    int    fd;
+    char*  map_ptr;
+    size_t map_size;
+    size_t valid_end;  // end of the last valid record
+    int    lease_timeout;
+    bool   use_leases;
+
+    std::map< std::string , entry_t >     index;
+    std::map< std::string , std::string > bodies;
+    std::set< std::string >               leases;   // held by this process
+
+    mutable std::recursive_mutex mtx;
+  };
+
+}
+
+#endif
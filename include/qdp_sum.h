@@ -13,7 +13,7 @@ namespace QDP {
     if (function == NULL)
       {
 	//std::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-	function = function_sum_build<T2>();
+	function = jit_loaded_function( function_sum_build<T2>() );
 	//std::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
       }
     else
@@ -42,7 +42,7 @@ namespace QDP {
     if (function == NULL)
       {
 	//std::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-	function = function_sum_convert_ind_build<T1,T2,input_layout>();
+	function = jit_loaded_function( function_sum_convert_ind_build<T1,T2,input_layout>() );
 	//std::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
       }
     else
@@ -78,7 +78,7 @@ namespace QDP {
     if (function == NULL)
       {
 	//std::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-	function = function_summulti_convert_ind_build<T1,T2,input_layout>();
+	function = jit_loaded_function( function_summulti_convert_ind_build<T1,T2,input_layout>() );
 	//std::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
       }
     else
@@ -116,7 +116,7 @@ namespace QDP {
     if (function == NULL)
       {
 	//std::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-	function = function_summulti_build<T>();
+	function = jit_loaded_function( function_summulti_build<T>() );
 	//std::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
       }
     else
@@ -150,7 +150,7 @@ namespace QDP {
     if (function == NULL)
       {
 	//std::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-	function = function_sum_convert_build<T1,T2,input_layout>();
+	function = jit_loaded_function( function_sum_convert_build<T1,T2,input_layout>() );
 	//std::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
       }
     else
@@ -250,6 +250,237 @@ namespace QDP {
   }
 
 
+  // Reduction of an expression without shifts. The first pass
+  // evaluates the expression in the reduction kernel.
+  template<class RHS, class T1>
+  typename UnaryReturn<OLattice<T1>, FnSum>::Type_t
+  sum_expr(const QDPExpr<RHS,OLattice<T1> >& s1, const Subset& s)
+  {
+    typedef typename UnaryReturn<OLattice<T1>, FnSum>::Type_t::SubType_t T2;
+
+    int out_id,in_id;
+
+    typename UnaryReturn<OLattice<T1>, FnSum>::Type_t  d;
+
+#if defined(QDP_USE_PROFILING)   
+    static QDPProfile_t prof(d, OpAssign(), FnSum(), s1);
+    prof.stime(getClockTime());
+#endif
+
+    static CUfunction function;
+
+    if (function == NULL)
+      function = jit_loaded_function( function_sum_expr_build<T2>( s1 ) );
+
+    unsigned actsize=s.numSiteTable();
+    bool first=true;
+    while (1) {
+
+      unsigned numThreads = DeviceParams::Instance().getMaxBlockX();
+      while ((numThreads*sizeof(T2) > DeviceParams::Instance().getMaxSMem()) || (numThreads > actsize)) {
+	numThreads >>= 1;
+      }
+      unsigned numBlocks=(int)ceil(float(actsize)/numThreads);
+
+      if (numBlocks > DeviceParams::Instance().getMaxGridX()) {
+	QDP_error_exit( "sum(Expr,subset) numBlocks(%d) > maxGridX(%d)",numBlocks,(int)DeviceParams::Instance().getMaxGridX());
+      }
+
+      int shared_mem_usage = numThreads*sizeof(T2);
+
+      if (first) {
+	out_id = QDP_get_global_cache().add( numBlocks*sizeof(T2) , QDPCache::Flags::Empty , QDPCache::Status::undef , NULL , NULL , NULL );
+	in_id  = QDP_get_global_cache().add( numBlocks*sizeof(T2) , QDPCache::Flags::Empty , QDPCache::Status::undef , NULL , NULL , NULL );
+      }
+
+      int dest_id = numBlocks == 1 ? d.getId() : out_id;
+
+      if (first)
+	function_sum_expr_exec( function , s1 , s , actsize , numThreads , numBlocks , shared_mem_usage , dest_id );
+      else
+	qdp_jit_reduce<T2>( actsize , numThreads , numBlocks , shared_mem_usage , in_id , dest_id );
+
+      first =false;
+
+      if (numBlocks==1) 
+	break;
+
+      actsize=numBlocks;
+
+      int tmp = in_id;
+      in_id = out_id;
+      out_id = tmp;
+    }
+
+    QDP_get_global_cache().signoff( in_id );
+    QDP_get_global_cache().signoff( out_id );
+
+    QDPInternal::globalSum(d);
+
+#if defined(QDP_USE_PROFILING)   
+    prof.etime(getClockTime());
+    prof.count++;
+    prof.print();
+#endif
+
+    return d;
+  }
+
+
+  // Remaining tree reduction passes of partial sums. Takes ownership
+  // of in_id.
+  template<class T2>
+  void qdp_jit_reduce_partials( unsigned actsize , int in_id , int dest_id )
+  {
+    int out_id = QDP_get_global_cache().add( actsize*sizeof(T2) , QDPCache::Flags::Empty , QDPCache::Status::undef , NULL , NULL , NULL );
+
+    while (1) {
+      unsigned numThreads = DeviceParams::Instance().getMaxBlockX();
+      while ((numThreads*sizeof(T2) > DeviceParams::Instance().getMaxSMem()) || (numThreads > actsize)) {
+	numThreads >>= 1;
+      }
+      unsigned numBlocks=(int)ceil(float(actsize)/numThreads);
+
+      int shared_mem_usage = numThreads*sizeof(T2);
+
+      qdp_jit_reduce<T2>( actsize , numThreads , numBlocks , shared_mem_usage , in_id , numBlocks == 1 ? dest_id : out_id );
+
+      if (numBlocks==1) 
+	break;
+
+      actsize=numBlocks;
+
+      int tmp = in_id;
+      in_id = out_id;
+      out_id = tmp;
+    }
+
+    QDP_get_global_cache().signoff( in_id );
+    QDP_get_global_cache().signoff( out_id );
+  }
+
+
+
+  //
+  // Batched reductions over one subset
+  //
+  //   sum_batch( s , norm2_into( rr , r ) , innerProduct_into( pap , p , Ap ) );
+  //
+  // The first reduction pass of all reductions is done by one kernel
+  // and the global sums of all results are done with one allreduce.
+  // Reductions of expressions with shifts are evaluated one by one.
+  //
+  inline void sum_batch_single( const Subset& s ) {}
+
+  template<class S0, class... S>
+  void sum_batch_single( const Subset& s , const S0& s0 , const S&... items )
+  {
+    s0.dest = sum( s0.rhs , s );
+    sum_batch_single( s , items... );
+  }
+
+
+  inline void sum_batch_alloc( int numBlocks , std::vector<int>& out_ids ) {}
+
+  template<class S0, class... S>
+  void sum_batch_alloc( int numBlocks , std::vector<int>& out_ids , const S0& s0 , const S&... items )
+  {
+    if (numBlocks == 1)
+      out_ids.push_back( s0.dest.getId() );
+    else
+      out_ids.push_back( QDP_get_global_cache().add( numBlocks*sizeof(typename S0::T2) , QDPCache::Flags::Empty , QDPCache::Status::undef , NULL , NULL , NULL ) );
+    sum_batch_alloc( numBlocks , out_ids , items... );
+  }
+
+
+  inline void sum_batch_finish( int numBlocks , const std::vector<int>& out_ids , int k ) {}
+
+  template<class S0, class... S>
+  void sum_batch_finish( int numBlocks , const std::vector<int>& out_ids , int k , const S0& s0 , const S&... items )
+  {
+    qdp_jit_reduce_partials<typename S0::T2>( numBlocks , out_ids[k] , s0.dest.getId() );
+    sum_batch_finish( numBlocks , out_ids , k+1 , items... );
+  }
+
+
+  // Results with double words are packed into one buffer, others are
+  // summed on their own
+  template<class T2, class T>
+  void sum_batch_pack( OScalar<T>& d , std::vector<double>& buf , bool unpack , double* )
+  {
+    double* p = (double*)d.getF();
+    size_t n = sizeof(T2)/sizeof(double);
+    if (unpack) {
+      std::copy( buf.begin() , buf.begin() + n , p );
+      buf.erase( buf.begin() , buf.begin() + n );
+    } else {
+      buf.insert( buf.end() , p , p + n );
+    }
+  }
+
+  template<class T2, class T, class W>
+  void sum_batch_pack( OScalar<T>& d , std::vector<double>& buf , bool unpack , W* )
+  {
+    if (!unpack)
+      QDPInternal::globalSum(d);
+  }
+
+  inline void sum_batch_pack_all( std::vector<double>& buf , bool unpack ) {}
+
+  template<class S0, class... S>
+  void sum_batch_pack_all( std::vector<double>& buf , bool unpack , const S0& s0 , const S&... items )
+  {
+    sum_batch_pack<typename S0::T2>( s0.dest , buf , unpack , (typename WordType<typename S0::T2>::Type_t*)0 );
+    sum_batch_pack_all( buf , unpack , items... );
+  }
+
+
+  template<class... S>
+  void sum_batch( const Subset& s , const S&... items )
+  {
+    if (FuseHasMap<S...>::value) {
+      sum_batch_single( s , items... );
+      return;
+    }
+
+    static CUfunction function;
+
+    if (function == NULL)
+      function = jit_loaded_function( function_sum_batch_build( items... ) );
+
+    const int size_per_thread = SumBatchSize<S...>::value;
+
+    unsigned actsize=s.numSiteTable();
+
+    unsigned numThreads = DeviceParams::Instance().getMaxBlockX();
+    while ((numThreads*size_per_thread > DeviceParams::Instance().getMaxSMem()) || (numThreads > actsize)) {
+      numThreads >>= 1;
+    }
+    unsigned numBlocks=(int)ceil(float(actsize)/numThreads);
+
+    if (numBlocks > DeviceParams::Instance().getMaxGridX()) {
+      QDP_error_exit( "sum_batch numBlocks(%d) > maxGridX(%d)",numBlocks,(int)DeviceParams::Instance().getMaxGridX());
+    }
+
+    int shared_mem_usage = numThreads*size_per_thread;
+
+    std::vector<int> out_ids;
+    sum_batch_alloc( numBlocks , out_ids , items... );
+
+    function_sum_batch_exec( function , s , actsize , numThreads , numBlocks , shared_mem_usage , out_ids , items... );
+
+    if (numBlocks > 1)
+      sum_batch_finish( numBlocks , out_ids , 0 , items... );
+
+    if (QMP_get_number_of_nodes() > 1) {
+      std::vector<double> buf;
+      sum_batch_pack_all( buf , false , items... );
+      QDPInternal::globalSumArray( buf.data() , buf.size() );
+      sum_batch_pack_all( buf , true , items... );
+    }
+  }
+
+
   //
   // globalMax
   //
@@ -264,7 +495,7 @@ namespace QDP {
     if (function == NULL)
       {
 	//std::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-	function = function_global_max_build<T>();
+	function = jit_loaded_function( function_global_max_build<T>() );
 	//std::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
       }
     else
@@ -1,31 +1,537 @@
 #include "qdp.h"
+#include "qdp_ptx_db.h"
 
 namespace QDP {
 
-  struct tune_t {
-    tune_t(): cfg(0),best(0),best_time(0.0) {}
-    tune_t(int cfg,int best,double best_time): cfg(cfg),best(best),best_time(best_time) {}
-    int    cfg;
-    int    best;
+  namespace tune_opt {
+    std::string strategy = "halving";
+    double budget = 500000.0;   // time spent in trials per kernel (microseconds)
+  }
+
+  void jit_tune_set_strategy( const char * c_str )
+  {
+    std::string s( c_str );
+    if (s != "halving" && s != "coordinate" && s != "exhaustive")
+      QDP_error_exit("Unknown autotuning strategy %s (halving, coordinate, exhaustive)",c_str);
+    QDP_info_primary("Autotuning strategy = %s",c_str);
+    tune_opt::strategy = s;
+  }
+
+  void jit_tune_set_budget( int ms )
+  {
+    QDP_info_primary("Autotuning budget per kernel = %d ms",ms);
+    tune_opt::budget = 1000.0 * ms;
+  }
+
+
+  namespace {
+    const double tune_slowdown = 1.33;
+
+    launch_cfg_t default_cfg( const tune_space_t& space )
+    {
+      launch_cfg_t cfg;
+      cfg.block = space.max_block;
+      return cfg;
+    }
+  }
+
+
+  //
+  // Halves the block size starting from the maximum and stops at the
+  // first slowdown of more than 33%.
+  //
+  class HalvingTuneStrategy: public TuneStrategy {
+  public:
+    HalvingTuneStrategy( const tune_space_t& space ): space(space), best_time(0.0) {}
+
+    launch_cfg_t first() {
+      cur = default_cfg( space );
+      return cur;
+    }
+
+    bool next( double time , launch_cfg_t& cfg ) {
+      if (!space.vary_block)
+	return false;
+
+      if (time < 0.0) {
+	cur.block >>= 1;
+	cfg = cur;
+	return cur.block > 0;
+      }
+
+      if (time < best_time || best_time == 0.0)
+	best_time = time;
+
+      // If time is much greater than our best time
+      // we are in the rising part of the performance 
+      // profile and stop searching any further
+      if (time > tune_slowdown * best_time || cur.block == 1)
+	return false;
+
+      cur.block >>= 1;
+      cfg = cur;
+      return true;
+    }
+
+  private:
+    tune_space_t space;
+    launch_cfg_t cur;
+    double best_time;
+  };
+
+
+  //
+  // Tunes one dimension after the other starting from the best
+  // configuration found so far: block size, sites per thread, grid
+  // shape, cache preference. Block size and sites per thread are
+  // searched until the first slowdown of more than 33%.
+  //
+  class CoordinateTuneStrategy: public TuneStrategy {
+  public:
+    CoordinateTuneStrategy( const tune_space_t& space ): space(space), dim(-1), pos(0), best_time(-1.0) {
+      best = default_cfg( space );
+    }
+
+    launch_cfg_t first() {
+      if (!advance())
+	return best;
+      return cand[pos];
+    }
+
+    bool next( double time , launch_cfg_t& cfg ) {
+      if (dim >= n_dims)
+	return false;
+
+      const launch_cfg_t& cur = cand[pos];
+
+      if (time >= 0.0 && (time < best_time || best_time < 0.0)) {
+	best = cur;
+	best_time = time;
+      }
+
+      bool ordered = dim == 0 || dim == 1;
+      bool stop = ordered && time >= 0.0 && time > tune_slowdown * best_time;
+
+      // Larger sites per thread fail just the same
+      if (dim == 1 && time < 0.0)
+	stop = true;
+
+      if (stop)
+	pos = cand.size();
+      else
+	++pos;
+
+      if (pos >= cand.size() && !advance())
+	return false;
+
+      cfg = cand[pos];
+      return true;
+    }
+
+  private:
+    static const int n_dims = 4;
+
+    // Move on to the next dimension with something to try
+    bool advance() {
+      while (++dim < n_dims) {
+	cand.clear();
+	pos = 0;
+	launch_cfg_t c = best;
+	switch (dim) {
+	case 0:
+	  if (space.vary_block)
+	    for ( c.block = space.max_block ; c.block > 0 ; c.block >>= 1 )
+	      cand.push_back( c );
+	  break;
+	case 1:
+	  if (space.vary_spt)
+	    for ( c.spt = 2 ; c.spt <= 16 ; c.spt <<= 1 )
+	      cand.push_back( c );
+	  break;
+	case 2:
+	  if (space.vary_shape) {
+	    c.square = !best.square;
+	    cand.push_back( c );
+	  }
+	  break;
+	case 3:
+	  if (space.vary_cache)
+	    for ( int cache : { CU_FUNC_CACHE_PREFER_L1 , CU_FUNC_CACHE_PREFER_SHARED , CU_FUNC_CACHE_PREFER_EQUAL } ) {
+	      c.cache = cache;
+	      cand.push_back( c );
+	    }
+	  break;
+	}
+	if (!cand.empty())
+	  return true;
+      }
+      return false;
+    }
+
+    tune_space_t space;
+    int dim;
+    size_t pos;
+    std::vector< launch_cfg_t > cand;
+    launch_cfg_t best;
     double best_time;
   };
 
+
+  //
+  // Tries all combinations (within the time budget)
+  //
+  class ExhaustiveTuneStrategy: public TuneStrategy {
+  public:
+    ExhaustiveTuneStrategy( const tune_space_t& space ): pos(0) {
+      launch_cfg_t c = default_cfg( space );
+
+      std::vector<int> blocks;
+      if (space.vary_block)
+	for ( int b = space.max_block ; b > 0 ; b >>= 1 )
+	  blocks.push_back( b );
+      else
+	blocks.push_back( c.block );
+
+      std::vector<int> spts( 1 , 1 );
+      if (space.vary_spt)
+	spts = { 1 , 2 , 4 , 8 , 16 };
+
+      std::vector<int> shapes( 1 , 0 );
+      if (space.vary_shape)
+	shapes = { 0 , 1 };
+
+      std::vector<int> caches( 1 , CU_FUNC_CACHE_PREFER_NONE );
+      if (space.vary_cache)
+	caches = { CU_FUNC_CACHE_PREFER_NONE , CU_FUNC_CACHE_PREFER_L1 , CU_FUNC_CACHE_PREFER_SHARED , CU_FUNC_CACHE_PREFER_EQUAL };
+
+      for ( int b : blocks )
+	for ( int spt : spts )
+	  for ( int shape : shapes )
+	    for ( int cache : caches ) {
+	      c.block = b;
+	      c.spt = spt;
+	      c.square = shape;
+	      c.cache = cache;
+	      cand.push_back( c );
+	    }
+    }
+
+    launch_cfg_t first() {
+      return cand[0];
+    }
+
+    bool next( double time , launch_cfg_t& cfg ) {
+      if (++pos >= cand.size())
+	return false;
+      cfg = cand[pos];
+      return true;
+    }
+
+  private:
+    size_t pos;
+    std::vector< launch_cfg_t > cand;
+  };
+
+
+  TuneStrategy* jit_tune_create_strategy( const tune_space_t& space )
+  {
+    if (tune_opt::strategy == "coordinate")
+      return new CoordinateTuneStrategy( space );
+    if (tune_opt::strategy == "exhaustive")
+      return new ExhaustiveTuneStrategy( space );
+    return new HalvingTuneStrategy( space );
+  }
+
+
+
+  struct tune_t {
+    tune_t(): settled(false), best_time(-1.0), spent(0.0), applied_cache(CU_FUNC_CACHE_PREFER_NONE) {}
+    bool                            settled;
+    std::unique_ptr< TuneStrategy > strategy;
+    launch_cfg_t                    cfg;        // next trial
+    launch_cfg_t                    best;
+    double                          best_time;
+    double                          spent;      // time spent in trials
+    int                             applied_cache;
+  };
+
   std::map< CUfunction , tune_t > mapTune;
 
 
-  void LaunchPrintArgs( std::vector<void*>& args )
+  //
+  // Tuning results that outlive the process. The key is the device
+  // name, the kernel identity (see get_ptx_db_id, which includes the
+  // compute capability and the local volume) and the thread count.
+  // A different device or local volume thus never matches an old
+  // entry. The value is the settled configuration
+  // (block size, sites per thread, grid shape, cache preference).
+  //
+  namespace tune_db {
+    bool enabled = false;
+    bool opened = false;
+    std::string fname;
+    PTXDB db;
+    int hits = 0;
+  }
+
+  void jit_tune_set_db( const char * c_str )
+  {
+    tune_db::enabled = true;
+    tune_db::fname = std::string( c_str );
+  }
+
+  bool jit_tune_db_enabled() { return tune_db::enabled; }
+  std::string jit_tune_db_fname() { return tune_db::fname; }
+  int jit_tune_db_size() { return tune_db::opened ? tune_db::db.size() : 0; }
+  int jit_tune_db_hits() { return tune_db::hits; }
+
+
+  std::string jit_tune_db_key( CUfunction function , int th_count )
+  {
+    std::string id = getIdfromCUFunc( function );
+    if ( id.empty() )
+      return id;
+
+    std::ostringstream oss;
+    oss << DeviceParams::Instance().getDeviceName() << "_" << id << "_" << th_count;
+    return oss.str();
+  }
+
+
+  // Opened on first use, the device properties are known by then.
+  // Without leases, tuning a kernel twice is cheaper than waiting.
+  PTXDB* jit_tune_db()
+  {
+    if (!tune_db::enabled)
+      return NULL;
+    if (!tune_db::opened) {
+      tune_db::db.open( tune_db::fname , false );
+      tune_db::opened = true;
+    }
+    return &tune_db::db;
+  }
+
+
+  bool jit_tune_db_lookup( CUfunction function , int th_count , const tune_space_t& space , launch_cfg_t& cfg )
+  {
+    PTXDB* db = jit_tune_db();
+    if (!db)
+      return false;
+
+    std::string key = jit_tune_db_key( function , th_count );
+    std::string val;
+    if ( key.empty() || !db->find( key , val ) )
+      return false;
+
+    launch_cfg_t c = default_cfg( space );
+    int square = 0;
+    if ( sscanf( val.c_str() , "%d %d %d %d" , &c.block , &c.spt , &square , &c.cache ) < 1 )
+      return false;
+    c.square = square;
+
+    if ( c.block <= 0 || c.block > space.max_block || ( !space.vary_block && c.block != space.max_block ) )
+      return false;
+    if ( c.spt < 1 || ( !space.vary_spt && c.spt != 1 ) )
+      return false;
+    if ( !space.vary_shape && c.square )
+      return false;
+
+    cfg = c;
+    tune_db::hits++;
+    return true;
+  }
+
+
+  void jit_tune_db_store( CUfunction function , int th_count , const launch_cfg_t& cfg )
+  {
+    PTXDB* db = jit_tune_db();
+    if (!db)
+      return;
+
+    std::string key = jit_tune_db_key( function , th_count );
+    if ( key.empty() )
+      return;
+
+    // Other ranks tune the same kernels
+    db->refresh();
+    if ( db->contains( key ) )
+      return;
+
+    std::ostringstream oss;
+    oss << cfg.block << " " << cfg.spt << " " << (int)cfg.square << " " << cfg.cache;
+    db->append( key , oss.str() );
+  }
+
+
+  tune_t& jit_get_tune( CUfunction handle , CUfunction function , int th_count , const tune_space_t& space )
+  {
+    std::map< CUfunction , tune_t >::iterator it = mapTune.find( function );
+    if (it != mapTune.end())
+      return it->second;
+
+    tune_t& tune = mapTune[function];
+    if ( jit_tune_db_lookup( handle , th_count , space , tune.best ) ) {
+      tune.settled = true;
+    } else {
+      tune.strategy.reset( jit_tune_create_strategy( space ) );
+      tune.cfg = tune.strategy->first();
+    }
+    return tune;
+  }
+
+
+  // Records the result of a trial (time < 0 if the launch failed)
+  // and prepares the next one
+  void jit_tune_update( tune_t& tune , CUfunction handle , int th_count , double time )
+  {
+    if (time >= 0.0) {
+      tune.spent += time;
+      if (time < tune.best_time || tune.best_time < 0.0) {
+	tune.best_time = time;
+	tune.best = tune.cfg;
+      }
+    }
+
+    bool more = tune.strategy->next( time , tune.cfg );
+
+    // Out of time, settle for the best so far
+    if (more && tune.best_time >= 0.0 && tune.spent > tune_opt::budget)
+      more = false;
+
+    if (!more) {
+      if (tune.best_time < 0.0) {
+	QDP_error_exit("Kernel launch failed for all configurations. Giving up.");
+      }
+      tune.settled = true;
+      tune.strategy.reset();
+      jit_tune_db_store( handle , th_count , tune.best );
+    }
+  }
+
+
+  kernel_geom_t jit_tune_geom( int th_count , const launch_cfg_t& cfg )
+  {
+    int threads = ( th_count + cfg.spt - 1 ) / cfg.spt;
+
+    if (!cfg.square)
+      return getGeom( threads , cfg.block );
+
+    kernel_geom_t geom;
+    int blocks = ( threads + cfg.block - 1 ) / cfg.block;
+    geom.threads_per_block = cfg.block;
+    geom.Nblock_x = std::min( (int)DeviceParams::Instance().getMaxGridX() , (int)std::ceil( std::sqrt( (double)blocks ) ) );
+    geom.Nblock_y = ( blocks + geom.Nblock_x - 1 ) / geom.Nblock_x;
+    return geom;
+  }
+
+
+  void jit_tune_apply_cache( tune_t& tune , CUfunction function , int cache )
   {
-    QDP_info("Number of kernel arguments: %d",(int)args.size());
-    int i=0;
+    if (tune.applied_cache == cache)
+      return;
+    CUresult result = cuFuncSetCacheConfig( function , (CUfunc_cache)cache );
+    if (result != CUDA_SUCCESS) {
+      CudaCheckResult(result);
+      QDP_error_exit("cuFuncSetCacheConfig failed");
+    }
+    tune.applied_cache = cache;
+  }
+
+
+  //
+  // Host target: the function handle is the entry point of the
+  // generated driver which loops over the sites [lo,hi)
+  //
+  typedef void (*host_kernel_t)( void** args , int lo , int hi , jit_host_block_t* block );
+
+  struct host_launch_t {
+    host_kernel_t kernel;
+    void**        args;
+    int           threads;
+    int           blocks;
+    int           shared_mem_usage;
+  };
+
+  void host_launch_range( int lo , int hi , int myId , host_launch_t* a )
+  {
+    if (lo < hi)
+      a->kernel( a->args , lo , hi , NULL );
+  }
+
+  // The range is in blocks. Each block runs completely on this host
+  // thread, the blocks share one buffer as shared memory.
+  void host_launch_block_range( int lo , int hi , int myId , host_launch_t* a )
+  {
+    if (lo >= hi)
+      return;
+
+    // One buffer per host thread, it only grows
+    thread_local std::vector<char> shared;
+    if ( shared.size() < (size_t)std::max( a->shared_mem_usage , 1 ) )
+      shared.resize( std::max( a->shared_mem_usage , 1 ) );
+
+    jit_host_block_t block;
+    block.shared = shared.data();
+    block.ntid   = a->threads;
+    block.nctaid = a->blocks;
+
+    for ( int b = lo ; b < hi ; ++b )
+      a->kernel( a->args , b * a->threads , (b+1) * a->threads , &block );
+  }
+
+  void jit_launch_host( CUfunction function , int th_count , void** args )
+  {
+    host_launch_t a;
+    a.kernel = reinterpret_cast<host_kernel_t>( function );
+    a.args   = args;
+    dispatch_to_threads( th_count , a , host_launch_range );
+  }
+
+  void jit_launch_host_block( CUfunction function , int blocks , int threads , int shared_mem_usage , void** args )
+  {
+    host_launch_t a;
+    a.kernel           = reinterpret_cast<host_kernel_t>( function );
+    a.args             = args;
+    a.threads          = threads;
+    a.blocks           = blocks;
+    a.shared_mem_usage = shared_mem_usage;
+    dispatch_to_threads( blocks , a , host_launch_block_range );
+  }
+
+
+  void LaunchPrintArgs( void** args , int nargs )
+  {
+    QDP_info("Number of kernel arguments: %d",nargs);
     QDP_info("            bool          int     pointer");
-    for (void *addr : args)	
-      QDP_info("%2d: %12d %12d %p",i++,*(bool*)addr,*(int*)addr,*(void**)addr);
+    for (int i = 0 ; i < nargs ; ++i) {
+      void *addr = args[i];
+      QDP_info("%2d: %12d %12d %p",i,*(bool*)addr,*(int*)addr,*(void**)addr);
+    }
     QDP_info("Device pool info:");
     //CUDADevicePoolAllocator::Instance().printPoolInfo();
     //QDP_get_global_cache().get_allocator().printPoolInfo();
   }
 
 
+  // args has room for one more parameter after the last
+  CUresult jit_launch_cfg( tune_t& tune , CUfunction function , int th_count , const launch_cfg_t& cfg , void** args , int nargs , kernel_geom_t& now )
+  {
+    jit_tune_apply_cache( tune , function , cfg.cache );
+
+    now = jit_tune_geom( th_count , cfg );
+
+    // Sites per thread is the last kernel argument (see llvm_build_driver),
+    // kernels with thread block features don't have it
+    int spt = cfg.spt;
+    args[nargs] = llvm_function_takes_spt( function ) ? &spt : NULL;
+    CUresult result = cuLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    cfg.block,1,1,    0, 0, args , 0);
+
+    return result;
+  }
+
+
+  void jit_launch_args( CUfunction function , int th_count , void** args , int nargs );
+
   void jit_launch(CUfunction function,int th_count,std::vector<int>& ids)
   {
     //QDP_get_global_cache().printLockSet();
@@ -35,34 +541,66 @@ namespace QDP {
     //   QDPIO::cout << i << ", ";
     // QDPIO::cout << "\n";
     
-     std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
+    QDP_get_global_cache().setKernelHandle( function );
+    std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
+    int nargs = args.size();
+    args.push_back( NULL );  // sites per thread
+
+    jit_launch_args( function , th_count , args.data() , nargs );
+  }
+
+
+  void jit_launch(CUfunction function,int th_count,QDPJitArgs& args)
+  {
+    QDP_get_global_cache().setKernelHandle( function );
+    QDP_get_global_cache().get_kernel_args( args );
+
+    jit_launch_args( function , th_count , args.data() , args.size() );
+  }
+
+
+  void jit_launch_args( CUfunction function , int th_count , void** args , int nargs )
+  {
+    // Kernel identity is recorded for the handle returned by the build function
+    CUfunction handle = function;
+
+    // Wait for the kernel if it is compiled in the background
+    function = jit_resolve_function( function );
     
     // Check for thread count equals zero
     // This can happen, when inner count is zero
     if ( th_count == 0 )
       return;
 
-    if (mapTune.count(function) == 0) {
-      mapTune[function] = tune_t( DeviceParams::Instance().getMaxBlockX() , 0 , 0.0 );
+    if ( DeviceParams::Instance().getHostTarget() ) {
+      jit_launch_host( function , th_count , args );
+      return;
     }
 
+    tune_space_t space;
+    space.max_block  = DeviceParams::Instance().getMaxBlockX();
+    space.vary_block = true;
+    space.vary_spt   = llvm_function_takes_spt( function );
+    space.vary_shape = true;
+    space.vary_cache = true;
 
-    tune_t& tune = mapTune[function];
+    tune_t& tune = jit_get_tune( handle , function , th_count , space );
 
+    kernel_geom_t now;
 
-    if (tune.cfg == -1) {
-      kernel_geom_t now = getGeom( th_count , tune.best );
+    if (tune.settled) {
+      const launch_cfg_t& cfg = tune.best;
 
-      //QDP_info("CUDA launch (settled): grid=(%u,%u,%u), block=(%d,%u,%u) ",now.Nblock_x,now.Nblock_y,1,    tune.best,1,1 );
+      //QDP_info("CUDA launch (settled): grid=(%u,%u,%u), block=(%d,%u,%u) ",now.Nblock_x,now.Nblock_y,1,    cfg.block,1,1 );
 	
-      CUresult result = cuLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    tune.best,1,1,    0, 0, &args[0] , 0);
+      CUresult result = jit_launch_cfg( tune , function , th_count , cfg , args , nargs , now );
 
       if (result != CUDA_SUCCESS) {
 	CudaCheckResult(result);
-	LaunchPrintArgs(args);
+	LaunchPrintArgs(args,nargs);
 	QDPIO::cout << getPTXfromCUFunc(function);
-	QDP_error_exit("CUDA launch error (after successful tuning): grid=(%u,%u,%u), block=(%d,%u,%u) ",
-		       now.Nblock_x,now.Nblock_y,1,    tune.best,1,1 );
+	QDP_error_exit("CUDA launch error (after successful tuning): grid=(%u,%u,%u), block=(%d,%u,%u), sites per thread=%d ",
+		       now.Nblock_x,now.Nblock_y,1,    cfg.block,1,1 , cfg.spt );
       }
 
       //QDP_get_global_cache().releasePrevLockSet();
@@ -71,33 +609,33 @@ namespace QDP {
       result = cuCtxSynchronize();
       if (result != CUDA_SUCCESS) {
 	CudaCheckResult(result);
-	LaunchPrintArgs(args);
+	LaunchPrintArgs(args,nargs);
 	QDPIO::cout << getPTXfromCUFunc(function) << "\n";
-	QDP_error_exit("CUDA launch error (after successful autotune, on sync): grid=(%u,%u,%u), block=(%d,%u,%u) ",
-		       now.Nblock_x,now.Nblock_y,1,    tune.best,1,1 );
+	QDP_error_exit("CUDA launch error (after successful autotune, on sync): grid=(%u,%u,%u), block=(%d,%u,%u), sites per thread=%d ",
+		       now.Nblock_x,now.Nblock_y,1,    cfg.block,1,1 , cfg.spt );
       }
     } else {
 
-      CUresult result = CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES;
-      CUresult result_sync;
-      double time;
-
-      while (result != CUDA_SUCCESS && tune.cfg > 0) {
-	kernel_geom_t now = getGeom( th_count , tune.cfg );
+      // Try configurations until one launches, this launch has to happen.
+      // The search may settle on a failed trial, then the best one so far
+      // is launched.
+      while (true) {
+	bool trial = !tune.settled;
+	launch_cfg_t cfg = trial ? tune.cfg : tune.best;
 	StopWatch w;
 
 	w.start();
 
-	//QDP_info("CUDA launch (trying): grid=(%u,%u,%u), block=(%d,%u,%u) ",now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1 );
+	//QDP_info("CUDA launch (trying): grid=(%u,%u,%u), block=(%d,%u,%u) ",now.Nblock_x,now.Nblock_y,1,    cfg.block,1,1 );
 
-	result = cuLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1,    0, 0, &args[0] , 0);
+	CUresult result = jit_launch_cfg( tune , function , th_count , cfg , args , nargs , now );
 
 	if (result != CUDA_SUCCESS && result != CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES) {
 	  CudaCheckResult(result);
-	  LaunchPrintArgs(args);
+	  LaunchPrintArgs(args,nargs);
 	  QDPIO::cout << getPTXfromCUFunc(function);
-	  QDP_error_exit("CUDA launch error: grid=(%u,%u,%u), block=(%d,%u,%u) ",
-			 now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1 );
+	  QDP_error_exit("CUDA launch error: grid=(%u,%u,%u), block=(%d,%u,%u), sites per thread=%d ",
+			 now.Nblock_x,now.Nblock_y,1,    cfg.block,1,1 , cfg.spt );
   	}
 
 	if (result == CUDA_SUCCESS) {
@@ -105,43 +643,76 @@ namespace QDP {
 	  //QDP_get_global_cache().releasePrevLockSet();
 	  //QDP_get_global_cache().newLockSet();
 
-	  result_sync = cuCtxSynchronize();
+	  CUresult result_sync = cuCtxSynchronize();
 	  if (result_sync != CUDA_SUCCESS) {
 	    CudaCheckResult(result_sync);
-	    LaunchPrintArgs(args);
+	    LaunchPrintArgs(args,nargs);
 	    QDPIO::cout << getPTXfromCUFunc(function);
-	    QDP_error_exit("CUDA launch error (during autotune, on sync): grid=(%u,%u,%u), block=(%d,%u,%u) ",
-			   now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1 );
+	    QDP_error_exit("CUDA launch error (during autotune, on sync): grid=(%u,%u,%u), block=(%d,%u,%u), sites per thread=%d ",
+			   now.Nblock_x,now.Nblock_y,1,    cfg.block,1,1 , cfg.spt );
 	  }
 	}
 
 	w.stop();
 
-	time = w.getTimeInMicroseconds();
-	if (result != CUDA_SUCCESS)
-	  tune.cfg >>= 1;
-      }
-
-      if (tune.cfg == 0) {
-	CudaCheckResult(result);
-	QDP_error_exit("Kernel launch failed even for block size 1. Giving up.");
-      }
+	if (trial)
+	  jit_tune_update( tune , handle , th_count , result == CUDA_SUCCESS ? w.getTimeInMicroseconds() : -1.0 );
+	else if (result != CUDA_SUCCESS) {
+	  CudaCheckResult(result);
+	  QDP_error_exit("CUDA launch error (best configuration): grid=(%u,%u,%u), block=(%d,%u,%u), sites per thread=%d ",
+			 now.Nblock_x,now.Nblock_y,1,    cfg.block,1,1 , cfg.spt );
+	}
 
-      if (time < tune.best_time || tune.best_time == 0.0) {
-	tune.best_time = time;
-	tune.best = tune.cfg;
+	if (result == CUDA_SUCCESS)
+	  break;
       }
 
-      // If time is much greater than our best time
-      // we are in the rising part of the performance 
-      // profile and stop searching any further
-      tune.cfg = time > 1.33 * tune.best_time || tune.cfg == 1 ? -1 : tune.cfg >> 1;
-
       //QDP_info("time = %f,  cfg = %d,  best = %d,  best_time = %f ", time,tune.cfg,tune.best,tune.best_time );
     }
   }
 
 
+  void jit_launch_explicit( CUfunction function , int th_count , int threads , int shared_mem_usage , QDPJitArgs& jit_args )
+  {
+    QDP_get_global_cache().setKernelHandle( function );
+    QDP_get_global_cache().get_kernel_args( jit_args );
+    void** args = jit_args.data();
+
+    if ( DeviceParams::Instance().getHostTarget() ) {
+      jit_launch_host_block( function , ( th_count + threads - 1 ) / threads , threads , shared_mem_usage , args );
+      return;
+    }
+
+    CUfunction handle = function;
+    function = jit_resolve_function( function );
+
+    tune_space_t space;
+    space.max_block  = threads;
+    space.vary_block = false;
+    space.vary_spt   = false;
+    space.vary_shape = false;
+    space.vary_cache = true;
+
+    tune_t& tune = jit_get_tune( handle , function , th_count , space );
+
+    // The block size is given. A settled configuration from another
+    // block size only contributes the cache preference.
+    launch_cfg_t cfg = tune.settled ? tune.best : tune.cfg;
+    jit_tune_apply_cache( tune , function , cfg.cache );
+
+    kernel_geom_t now = getGeom( th_count , threads );
+
+    StopWatch w;
+    w.start();
+
+    // Synchronizes
+    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, args , 0);
+
+    w.stop();
+
+    if (!tune.settled)
+      jit_tune_update( tune , handle , th_count , w.getTimeInMicroseconds() );
+  }
 
 
 }
@@ -2,10 +2,17 @@
 
 #include <map>
 #include <list>
+#include <queue>
 #include <functional>
+#include <algorithm>
+#include <cstring>
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+
+#include <sys/mman.h>
+#include <unistd.h>
 
 
 
@@ -104,12 +111,214 @@ namespace QDP
     Status status;
     int    lockCount;
     list<int>::iterator iterTrack;
+    unsigned long touched;   // stamp of the last use, orders the tracker shards
     LayoutFptr fptr;
     JitParamUnion param;
     QDPCache::JitParamType param_type;
     std::vector<int> multi;
+    bool   dirty;            // device copy was written since the last host sync
+    bool   evicted;          // was evicted from the device since last upload
+    unsigned long uses;      // kernel uses, aged by the eviction policy
+    unsigned long lastEpoch; // last kernel argument set this was part of
+    bool   prefetching;      // upload on the transfer stream not waited for
+    MultiTable* table;       // device pointer table of a multi-id
+    bool   inArena = false;  // device memory is in a scalar arena slab
+    bool   mapped = false;   // host memory is a mapped file
+    const char* site;        // allocation label, NULL for multi-ids and JIT parameters
+    SiteStats* siteStats;    // statistics of the label
+
+    // A recycled id must not inherit anything from its previous entry
+    void reset( int id )
+    {
+      Id         = id;
+      size       = 0;
+      flags      = Flags::Empty;
+      hstPtr     = NULL;
+      devPtr     = NULL;
+      status     = Status::undef;
+      lockCount  = 0;
+      touched    = 0;
+      fptr       = NULL;
+      param.int64_ = 0;
+      param_type = JitParamType::int64_;
+      multi.clear();
+      dirty      = false;
+      evicted    = false;
+      uses       = 0;
+      lastEpoch  = 0;
+      prefetching = false;
+      table      = NULL;
+      inArena    = false;
+      mapped     = false;
+      site       = NULL;
+      siteStats  = NULL;
+    }
+  };
+
+
+  QDPCache::EntryTable::EntryTable(): count(0)
+  {
+    for ( int i = 0 ; i < max_chunks ; ++i )
+      chunks[i].store( NULL , std::memory_order_relaxed );
+  }
+
+  QDPCache::Entry& QDPCache::EntryTable::operator[]( int id )
+  {
+    return chunks[ id >> chunk_bits ].load( std::memory_order_acquire )[ id & ( chunk_size - 1 ) ];
+  }
+
+  size_t QDPCache::EntryTable::size() const
+  {
+    return count.load( std::memory_order_acquire );
+  }
+
+  void QDPCache::EntryTable::grow()
+  {
+    size_t n = count.load( std::memory_order_relaxed );
+    if ( n / chunk_size >= max_chunks )
+      QDP_error_exit("cache: out of ids (%lu)",(unsigned long)n);
+    chunks[ n / chunk_size ].store( new Entry[ chunk_size ] , std::memory_order_release );
+    count.store( n + chunk_size , std::memory_order_release );
+  }
+
+
+  //
+  // Free ids of a thread, taken from and returned to the shared
+  // registry in batches
+  //
+  struct QDPCacheLocalIds
+  {
+    enum { batch = 64 };
+    std::vector<int> ids;
+    ~QDPCacheLocalIds() {
+      QDPCache& c = QDP_get_global_cache();
+      std::lock_guard<std::mutex> lock( c.mtxRegistry );
+      for ( auto i : ids )
+	c.stackFree.push( i );
+    }
   };
 
+  namespace {
+    thread_local QDPCacheLocalIds local_ids;
+    thread_local const char*      cache_site = NULL;
+
+    template<class T>
+    void atomic_max( std::atomic<T>& a , T v )
+    {
+      T cur = a.load( std::memory_order_relaxed );
+      while ( cur < v && !a.compare_exchange_weak( cur , v , std::memory_order_relaxed ) )
+	;
+    }
+  }
+
+
+  QDPCacheSite::QDPCacheSite( const char* label ): prev( cache_site )
+  {
+    cache_site = label;
+  }
+
+  QDPCacheSite::~QDPCacheSite()
+  {
+    cache_site = prev;
+  }
+
+
+  // Labels are few, each thread remembers the ones it used
+  QDPCache::SiteStats* QDPCache::siteStats( const char* site )
+  {
+    thread_local std::map< const char* , SiteStats* > local;
+
+    auto l = local.find( site );
+    if ( l != local.end() )
+      return l->second;
+
+    std::lock_guard<std::mutex> lock( mtxSite );
+    SiteStats*& s = mapSite[ site ];
+    if (!s) {
+      s = new SiteStats;
+      s->live = 0;
+      s->peak = 0;
+      s->largest = 0;
+      s->entries = 0;
+    }
+    local[ site ] = s;
+    return s;
+  }
+
+
+  void QDPCache::track( Entry& e )
+  {
+    {
+      TrackerShard& t = shard( e.Id );
+      std::lock_guard<std::mutex> lock( t.mtx );
+      e.iterTrack = t.lst.insert( t.lst.end() , e.Id );
+      e.touched = ++track_stamp;
+    }
+
+    e.siteStats = e.site ? siteStats( e.site ) : NULL;
+    if (e.siteStats) {
+      SiteStats& s = *e.siteStats;
+      atomic_max( s.peak , s.live += e.size );
+      atomic_max( s.largest , e.size );
+      s.entries++;
+    }
+  }
+
+  void QDPCache::untrack( Entry& e )
+  {
+    {
+      TrackerShard& t = shard( e.Id );
+      std::lock_guard<std::mutex> lock( t.mtx );
+      t.lst.erase( e.iterTrack );
+    }
+
+    if (e.siteStats)
+      e.siteStats->live -= e.size;
+  }
+
+  void QDPCache::touch( Entry& e )
+  {
+    TrackerShard& t = shard( e.Id );
+    std::lock_guard<std::mutex> lock( t.mtx );
+    t.lst.splice( t.lst.end(), t.lst , e.iterTrack );
+    e.touched = ++track_stamp;
+  }
+
+  // Each shard is kept in order of last use, merging the shards by
+  // stamp is linear in the number of entries
+  void QDPCache::trackedIds( std::vector<int>& ids )
+  {
+    typedef std::pair< unsigned long , int > head_t;   // stamp, shard
+    std::priority_queue< head_t , std::vector<head_t> , std::greater<head_t> > heads;
+    std::unique_lock<std::mutex> locks[ tracker_shards ];
+    list<int>::const_iterator pos[ tracker_shards ];
+    size_t count = 0;
+
+    for ( int i = 0 ; i < tracker_shards ; ++i ) {
+      locks[i] = std::unique_lock<std::mutex>( tracker[i].mtx );
+      pos[i] = tracker[i].lst.begin();
+      count += tracker[i].lst.size();
+      if ( pos[i] != tracker[i].lst.end() )
+	heads.push( head_t( vecEntry[ *pos[i] ].touched , i ) );
+    }
+
+    ids.clear();
+    ids.reserve( count );
+    while ( !heads.empty() ) {
+      int i = heads.top().second;
+      heads.pop();
+      ids.push_back( *pos[i] );
+      if ( ++pos[i] != tracker[i].lst.end() )
+	heads.push( head_t( vecEntry[ *pos[i] ].touched , i ) );
+    }
+  }
+
+  bool QDPCache::poolAllocate( void** ptr , size_t size )
+  {
+    std::lock_guard<std::mutex> lock( mtxPool );
+    return pool_allocator.allocate( ptr , size );
+  }
+
 
 
 
@@ -120,10 +329,11 @@ namespace QDP
   }
 
     
+  // mtxRegistry must be held
   void QDPCache::growStack()
   {
-    const int portion = 1024;
-    vecEntry.resize( vecEntry.size() + portion );
+    const int portion = EntryTable::chunk_size;
+    vecEntry.grow();
     for ( int i = 0 ; i < portion ; i++ ) {
       stackFree.push( vecEntry.size()-i-1 );
     }
@@ -144,32 +354,54 @@ namespace QDP
 
   int QDPCache::getNewId()
   {
-    if (stackFree.size() == 0) {
-      growStack();
+    std::vector<int>& local = local_ids.ids;
+
+    if (local.empty()) {
+      std::lock_guard<std::mutex> lock( mtxRegistry );
+      for ( int i = 0 ; i < QDPCacheLocalIds::batch ; ++i ) {
+	if (stackFree.size() == 0) {
+	  growStack();
+	}
+	local.push_back( stackFree.top() );
+	stackFree.pop();
+      }
     }
 
-    int Id = stackFree.top();
+    int Id = local.back();
     assert( vecEntry.size() > Id );
 
-    stackFree.pop();
+    local.pop_back();
 
     return Id;
   }
 
 
+  void QDPCache::releaseId( int id )
+  {
+    std::vector<int>& local = local_ids.ids;
+
+    local.push_back( id );
+
+    if ( local.size() > 2 * QDPCacheLocalIds::batch ) {
+      std::lock_guard<std::mutex> lock( mtxRegistry );
+      for ( int i = 0 ; i < QDPCacheLocalIds::batch ; ++i ) {
+	stackFree.push( local.back() );
+	local.pop_back();
+      }
+    }
+  }
+
+
   
 
   int QDPCache::addJitParamFloat(float i)
   {
     int Id = getNewId();
     Entry& e = vecEntry[ Id ];
-    e.Id           = Id;
-    e.size         = 0;
+    e.reset( Id );
     e.flags        = Flags::JitParam;
     e.param.float_ = i;
     e.param_type   = JitParamType::float_;
-    e.multi.clear();
-    e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
     return Id;
   }
 
@@ -177,13 +409,10 @@ namespace QDP
   {
     int Id = getNewId();
     Entry& e = vecEntry[ Id ];
-    e.Id            = Id;
-    e.size         = 0;
-    e.flags         = Flags::JitParam;
+    e.reset( Id );
+    e.flags        = Flags::JitParam;
     e.param.double_ = i;
     e.param_type   = JitParamType::double_;
-    e.multi.clear();
-    e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
     return Id;
   }
 
@@ -191,13 +420,10 @@ namespace QDP
   {
     int Id = getNewId();
     Entry& e = vecEntry[ Id ];
-    e.Id           = Id;
-    e.size         = 0;
+    e.reset( Id );
     e.flags        = Flags::JitParam;
     e.param.int_   = i;
     e.param_type   = JitParamType::int_;
-    e.multi.clear();
-    e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
     return Id;
   }
 
@@ -205,13 +431,10 @@ namespace QDP
   {
     int Id = getNewId();
     Entry& e = vecEntry[ Id ];
-    e.Id            = Id;
-    e.size         = 0;
-    e.flags         = Flags::JitParam;
+    e.reset( Id );
+    e.flags        = Flags::JitParam;
     e.param.int64_  = i;
     e.param_type    = JitParamType::int64_;
-    e.multi.clear();
-    e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
     return Id;
   }
 
@@ -219,13 +442,10 @@ namespace QDP
   {
     int Id = getNewId();
     Entry& e = vecEntry[ Id ];
-    e.Id           = Id;
-    e.size         = 0;
+    e.reset( Id );
     e.flags        = Flags::JitParam;
     e.param.bool_  = i;
     e.param_type   = JitParamType::bool_;
-    e.multi.clear();
-    e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
     return Id;
   }
 
@@ -234,21 +454,15 @@ namespace QDP
   {
     int Id = getNewId();
     Entry& e = vecEntry[ Id ];
-    e.Id        = Id;
+    e.reset( Id );
     e.flags     = Flags::Multi;
-    e.status    = Status::undef;
-    e.hstPtr    = NULL;
-    e.devPtr    = NULL;
-    e.fptr      = NULL;
     e.size      = ids.size() * sizeof(void*);
     
-    e.multi.clear();
     e.multi.resize(ids.size());
-    int count=0;
     for( int i = 0 ; i < ids.size() ; ++i )
       e.multi[i] = ids[i];
 
-    e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
+    track( e );
 
     return Id;
   }
@@ -276,19 +490,24 @@ namespace QDP
     int Id = getNewId();
     Entry& e = vecEntry[ Id ];
 
-    while (!pool_allocator.allocate( ptr , n_bytes )) {
-      if (!spill_lru()) {
+    bool compacted = false;
+    while (!poolAllocate( ptr , n_bytes )) {
+      if (!compacted && compact( n_bytes )) {
+	compacted = true;
+	continue;
+      }
+      if (!spill( n_bytes )) {
 	QDP_error_exit("cache allocate_device_static: can't spill LRU object");
       }
     }
 
-    e.Id        = Id;
+    e.reset( Id );
     e.size      = n_bytes;
     e.flags     = Flags::Static;
     e.devPtr    = *ptr;
-    e.multi.clear();
+    e.site      = cache_site ? cache_site : "(device static)";
 
-    e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
+    track( e );
 
     if (track_ptr)
       {
@@ -308,27 +527,22 @@ namespace QDP
     void * hstptr = const_cast<void*>(hstptr_);
     void * devptr = const_cast<void*>(devptr_);
     
-    if (stackFree.size() == 0) {
-      growStack();
-    }
-
-    int Id = stackFree.top();
+    int Id = getNewId();
 
     assert( vecEntry.size() > Id );
     Entry& e = vecEntry[ Id ];
 
-    e.Id        = Id;
+    e.reset( Id );
     e.size      = size;
     e.flags     = flags;
     e.status    = status;
     e.hstPtr    = hstptr;
     e.devPtr    = devptr;
     e.fptr      = func;
-    e.multi.clear();
-
-    e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
+    e.dirty     = true;
+    e.site      = cache_site ? cache_site : ( flags & Flags::Scalar ) ? "(scalar)" : func ? "(lattice)" : "(other)";
 
-    stackFree.pop();
+    track( e );
 
     return Id;
   }
@@ -341,7 +555,8 @@ namespace QDP
     assert( vecEntry.size() > id );
     Entry& e = vecEntry[id];
     
-    lstTracker.erase( e.iterTrack );
+    if ( !( e.flags & Flags::JitParam ) )
+      untrack( e );
 
     if ( !( e.flags & ( Flags::JitParam | Flags::Static | Flags::Multi ) ) )
       {
@@ -357,8 +572,11 @@ namespace QDP
       {
 	e.multi.clear();
       }
+
+    // A stale look-ahead must not upload this entry
+    e.status = Status::undef;
     
-    stackFree.push( id );
+    releaseId( id );
   }
   
 
@@ -396,6 +614,18 @@ namespace QDP
     assert(e.flags != Flags::JitParam);
     assert(e.flags != Flags::Static);
 
+    // The prefetch thread may still read the host copy
+    if (e.prefetching)
+      prefetchWait();
+
+    if (e.mapped) {
+      munmap( e.hstPtr , e.size );
+      bytes_mapped -= e.size;
+      e.mapped = false;
+      e.hstPtr = NULL;
+      return;
+    }
+
     QDP::Allocator::theQDPAllocator::Instance().free( e.hstPtr );
     e.hstPtr=NULL;
   }
@@ -411,6 +641,14 @@ namespace QDP
     
     if (e.hstPtr)
       return;
+
+    if ( !host_mmap_dir.empty() && e.size >= host_mmap_min ) {
+      e.hstPtr = hostMapAllocate( e.size );
+      if (e.hstPtr) {
+	e.mapped = true;
+	return;
+      }
+    }
     
     try {
       e.hstPtr = (void*)QDP::Allocator::theQDPAllocator::Instance().allocate( e.size , QDP::Allocator::DEFAULT );
@@ -431,8 +669,16 @@ namespace QDP
     if (e.devPtr)
       return;
 
-    while (!pool_allocator.allocate( &e.devPtr , e.size )) {
-      if (!spill_lru()) {
+    if ( ( e.flags & Flags::Scalar ) && arenaAllocate( e ) )
+      return;
+
+    bool compacted = false;
+    while (!poolAllocate( &e.devPtr , e.size )) {
+      if (!compacted && compact( e.size )) {
+	compacted = true;
+	continue;
+      }
+      if (!spill( e.size )) {
 	QDP_info("Device pool:");
 	pool_allocator.printListPool();
 	//printLockSets();
@@ -459,6 +705,23 @@ namespace QDP
     if (!e.devPtr)
       return;
 
+    // The table belongs to mapMultiTable
+    if ( e.flags & Flags::Multi ) {
+      releaseMultiTable( e );
+      return;
+    }
+
+    // The slab is reused with its generation
+    if (e.inArena) {
+      e.devPtr = NULL;
+      e.inArena = false;
+      return;
+    }
+
+    if (e.prefetching)
+      prefetchWait();
+
+    std::lock_guard<std::mutex> lock( mtxPool );
     pool_allocator.free( e.devPtr );
     e.devPtr = NULL;
   }
@@ -479,29 +742,55 @@ namespace QDP
     if (e.flags & Flags::Static)
       return;
 
-    // new
-    lstTracker.splice( lstTracker.end(), lstTracker , e.iterTrack );
+    touch( e );
+
+    if (e.prefetching)
+      prefetchWait();
 
     if (e.status == Status::device)
       return;
+
+    if ( e.flags & Flags::Multi ) {
+      assureMultiTable( e );
+      return;
+    }
     
     allocateDeviceMemory(e);
 
     if ( e.status == Status::host )
       {
-	if (e.fptr) {
+	if (e.mapped)
+	  hostMapAdvise( e , MADV_WILLNEED );
+
+	if ( e.inArena && kernel_setup && !e.fptr ) {
+
+	  arenaStage( e );
+
+	} else if (e.fptr) {
 
 	  char * tmp = new char[e.size];
 	  e.fptr(true,tmp,e.hstPtr);
 	  CudaMemcpyH2D( e.devPtr , tmp , e.size );
 	  delete[] tmp;
+	  CudaSyncTransferStream();
 
 	} else {
 	  CudaMemcpyH2D( e.devPtr , e.hstPtr , e.size );
+	  CudaSyncTransferStream();
 	}
-	CudaSyncTransferStream();
+
+	if (e.evicted)
+	  policy->bytes_reuploaded += e.size;
+	bytes_uploaded += e.size;
+	uploads++;
+	e.dirty = false;
+      }
+    else
+      {
+	e.dirty = true;
       }
 
+    e.evicted = false;
     e.status = Status::device;
   }
 
@@ -522,6 +811,9 @@ namespace QDP
     
     allocateHostMemory(e);
 
+    if (e.prefetching)
+      prefetchWait();
+
     if ( e.status == Status::device )
       {
 	if (e.fptr) {
@@ -532,9 +824,12 @@ namespace QDP
 	} else {
 	  CudaMemcpyD2H( e.hstPtr , e.devPtr , e.size );
 	}
+	bytes_downloaded += e.size;
+	downloads++;
       }
 
     e.status = Status::host;
+    e.dirty = false;
 
     freeDeviceMemory(e);
   }
@@ -542,47 +837,762 @@ namespace QDP
 
 
 
-  bool QDPCache::spill_lru() {
-    if (lstTracker.size() < 1)
+  bool QDPCache::compact( size_t needed ) {
+    // Pointers handed out for the scalar stack must stay valid
+    if ( !pool_compact || qdp_stack_scalars_enabled() )
       return false;
 
-    list<int>::iterator it_key = lstTracker.begin();
-      
-    bool found=false;
-    Entry* e;
+    if ( pool_allocator.getFreeBytes() < needed )
+      return false;
 
-    while ( !found  &&  it_key != lstTracker.end() ) {
-      e = &vecEntry[ *it_key ];
+    prefetchWait();
+
+    // Static entries are known to the user by address, those stay put
+    std::map<void*,int> movable;
+    std::vector<int> ids;
+    trackedIds( ids );
+    std::lock_guard<std::mutex> lock_pool( mtxPool );
+    for ( auto id : ids ) {
+      Entry& e = vecEntry[ id ];
+      if ( (e.devPtr != NULL) && !e.inArena &&
+	   !( e.flags & ( Flags::JitParam | Flags::Static | Flags::Multi | Flags::OwnDeviceMemory ) ) )
+	movable[ e.devPtr ] = id;
+    }
 
-      found = ( (e->devPtr != NULL) &&
-		(e->flags != Flags::JitParam) &&
-		(e->flags != Flags::Static) &&
-		(e->flags != Flags::Multi) &&
-		( ! (e->flags & Flags::OwnDeviceMemory) ) );
-    
-      if (!found)
-	it_key++;
+    size_t moved = pool_allocator.compact( [&]( void* ptr ) { return movable.count( ptr ) > 0; } ,
+					   [&]( void* from , void* to ) { vecEntry[ movable[ from ] ].devPtr = to; } );
+
+    return moved > 0;
+  }
+
+
+  void QDPCache::assureMultiTable( Entry& e )
+  {
+    std::unique_lock<std::mutex> lock( mtxMulti );
+    auto t = mapMultiTable.find( e.multi );
+
+    if ( t == mapMultiTable.end() ) {
+      lock.unlock();
+      MultiTable table;
+      table.refs = 0;
+      while (!poolAllocate( &table.dev , e.size )) {
+	if (!spill( e.size )) {
+	  QDP_error_exit("cache assureMultiTable: can't spill LRU object. Out of GPU memory!");
+	}
+      }
+      lock.lock();
+      auto r = mapMultiTable.insert( std::make_pair( e.multi , table ) );
+      if (!r.second) {
+	std::lock_guard<std::mutex> lock_pool( mtxPool );
+	pool_allocator.free( table.dev );
+      }
+      t = r.first;
     }
 
-    if (found) {
-      //QDPIO::cout << "spill id = " << e->Id << "   size = " << e->size << "\n";
-      assureHost( *e );
-      return true;
-    } else {
+    ++t->second.refs;
+    e.table  = &t->second;
+    e.devPtr = t->second.dev;
+    e.status = Status::device;
+  }
+
+
+  void QDPCache::releaseMultiTable( Entry& e )
+  {
+    std::lock_guard<std::mutex> lock( mtxMulti );
+    if ( --e.table->refs == 0 ) {
+      {
+	std::lock_guard<std::mutex> lock_pool( mtxPool );
+	pool_allocator.free( e.table->dev );
+      }
+      mapMultiTable.erase( e.multi );
+    }
+    e.devPtr = NULL;
+    e.table = NULL;
+  }
+
+
+  bool QDPCache::arenaAllocate( Entry& e )
+  {
+    if ( !scalar_arena || e.size > arena_max_object )
       return false;
+
+    size_t size = ( e.size + arena_alignment - 1 ) & ~( (size_t)arena_alignment - 1 );
+
+    if ( arenaCurrent.empty() || arenaCurrent.back().used + size > arena_slab_size ) {
+      arenaFlush();
+
+      ScalarSlab slab;
+      if (!arenaSpare.empty()) {
+	slab = arenaSpare.back();
+	arenaSpare.pop_back();
+      } else {
+	while (!poolAllocate( &slab.dev , arena_slab_size )) {
+	  if (!spill( arena_slab_size ))
+	    return false;
+	}
+	slab.host = new char[ arena_slab_size ];
+      }
+      slab.used = 0;
+      arenaCurrent.push_back( slab );
+    }
+
+    ScalarSlab& slab = arenaCurrent.back();
+    e.devPtr  = (void*)( (char*)slab.dev + slab.used );
+    e.inArena = true;
+    slab.used += size;
+
+    arenaIdsCurrent.push_back( std::make_pair( e.Id , e.devPtr ) );
+    return true;
+  }
+
+
+  // Copies the host data to the staging buffer of the slab. Adjacent
+  // scalars go up with one copy in arenaFlush.
+  void QDPCache::arenaStage( Entry& e )
+  {
+    ScalarSlab& slab = arenaCurrent.back();
+    size_t off = (char*)e.devPtr - (char*)slab.dev;
+
+    if ( off >= slab.used ) {
+      CudaMemcpyH2D( e.devPtr , e.hstPtr , e.size );
+      return;
     }
+
+    if ( arenaRunHi != arenaRunLo && off != arenaRunHi )
+      arenaFlush();
+    if ( arenaRunHi == arenaRunLo )
+      arenaRunLo = off;
+
+    memcpy( slab.host + off , e.hstPtr , e.size );
+    arenaRunHi = off + ( ( e.size + arena_alignment - 1 ) & ~( (size_t)arena_alignment - 1 ) );
+    arena_staged++;
   }
 
 
+  void QDPCache::arenaFlush()
+  {
+    if ( arenaRunHi == arenaRunLo )
+      return;
 
+    ScalarSlab& slab = arenaCurrent.back();
+    CudaMemcpyH2D( (char*)slab.dev + arenaRunLo , slab.host + arenaRunLo , arenaRunHi - arenaRunLo );
+    arena_uploads++;
 
+    arenaRunLo = arenaRunHi = 0;
+  }
+
+
+  void QDPCache::newScalarGeneration()
+  {
+    arenaFlush();
+
+    // Survivors of the previous generation move to the host, ids that
+    // were signed off or reused don't point into the slabs anymore
+    for ( auto& a : arenaIdsPrevious ) {
+      Entry& e = vecEntry[ a.first ];
+      if ( !e.inArena || e.devPtr != a.second )
+	continue;
+      if ( e.status == Status::device && e.dirty ) {
+	allocateHostMemory( e );
+	CudaMemcpyD2H( e.hstPtr , e.devPtr , e.size );
+	bytes_downloaded += e.size;
+	downloads++;
+      }
+      if ( e.status == Status::device )
+	e.status = Status::host;
+      e.dirty   = false;
+      e.devPtr  = NULL;
+      e.inArena = false;
+    }
+
+    arenaSpare.insert( arenaSpare.end() , arenaPrevious.begin() , arenaPrevious.end() );
+    arenaPrevious.swap( arenaCurrent );
+    arenaCurrent.clear();
+    arenaIdsPrevious.swap( arenaIdsCurrent );
+    arenaIdsCurrent.clear();
+
+    arena_generations++;
+  }
+
+
+  void QDPCache::setHostMmap( const std::string& dir , size_t min_bytes )
+  {
+    host_mmap_dir = dir;
+    host_mmap_min = min_bytes;
+  }
+
+
+  // The file is unlinked right away, the mapping keeps it until munmap
+  void* QDPCache::hostMapAllocate( size_t size )
+  {
+    std::string name = host_mmap_dir + "/qdp-jit-XXXXXX";
+    std::vector<char> templ( name.begin() , name.end() );
+    templ.push_back( 0 );
+
+    int fd = mkstemp( templ.data() );
+    if (fd < 0) {
+      QDP_info("cache: can't create a file in %s, using host memory",host_mmap_dir.c_str());
+      return NULL;
+    }
+    unlink( templ.data() );
+
+    if ( ftruncate( fd , size ) != 0 ) {
+      QDP_info("cache: can't resize a file in %s to %lu bytes, using host memory",host_mmap_dir.c_str(),(unsigned long)size);
+      close( fd );
+      return NULL;
+    }
+
+    void* ptr = mmap( NULL , size , PROT_READ | PROT_WRITE , MAP_SHARED , fd , 0 );
+    close( fd );
+
+    if (ptr == MAP_FAILED) {
+      QDP_info("cache: mmap of %lu bytes failed, using host memory",(unsigned long)size);
+      return NULL;
+    }
+
+    // Copies to and from the device stream through the whole field
+    madvise( ptr , size , MADV_SEQUENTIAL );
+
+    atomic_max( bytes_mapped_peak , bytes_mapped += size );
+
+    return ptr;
+  }
+
+
+  // Only a hint, failures are ignored
+  void QDPCache::hostMapAdvise( Entry& e , int advice )
+  {
+    madvise( e.hstPtr , e.size , advice );
+  }
+
+
+  void* QDPCache::prefetchStaging( size_t size )
+  {
+    void* ptr = NULL;
+
+    for ( size_t i = 0 ; i < vecStagingFree.size() ; ++i )
+      if ( vecStagingFree[i].second >= size ) {
+	vecStagingBusy.push_back( vecStagingFree[i] );
+	vecStagingFree.erase( vecStagingFree.begin() + i );
+	return vecStagingBusy.back().first;
+      }
+
+    // None is large enough, don't keep the small ones
+    for ( auto& b : vecStagingFree )
+      CudaHostFree( b.first );
+    vecStagingFree.clear();
+
+    if (!CudaHostAlloc( &ptr , size , 0 ))
+      return NULL;
+
+    vecStagingBusy.push_back( std::make_pair( ptr , size ) );
+    return ptr;
+  }
+
+
+  void QDPCache::prefetch( const std::vector<int>& ids )
+  {
+    if ( !DeviceParams::Instance().getAsyncTransfers() && !DeviceParams::Instance().getHostTarget() )
+      return;
+
+    for ( auto i : ids ) {
+      if (i < 0)
+	continue;
+      assert( vecEntry.size() > i );
+      Entry& e = vecEntry[i];
+
+      if (e.flags & Flags::Multi) {
+	prefetch( e.multi );
+	continue;
+      }
+
+      if ( ( e.flags & ( Flags::JitParam | Flags::Static | Flags::OwnDeviceMemory ) ) ||
+	   ( scalar_arena && ( e.flags & Flags::Scalar ) ) ||
+	   e.status != Status::host || e.hstPtr == NULL || e.devPtr != NULL )
+	continue;
+
+      // Use free memory only, evicting could hit the arguments of the
+      // kernel about to be launched
+      if (!poolAllocate( &e.devPtr , e.size ))
+	return;
+
+      if (e.mapped)
+	hostMapAdvise( e , MADV_WILLNEED );
+
+      void* stage = prefetchStaging( e.size );
+      if (!stage) {
+	std::lock_guard<std::mutex> lock( mtxPool );
+	pool_allocator.free( e.devPtr );
+	e.devPtr = NULL;
+	return;
+      }
+
+      {
+	std::unique_lock<std::mutex> lock( mtxPrefetch );
+	if (!prefetchThread.joinable()) {
+	  prefetchStop = false;
+	  prefetchThread = std::thread( &QDPCache::prefetchWorker , this );
+	}
+	prefetchJobs.push_back( PrefetchJob{ e.fptr , e.devPtr , e.hstPtr , stage , e.size } );
+	prefetchBusy++;
+      }
+      cvPrefetch.notify_all();
 
+      touch( e );
 
+      if (e.evicted)
+	policy->bytes_reuploaded += e.size;
+      bytes_prefetched += e.size;
+      bytes_uploaded += e.size;
+      uploads++;
 
-  QDPCache::QDPCache() : vecEntry(1024)  {
-    for ( int i = vecEntry.size()-1 ; i >= 0 ; --i ) {
-      stackFree.push(i);
+      e.evicted = false;
+      e.dirty = false;
+      e.status = Status::device;
+      e.prefetching = true;
+      vecPrefetched.push_back( i );
     }
+  }
+
+
+  // The host side of an upload, the layout change in particular, runs
+  // here while the main thread goes on. The entry is marked prefetching,
+  // nobody touches its host or device memory before prefetchWait.
+  void QDPCache::prefetchWorker()
+  {
+    CudaSetCurrentContext();
+
+    while (true) {
+      PrefetchJob job;
+      {
+	std::unique_lock<std::mutex> lock( mtxPrefetch );
+	cvPrefetch.wait( lock , [this]{ return prefetchStop || !prefetchJobs.empty(); } );
+	if (prefetchJobs.empty())
+	  return;
+	job = prefetchJobs.front();
+	prefetchJobs.pop_front();
+      }
+
+      if (job.fptr)
+	job.fptr( true , job.stage , job.hst );
+      else
+	memcpy( job.stage , job.hst , job.size );
+
+      CudaMemcpyH2DAsync( job.dev , job.stage , job.size );
+
+      {
+	std::unique_lock<std::mutex> lock( mtxPrefetch );
+	prefetchBusy--;
+      }
+      cvPrefetch.notify_all();
+    }
+  }
+
+
+  void QDPCache::prefetchShutdown()
+  {
+    prefetchWait();
+    {
+      std::unique_lock<std::mutex> lock( mtxPrefetch );
+      prefetchStop = true;
+    }
+    cvPrefetch.notify_all();
+    if (prefetchThread.joinable())
+      prefetchThread.join();
+  }
+
+
+  void QDPCache::prefetchWait()
+  {
+    if (vecPrefetched.empty())
+      return;
+
+    {
+      std::unique_lock<std::mutex> lock( mtxPrefetch );
+      cvPrefetch.wait( lock , [this]{ return prefetchBusy == 0; } );
+    }
+    CudaSyncTransferStream();
+
+    for ( auto i : vecPrefetched )
+      vecEntry[i].prefetching = false;
+    vecPrefetched.clear();
+
+    vecStagingFree.insert( vecStagingFree.end() , vecStagingBusy.begin() , vecStagingBusy.end() );
+    vecStagingBusy.clear();
+  }
+
+
+  bool QDPCache::spill( size_t needed ) {
+    std::vector<CacheEvictionPolicy::candidate_t> cand;
+
+    std::vector<int> ids;
+    trackedIds( ids );
+    for ( auto id : ids ) {
+      Entry& e = vecEntry[ id ];
+
+      // Entries of the kernel that is being set up stay
+      bool found = ( (e.devPtr != NULL) &&
+		     (e.flags != Flags::JitParam) &&
+		     (e.flags != Flags::Static) &&
+		     (e.flags != Flags::Multi) &&
+		     ( ! (e.flags & Flags::OwnDeviceMemory) ) &&
+		     ( ! e.inArena ) &&
+		     ( ! kernel_setup || e.lastEpoch != epoch ) );
+
+      if (found) {
+	unsigned long age = ( epoch - e.lastEpoch ) / 256;
+
+	CacheEvictionPolicy::candidate_t c;
+	c.id    = id;
+	c.size  = e.size;
+	c.clean = !e.dirty && e.hstPtr && e.status == Status::device;
+	c.uses  = age < 64 ? e.uses >> age : 0;
+	cand.push_back( c );
+      }
+    }
+    if (cand.empty())
+      return false;
+
+    size_t k = policy->select( cand , needed );
+    assert( k < cand.size() );
+
+    Entry& e = vecEntry[ cand[k].id ];
+    //QDPIO::cout << "spill id = " << e.Id << "   size = " << e.size << "\n";
+
+    if (cand[k].clean) {
+      freeDeviceMemory( e );
+      e.status = Status::host;
+      policy->bytes_dropped += e.size;
+    } else {
+      assureHost( e );
+      policy->bytes_spilled += e.size;
+    }
+    e.evicted = true;
+    policy->evictions++;
+
+    // The host copy is cold now
+#ifdef MADV_PAGEOUT
+    if (e.mapped)
+      hostMapAdvise( e , MADV_PAGEOUT );
+#else
+    if (e.mapped)
+      hostMapAdvise( e , MADV_DONTNEED );
+#endif
+
+    return true;
+  }
+
+
+
+  namespace {
+
+    // Least recently used entry
+    class LRUEvictionPolicy: public CacheEvictionPolicy
+    {
+    public:
+      const char* name() const { return "lru"; }
+      size_t select( const std::vector<candidate_t>& cand , size_t needed ) { return 0; }
+    };
+
+
+    // Least recently used entry that frees enough memory for the
+    // allocation by itself, otherwise the largest entry. Fewer and
+    // larger evictions against a fragmented pool.
+    class SizeEvictionPolicy: public CacheEvictionPolicy
+    {
+    public:
+      const char* name() const { return "size"; }
+      size_t select( const std::vector<candidate_t>& cand , size_t needed ) {
+	size_t largest = 0;
+	for ( size_t i = 0 ; i < cand.size() ; ++i ) {
+	  if ( cand[i].size >= needed )
+	    return i;
+	  if ( cand[i].size > cand[largest].size )
+	    largest = i;
+	}
+	return largest;
+      }
+    };
+
+
+    // Least recently used entry with a current host copy, these are
+    // evicted without a device to host copy
+    class CleanEvictionPolicy: public CacheEvictionPolicy
+    {
+    public:
+      const char* name() const { return "clean"; }
+      size_t select( const std::vector<candidate_t>& cand , size_t needed ) {
+	for ( size_t i = 0 ; i < cand.size() ; ++i )
+	  if ( cand[i].clean )
+	    return i;
+	return 0;
+      }
+    };
+
+
+    // Least frequently used entry. The use counts age (halve every 256
+    // kernels), so entries that were hot earlier on don't stay forever.
+    // Ties go to the less recently used entry.
+    class LFUEvictionPolicy: public CacheEvictionPolicy
+    {
+    public:
+      const char* name() const { return "lfu"; }
+      size_t select( const std::vector<candidate_t>& cand , size_t needed ) {
+	size_t best = 0;
+	for ( size_t i = 1 ; i < cand.size() ; ++i )
+	  if ( cand[i].uses < cand[best].uses )
+	    best = i;
+	return best;
+      }
+    };
+
+  }
+
+
+  CacheEvictionPolicy* qdp_cache_create_policy( const std::string& name )
+  {
+    if (name == "lru")
+      return new LRUEvictionPolicy;
+    if (name == "size")
+      return new SizeEvictionPolicy;
+    if (name == "clean")
+      return new CleanEvictionPolicy;
+    if (name == "lfu")
+      return new LFUEvictionPolicy;
+    QDP_error_exit("Unknown cache eviction policy %s (lru, size, clean, lfu)",name.c_str());
+    return NULL;
+  }
+
+
+  void QDPCache::setEvictionPolicy( const std::string& name )
+  {
+    delete policy;
+    policy = qdp_cache_create_policy( name );
+  }
+
+
+  void QDPCache::setKernelReadOnly( const std::vector<int>& ids )
+  {
+    vecReadOnly = ids;
+  }
+
+
+  void QDPCache::printEvictionStats()
+  {
+    QDPIO::cout << "Cache eviction policy:                 " << policy->name() << "\n";
+    QDPIO::cout << "Cache evictions:                       " << policy->evictions << "\n";
+    QDPIO::cout << "Cache bytes copied back on eviction:   " << policy->bytes_spilled << "\n";
+    QDPIO::cout << "Cache bytes evicted without copy back: " << policy->bytes_dropped << "\n";
+    QDPIO::cout << "Cache bytes uploaded after eviction:   " << policy->bytes_reuploaded << "\n";
+    QDPIO::cout << "Cache bytes prefetched:                " << bytes_prefetched << "\n";
+    if (scalar_arena) {
+      QDPIO::cout << "Scalar arena generations:              " << arena_generations << "\n";
+      QDPIO::cout << "Scalar arena slabs:                    " << arenaCurrent.size() + arenaPrevious.size() + arenaSpare.size() << "\n";
+      QDPIO::cout << "Scalar arena uploads (scalars staged): " << arena_uploads << " (" << arena_staged << ")\n";
+    }
+    if (pool_compact)
+      pool_allocator.printPoolInfo();
+  }
+
+
+  void QDPCache::setTelemetryFile( const std::string& fname )
+  {
+    telemetry_file = fname;
+  }
+
+
+  void QDPCache::printLargestEntries( int count )
+  {
+    std::vector< std::pair<size_t,int> > live;
+    {
+      std::vector<int> ids;
+      trackedIds( ids );
+      for ( auto id : ids )
+	if ( vecEntry[id].site )
+	  live.push_back( std::make_pair( vecEntry[id].size , id ) );
+    }
+
+    count = std::min( count , (int)live.size() );
+    std::partial_sort( live.begin() , live.begin() + count , live.end() , std::greater< std::pair<size_t,int> >() );
+
+    QDPIO::cout << "Largest live entries (id, bytes, on device, site):\n";
+    for ( int i = 0 ; i < count ; ++i ) {
+      Entry& e = vecEntry[ live[i].second ];
+      QDPIO::cout << "  " << e.Id << "  " << e.size << "  " << ( e.devPtr ? "yes" : "no" ) << "  " << e.site << "\n";
+    }
+  }
+
+
+  void QDPCache::recordTelemetry( size_t working_set )
+  {
+    const void* kernel = telemetry_kernel;
+    telemetry_kernel = NULL;
+
+    if (telemetry_file.empty())
+      return;
+
+    KernelStats& k = mapKernel[ kernel ];
+    k.peak = std::max( k.peak , working_set );
+    k.launches++;
+
+    // Keep every other sample when the series is full
+    const size_t max_samples = 1 << 16;
+    if ( epoch % sample_stride )
+      return;
+    if ( vecSample.size() >= max_samples ) {
+      for ( size_t i = 0 ; i < max_samples / 2 ; ++i )
+	vecSample[i] = vecSample[ 2 * i + 1 ];
+      vecSample.resize( max_samples / 2 );
+      sample_stride *= 2;
+    }
+
+    Sample smp;
+    smp.kernel      = epoch;
+    smp.resident    = pool_allocator.getUsedBytes();
+    smp.spilled     = policy->bytes_spilled + policy->bytes_dropped;
+    smp.uploaded    = bytes_uploaded;
+    smp.downloaded  = bytes_downloaded;
+    smp.working_set = working_set;
+    vecSample.push_back( smp );
+  }
+
+
+  namespace {
+    std::string telemetry_kernel_name( const void* kernel )
+    {
+      if (!kernel)
+	return "(other)";
+      std::string name = getIdfromCUFunc( (CUfunction)const_cast<void*>( kernel ) );
+      return name.empty() ? "(unknown)" : name;
+    }
+
+    std::string telemetry_json_string( const std::string& str )
+    {
+      std::string ret = "\"";
+      for ( auto c : str ) {
+	if ( c == '"' || c == '\\' )
+	  ret += '\\';
+	if ( (unsigned char)c >= 32 )
+	  ret += c;
+      }
+      return ret + "\"";
+    }
+  }
+
+
+  void QDPCache::writeTelemetry()
+  {
+    std::string fname = telemetry_file;
+    if ( Layout::numNodes() > 1 ) {
+      std::ostringstream oss;
+      oss << fname << "." << Layout::nodeNumber();
+      fname = oss.str();
+    }
+
+    std::ofstream f( fname.c_str() );
+    if (!f) {
+      QDP_info("cache telemetry: can't write %s",fname.c_str());
+      return;
+    }
+
+    const std::string ext = ".json";
+    bool json = telemetry_file.size() >= ext.size() &&
+      telemetry_file.compare( telemetry_file.size() - ext.size() , ext.size() , ext ) == 0;
+
+    if (!json) {
+      f << "kernel,resident,evicted,uploaded,downloaded,working_set\n";
+      for ( auto& s : vecSample )
+	f << s.kernel << "," << s.resident << "," << s.spilled << "," << s.uploaded << "," << s.downloaded << "," << s.working_set << "\n";
+      return;
+    }
+
+    f << "{\n  \"pool_size\": " << pool_allocator.getPoolSize()
+      << ",\n  \"pool_peak\": " << pool_allocator.getPeakUsedBytes()
+      << ",\n  \"samples\": [";
+    for ( size_t i = 0 ; i < vecSample.size() ; ++i ) {
+      const Sample& s = vecSample[i];
+      f << ( i ? ",\n    " : "\n    " ) << "{\"kernel\": " << s.kernel << ", \"resident\": " << s.resident
+	<< ", \"evicted\": " << s.spilled << ", \"uploaded\": " << s.uploaded << ", \"downloaded\": " << s.downloaded
+	<< ", \"working_set\": " << s.working_set << "}";
+    }
+    f << "\n  ],\n  \"kernels\": [";
+    bool first = true;
+    for ( auto& k : mapKernel ) {
+      f << ( first ? "\n    " : ",\n    " ) << "{\"name\": " << telemetry_json_string( telemetry_kernel_name( k.first ) )
+	<< ", \"peak\": " << k.second.peak << ", \"launches\": " << k.second.launches << "}";
+      first = false;
+    }
+    f << "\n  ],\n  \"sites\": [";
+    first = true;
+    std::lock_guard<std::mutex> lock( mtxSite );
+    for ( auto& s : mapSite ) {
+      f << ( first ? "\n    " : ",\n    " ) << "{\"site\": " << telemetry_json_string( s.first )
+	<< ", \"peak\": " << s.second->peak << ", \"live\": " << s.second->live
+	<< ", \"largest\": " << s.second->largest << ", \"entries\": " << s.second->entries << "}";
+      first = false;
+    }
+    f << "\n  ]\n}\n";
+  }
+
+
+  void QDPCache::printMemoryReport()
+  {
+    QDPIO::cout << "Device pool size:                      " << pool_allocator.getPoolSize() << "\n";
+    QDPIO::cout << "Device pool high-water mark:           " << pool_allocator.getPeakUsedBytes() << "\n";
+    QDPIO::cout << "Bytes uploaded (copies):               " << bytes_uploaded << " (" << uploads << ")\n";
+    QDPIO::cout << "Bytes downloaded (copies):             " << bytes_downloaded << " (" << downloads << ")\n";
+    if (!host_mmap_dir.empty())
+      QDPIO::cout << "Host bytes in mapped files (peak):     " << bytes_mapped << " (" << bytes_mapped_peak << ")\n";
+    QDPIO::cout << "Kernel arguments (most, on heap):      " << args_peak << " (" << args_heap << ")\n";
+
+    const int count = 10;
+
+    {
+      std::lock_guard<std::mutex> lock( mtxSite );
+      std::vector< std::pair<size_t,const char*> > sites;
+      for ( auto& s : mapSite )
+	sites.push_back( std::make_pair( s.second->peak.load() , s.first ) );
+      std::sort( sites.begin() , sites.end() , std::greater< std::pair<size_t,const char*> >() );
+
+      QDPIO::cout << "Sites by peak bytes (peak, live, largest entry, entries, site):\n";
+      for ( int i = 0 ; i < std::min( count , (int)sites.size() ) ; ++i ) {
+	const SiteStats& s = *mapSite[ sites[i].second ];
+	QDPIO::cout << "  " << s.peak << "  " << s.live << "  " << s.largest << "  " << s.entries << "  " << sites[i].second << "\n";
+      }
+    }
+
+    if (!mapKernel.empty()) {
+      std::vector< std::pair<size_t,const void*> > kernels;
+      for ( auto& k : mapKernel )
+	kernels.push_back( std::make_pair( k.second.peak , k.first ) );
+      std::sort( kernels.begin() , kernels.end() , std::greater< std::pair<size_t,const void*> >() );
+
+      QDPIO::cout << "Kernels by peak working set (peak, launches, kernel):\n";
+      for ( int i = 0 ; i < std::min( count , (int)kernels.size() ) ; ++i ) {
+	std::string name = telemetry_kernel_name( kernels[i].second );
+	if ( name.size() > 64 )
+	  name = name.substr( 0 , 61 ) + "...";
+	QDPIO::cout << "  " << kernels[i].first << "  " << mapKernel[ kernels[i].second ].launches << "  " << name << "\n";
+      }
+    }
+
+    printLargestEntries( count );
+
+    if (!telemetry_file.empty()) {
+      QDPIO::cout << "Cache telemetry file:                  " << telemetry_file << "\n";
+      writeTelemetry();
+    }
+  }
+
+
+
+
+  QDPCache::QDPCache() : track_stamp(0), policy( new LRUEvictionPolicy ), epoch(1), kernel_setup(false), pool_compact(false),
+			 lookahead(false), prefetchBusy(0), prefetchStop(false), bytes_prefetched(0), lastKernel(NULL),
+			 scalar_arena(false), arenaRunLo(0), arenaRunHi(0), arena_generations(0), arena_uploads(0), arena_staged(0),
+			 sample_stride(1), telemetry_kernel(NULL), bytes_uploaded(0), bytes_downloaded(0), uploads(0), downloads(0),
+			 host_mmap_min(0), bytes_mapped(0), bytes_mapped_peak(0), args_peak(0), args_heap(0) {
+    growStack();
     vecLocked.reserve(1024);
   }
 
@@ -709,15 +1719,21 @@ namespace QDP
     return ret;
   }
 #else
-  std::vector<void*> QDPCache::get_kernel_args(std::vector<int>& ids , bool for_kernel )
+  void QDPCache::prepareKernelIds( const std::vector<int>& ids , bool for_kernel )
   {
     // Here we do two cycles through the ids:
     // 1) cache all objects
     // 2) check all are cached
     // This should replace the old 'lock set'
 
+    ++epoch;
+
+    if ( arenaCurrent.size() >= arena_generation_slabs )
+      newScalarGeneration();
+
     //QDPIO::cout << "ids: ";
-    std::vector<int> allids;
+    std::vector<int>& allids = vecAllIds;
+    allids.clear();
     for ( auto i : ids )
       {
 	allids.push_back(i);
@@ -737,24 +1753,65 @@ namespace QDP
       }
     //QDPIO::cout << "\n";
 
+    // Mark the entries of this kernel first, so that making room for
+    // one of them doesn't evict another. The use count ages, it is
+    // halved every 256 kernels without use.
+    for ( auto i : allids ) {
+      if (i >= 0) {
+	Entry& e = vecEntry[i];
+	if ( !( e.flags & ( Flags::JitParam | Flags::Static | Flags::Multi ) ) && e.lastEpoch != epoch ) {
+	  unsigned long age = ( epoch - e.lastEpoch ) / 256;
+	  e.uses = ( age < 64 ? e.uses >> age : 0 ) + 1;
+	  e.lastEpoch = epoch;
+	}
+      }
+    }
+
     //QDPIO::cout << "allids: ";
+    kernel_setup = true;
     for ( auto i : allids ) {
       //QDPIO::cout << i << " ";
       assureDevice(i);
     }
+    arenaFlush();
+    kernel_setup = false;
+
+    // Arguments the kernel writes are dirty now. Without a hint every
+    // argument counts as written.
+    for ( auto i : allids )
+      if ( i >= 0 && std::find( vecReadOnly.begin() , vecReadOnly.end() , i ) == vecReadOnly.end() ) {
+	Entry& e = vecEntry[i];
+#ifdef MADV_REMOVE
+	// The mapped host copy is stale, its pages and disk blocks can go
+	if ( e.mapped && !e.dirty )
+	  hostMapAdvise( e , MADV_REMOVE );
+#endif
+	e.dirty = true;
+      }
+    if (for_kernel)
+      vecReadOnly.clear();
     //QDPIO::cout << "\n";
-    
+
     bool all = true;
-    for ( auto i : allids )
+    size_t working_set = 0;
+    for ( auto i : allids ) {
       all = all && isOnDevice(i);
+      if ( i >= 0 && !( vecEntry[i].flags & Flags::JitParam ) )
+	working_set += vecEntry[i].size;
+    }
 
     if (!all) {
       QDPIO::cout << "It was not possible to load all objects required by the kernel into device memory\n";
+      QDPIO::cout << "kernel working set = " << working_set << "  pool in use = " << pool_allocator.getUsedBytes()
+		  << "  pool size = " << pool_allocator.getPoolSize() << "\n";
       for ( auto i : ids ) {
 	if (i >= 0) {
 	  assert( vecEntry.size() > i );
 	  Entry& e = vecEntry[i];
-	  QDPIO::cout << "id = " << i << "  size = " << e.size << "  flags = " << e.flags << "  status = ";
+	  QDPIO::cout << "id = " << i << "  size = " << e.size << "  flags = " << e.flags;
+	  if (e.site)
+	    QDPIO::cout << "  site = " << e.site;
+	  QDPIO::cout << "  status = ";
 	  switch (e.status) {
 	  case Status::undef:
 	    QDPIO::cout << "undef\n";
@@ -772,11 +1829,15 @@ namespace QDP
 	  QDPIO::cout << "id = " << i << "\n";
 	}
       }
+      printLargestEntries( 10 );
       QDP_error_exit("giving up");
     }
 
+    const void* kernel = telemetry_kernel;
+    if (for_kernel)
+      recordTelemetry( working_set );
 
-    // Handle multi-ids
+    // Handle multi-ids, the table is uploaded when a pointer changed
     for ( auto i : ids )
       {
 	if (i >= 0)
@@ -785,9 +1846,9 @@ namespace QDP
 	    if (e.flags & QDPCache::Flags::Multi)
 	      {
 		assert( isOnDevice(i) );
-		multi1d<void*> dev_ptr(e.multi.size());
+		std::vector<void*>& dev_ptr = vecMultiPtrs;
+		dev_ptr.clear();
 
-		int count=0;
 		for( auto q : e.multi )
 		  {
 		    if ( q >= 0 )
@@ -796,32 +1857,60 @@ namespace QDP
 			Entry& qe = vecEntry[q];
 			assert( ! (qe.flags & QDPCache::Flags::Multi) );
 			assert( isOnDevice(q) );
-			dev_ptr[count++] = qe.devPtr;
+			dev_ptr.push_back( qe.devPtr );
 		      }
 		    else
 		      {
-			dev_ptr[count++] = NULL;
+			dev_ptr.push_back( NULL );
 		      }
 		  }
-		
-		CudaMemcpyH2D( e.devPtr , dev_ptr.slice() , e.multi.size() * sizeof(void*) );
+
+		if ( e.table->ptrs != dev_ptr ) {
+		  CudaMemcpyH2D( e.devPtr , dev_ptr.data() , e.multi.size() * sizeof(void*) );
+		  e.table->ptrs = dev_ptr;
+		}
 		//QDPIO::cout << "multi-ids: copied elements = " << e.multi.size() << "\n";
 	      }
 	  }
       }
 
-    
+    // Look-ahead: remember the arguments of the kernel that followed
+    // the previous one and start the uploads for the kernel that followed
+    // this one. The arguments of this kernel are resident, prefetch
+    // doesn't evict. The map holds one entry per kernel.
+    if (lookahead && for_kernel && kernel) {
+      if (lastKernel) {
+	std::vector<int>& next = mapNextKernel[ lastKernel ];
+	next.clear();
+	for ( auto i : ids )
+	  if ( i >= 0 && !( vecEntry[i].flags & Flags::JitParam ) )
+	    next.push_back( i );
+      }
+
+      auto next = mapNextKernel.find( kernel );
+      if (next != mapNextKernel.end())
+	prefetch( next->second );
+
+      lastKernel = kernel;
+    }
+  }
+
+
+  std::vector<void*> QDPCache::get_kernel_args(std::vector<int>& ids , bool for_kernel )
+  {
+    prepareKernelIds( ids , for_kernel );
+
     const bool print_param = false;
 
     if (print_param)
       QDPIO::cout << "Jit function param: ";
-    
+
     std::vector<void*> ret;
     for ( auto i : ids ) {
       if (i >= 0) {
 	Entry& e = vecEntry[i];
 	if (e.flags & QDPCache::Flags::JitParam) {
-	  
+
 	  if (print_param)
 	    {
 	      switch(e.param_type) {
@@ -840,21 +1929,21 @@ namespace QDP
 		assert(0);
 	      }
 	    }
-	  
+
 	  assert(for_kernel);
 	  ret.push_back( &e.param );
-	  
+
 	} else {
-	  
+
 	  if (print_param)
 	    {
 	      QDPIO::cout << (size_t)e.devPtr << ", ";
 	    }
-	  
+
 	  ret.push_back( for_kernel ? &e.devPtr : e.devPtr );
 	}
       } else {
-	
+
 	if (print_param)
 	  {
 	    QDPIO::cout << "NULL(id=" << i<< "), ";
@@ -862,7 +1951,7 @@ namespace QDP
 
 	assert(for_kernel);
 	ret.push_back( &jit_param_null_ptr );
-	
+
       }
     }
     if (print_param)
@@ -870,6 +1959,37 @@ namespace QDP
 
     return ret;
   }
+
+
+  void QDPCache::get_kernel_args( QDPJitArgs& args )
+  {
+    vecKernelIds.clear();
+    for ( int i = 0 ; i < args.n ; ++i )
+      if ( !args.slot(i).scalar )
+	vecKernelIds.push_back( args.slot(i).id );
+
+    prepareKernelIds( vecKernelIds , true );
+
+    args_peak = std::max( args_peak , args.n );
+
+    if ( args.n >= QDPJitArgs::max_inline + 1 ) {
+      args_heap++;
+      args.heap_ptrs.resize( args.n + 1 );
+      args.ptrs = args.heap_ptrs.data();
+    }
+
+    for ( int i = 0 ; i < args.n ; ++i ) {
+      QDPJitArgs::slot_t& s = args.slot(i);
+      if (s.scalar) {
+	args.ptrs[i] = &s.value;
+      } else if (s.id >= 0) {
+	Entry& e = vecEntry[ s.id ];
+	args.ptrs[i] = ( e.flags & QDPCache::Flags::JitParam ) ? (void*)&e.param : (void*)&e.devPtr;
+      } else {
+	args.ptrs[i] = &jit_param_null_ptr;
+      }
+    }
+  }
 #endif
 
 
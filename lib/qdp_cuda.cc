@@ -12,6 +12,8 @@
 // #include "cuda.h"
 
 #include <string>
+#include <cstring>
+#include <unistd.h>
 
 #include "cudaProfiler.h"
 
@@ -23,6 +25,7 @@ namespace QDP {
 
   CUstream * QDPcudastreams;
   CUevent * QDPevCopied;
+  CUevent * QDPevKernelDone;
 
   CUdevice cuDevice;
   CUcontext cuContext;
@@ -84,6 +87,13 @@ namespace QDP {
 			 unsigned int  sharedMemBytes, CUstream hStream, void** kernelParams, void** extra )
   {
     //QDPIO::cout << "kernel launch (manual)..\n";
+    if (DeviceParams::Instance().getHostTarget()) {
+      jit_launch_host_block( f , gridDimX * gridDimY * gridDimZ , blockDimX * blockDimY * blockDimZ , sharedMemBytes , kernelParams );
+      return;
+    }
+
+    f = jit_resolve_function( f );
+
 #if 0
     QDP_get_global_cache().releasePrevLockSet();
     QDP_get_global_cache().beginNewLockSet();
@@ -171,6 +181,9 @@ namespace QDP {
   int CudaAttributeNumRegs( CUfunction f ) {
     int pi;
     CUresult res;
+    f = jit_resolve_function( f );
+    if (DeviceParams::Instance().getHostTarget())
+      return 0;
     res = cuFuncGetAttribute ( &pi, CU_FUNC_ATTRIBUTE_NUM_REGS , f );
     CudaRes("CudaAttributeNumRegs",res);
     return pi;
@@ -179,6 +192,9 @@ namespace QDP {
   int CudaAttributeLocalSize( CUfunction f ) {
     int pi;
     CUresult res;
+    f = jit_resolve_function( f );
+    if (DeviceParams::Instance().getHostTarget())
+      return 0;
     res = cuFuncGetAttribute ( &pi, CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES , f );
     CudaRes("CudaAttributeLocalSize",res);
     return pi;
@@ -187,6 +203,9 @@ namespace QDP {
   int CudaAttributeConstSize( CUfunction f ) {
     int pi;
     CUresult res;
+    f = jit_resolve_function( f );
+    if (DeviceParams::Instance().getHostTarget())
+      return 0;
     res = cuFuncGetAttribute ( &pi, CU_FUNC_ATTRIBUTE_CONST_SIZE_BYTES , f );
     CudaRes("CudaAttributeConstSize",res);
     return pi;
@@ -236,8 +255,21 @@ namespace QDP {
     CudaRes("cuDeviceGetAttribute(CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR)",ret);
   }
 
+  std::string CudaGetDeviceName() {
+    char name[256];
+    CUresult ret;
+    ret = cuDeviceGetName( name , sizeof(name) , cuDevice );
+    CudaRes("cuDeviceGetName",ret);
+    return std::string( name );
+  }
+
   void CudaInit() {
     //QDP_info_primary("CUDA initialization");
+    if (DeviceParams::Instance().getHostTarget()) {
+      QDP_info_primary("Host target: skipping CUDA initialization");
+      return;
+    }
+
     cuInit(0);
 
     int deviceCount = 0;
@@ -259,36 +291,90 @@ namespace QDP {
     return (void*)&QDPcudastreams[KERNEL];
   }
 
+  //
+  // The transfer stream is non-blocking: its copies are not ordered
+  // against kernels, neither on the KERNEL stream nor on the default
+  // stream (tuned launches). Every kernel launch ends with
+  // cuCtxSynchronize, which also waits for the transfer stream. The
+  // users of the transfer stream and what orders them:
+  //
+  //  - QDPCache::prefetch (H2D, issued by the prefetch worker thread)
+  //    Writes pool memory just taken from the free list, no kernel uses
+  //    it. QDPCache::prefetchWait waits for the worker and the stream
+  //    before the entry is used, downloaded or freed.
+  //  - FnMapRsrc::send_receive (D2H of the send buffer)
+  //    Waits for the gather via CudaTransferWaitKernel, not only for the
+  //    cuCtxSynchronize of the launch. FnMapRsrc::start_pending syncs the
+  //    stream before the buffer is handed to QMP.
+  //  - FnMapRsrc::qmp_wait (H2D of the receive buffer)
+  //    FnMapRsrc::sync_received syncs the stream before the kernel that
+  //    reads the receive buffer is launched.
+  //
+  // Any new user of CudaMemcpyH2DAsync / CudaMemcpyD2HAsync has to
+  // order itself in the same way.
+  //
   void CudaCreateStreams() {
+    if (DeviceParams::Instance().getHostTarget())
+      return;
     QDPcudastreams = new CUstream[2];
     for (int i=0; i<2; i++) {
       QDP_info_primary("JIT: Creating CUDA stream %d",i);
-      cuStreamCreate(&QDPcudastreams[i],0);
+      cuStreamCreate(&QDPcudastreams[i], i == TRANSFER ? CU_STREAM_NON_BLOCKING : 0 );
     }
     QDP_info_primary("JIT: Creating CUDA event for transfers");
     QDPevCopied = new CUevent;
     cuEventCreate(QDPevCopied,CU_EVENT_BLOCKING_SYNC);
+    QDPevKernelDone = new CUevent;
+    cuEventCreate(QDPevKernelDone,CU_EVENT_DISABLE_TIMING);
   }
 
   void CudaSyncKernelStream() {
+    if (DeviceParams::Instance().getHostTarget())
+      return;
     CUresult ret = cuStreamSynchronize(QDPcudastreams[KERNEL]);
     CudaRes("cuStreamSynchronize",ret);    
   }
 
   void CudaSyncTransferStream() {
+    if (DeviceParams::Instance().getHostTarget())
+      return;
     CUresult ret = cuStreamSynchronize(QDPcudastreams[TRANSFER]);
     CudaRes("cuStreamSynchronize",ret);    
   }
 
   void CudaRecordAndWaitEvent() {
+    if (DeviceParams::Instance().getHostTarget())
+      return;
     cuEventRecord( *QDPevCopied , QDPcudastreams[TRANSFER] );
     cuStreamWaitEvent( QDPcudastreams[KERNEL] , *QDPevCopied , 0);
   }
 
+  // The kernel stream is a blocking stream, the event also covers
+  // kernels launched on the default stream (tuned launches)
+  void CudaTransferWaitKernel() {
+    if (DeviceParams::Instance().getHostTarget())
+      return;
+    CUresult ret = cuEventRecord( *QDPevKernelDone , QDPcudastreams[KERNEL] );
+    CudaRes("cuEventRecord",ret);
+    ret = cuStreamWaitEvent( QDPcudastreams[TRANSFER] , *QDPevKernelDone , 0 );
+    CudaRes("cuStreamWaitEvent",ret);
+  }
+
+  void CudaSetCurrentContext()
+  {
+    if (DeviceParams::Instance().getHostTarget())
+      return;
+    CUresult ret = cuCtxSetCurrent(cuContext);
+    CudaRes(__func__,ret);
+  }
+
   void CudaSetDevice(int dev)
   {
     CUresult ret;
 
+    if (DeviceParams::Instance().getHostTarget())
+      return;
+
     QDP_info_primary("trying to get device %d",dev);
     ret = cuDeviceGet(&cuDevice, dev);
     CudaRes(__func__,ret);
@@ -312,14 +398,23 @@ namespace QDP {
 
     DeviceParams::Instance().autoDetect();
 
+    bool host = DeviceParams::Instance().getHostTarget();
+
     size_t free, total;
-    ret = cuMemGetInfo(&free, &total);
-    CudaRes("cuMemGetInfo",ret);
+    if (host) {
+      size_t page = sysconf(_SC_PAGESIZE);
+      free  = (size_t)sysconf(_SC_AVPHYS_PAGES) * page;
+      total = (size_t)sysconf(_SC_PHYS_PAGES) * page;
+    } else {
+      ret = cuMemGetInfo(&free, &total);
+      CudaRes("cuMemGetInfo",ret);
+    }
 
-    QDP_info_primary("GPU memory: free = %lld,  total = %lld",(unsigned long long)free ,(unsigned long long)total);
+    QDP_info_primary("%s memory: free = %lld,  total = %lld",host ? "Host" : "GPU",(unsigned long long)free ,(unsigned long long)total);
     if (!setPoolSize) {
 
-      size_t val = (size_t)((double)(0.90) * (double)free);
+      // On the host target the pool shares memory with the host copies
+      size_t val = (size_t)((double)(host ? 0.45 : 0.90) * (double)free);
       int val_in_MiB = val/1024/1024;
 
       if (val_in_MiB < 1)
@@ -351,6 +446,9 @@ namespace QDP {
     // int minor = DeviceParams::Instance().getMinor();
     // PTX::ptx_type_matrix = PTX::create_ptx_type_matrix();
 
+    if (host)
+      return;
+
     ret = cuCtxSetCacheConfig(CU_FUNC_CACHE_PREFER_L1);
     CudaRes("cuCtxSetCacheConfig",ret);
   }
@@ -359,6 +457,10 @@ namespace QDP {
 
   void CudaGetDeviceCount(int * count)
   {
+    if (DeviceParams::Instance().getHostTarget()) {
+      *count = 1;
+      return;
+    }
     cuDeviceGetCount( count );
   }
 
@@ -367,6 +469,8 @@ namespace QDP {
   {
     CUresult ret;
     int flags = 0;
+    if (DeviceParams::Instance().getHostTarget())
+      return true;
     QDP_info_primary("CUDA host register ptr=%p (%u) size=%lu (%u)",ptr,(unsigned)((size_t)ptr%4096) ,(unsigned long)size,(unsigned)((size_t)size%4096));
     ret = cuMemHostRegister(ptr, size, flags);
     CudaRes("cuMemHostRegister",ret);
@@ -377,6 +481,8 @@ namespace QDP {
   void CudaHostUnregister(void * ptr )
   {
     CUresult ret;
+    if (DeviceParams::Instance().getHostTarget())
+      return;
     ret = cuMemHostUnregister(ptr);
     CudaRes("cuMemHostUnregister",ret);
   }
@@ -385,6 +491,10 @@ namespace QDP {
   bool CudaHostAlloc(void **mem , const size_t size, const int flags)
   {
     CUresult ret;
+    if (DeviceParams::Instance().getHostTarget()) {
+      *mem = malloc(size);
+      return *mem != NULL;
+    }
     ret = cuMemHostAlloc(mem,size,flags);
     CudaRes("cudaHostAlloc",ret);
     return ret == CUDA_SUCCESS;
@@ -394,6 +504,10 @@ namespace QDP {
   void CudaHostFree(void *mem)
   {
     CUresult ret;
+    if (DeviceParams::Instance().getHostTarget()) {
+      free(mem);
+      return;
+    }
     ret = cuMemFreeHost(mem);
     CudaRes("cuMemFreeHost",ret);
   }
@@ -445,6 +559,11 @@ namespace QDP {
     QDP_debug_deep("CudaMemcpyH2DAsync dest=%p src=%p size=%d" ,  dest , src , size );
 #endif
 
+    if (DeviceParams::Instance().getHostTarget()) {
+      memcpy( dest , src , size );
+      return;
+    }
+
     if (DeviceParams::Instance().getAsyncTransfers()) {
       ret = cuMemcpyHtoDAsync((CUdeviceptr)const_cast<void*>(dest),
 			      src,
@@ -466,6 +585,11 @@ namespace QDP {
     QDP_debug_deep("CudaMemcpyD2HAsync dest=%p src=%p size=%d" ,  dest , src , size );
 #endif
 
+    if (DeviceParams::Instance().getHostTarget()) {
+      memcpy( dest , src , size );
+      return;
+    }
+
     if (DeviceParams::Instance().getAsyncTransfers()) {
       ret = cuMemcpyDtoHAsync( dest,
 			      (CUdeviceptr)const_cast<void*>(src),
@@ -487,6 +611,11 @@ namespace QDP {
 #ifdef GPU_DEBUG_DEEP
     QDP_debug_deep("CudaMemcpyH2D dest=%p src=%p size=%d" ,  dest , src , size );
 #endif
+
+    if (DeviceParams::Instance().getHostTarget()) {
+      memcpy( dest , src , size );
+      return;
+    }
     ret = cuMemcpyHtoD((CUdeviceptr)const_cast<void*>(dest), src, size);
     CudaRes("cuMemcpyH2D",ret);
   }
@@ -497,14 +626,38 @@ namespace QDP {
 #ifdef GPU_DEBUG_DEEP
     QDP_debug_deep("CudaMemcpyD2H dest=%p src=%p size=%d" ,  dest , src , size );
 #endif
+
+    if (DeviceParams::Instance().getHostTarget()) {
+      memcpy( dest , src , size );
+      return;
+    }
     ret = cuMemcpyDtoH( dest, (CUdeviceptr)const_cast<void*>(src), size);
     CudaRes("cuMemcpyD2H",ret);
   }
 
+  void CudaMemcpyD2D( void * dest , const void * src , size_t size )
+  {
+    CUresult ret;
+#ifdef GPU_DEBUG_DEEP
+    QDP_debug_deep("CudaMemcpyD2D dest=%p src=%p size=%d" ,  dest , src , size );
+#endif
+
+    if (DeviceParams::Instance().getHostTarget()) {
+      memcpy( dest , src , size );
+      return;
+    }
+    ret = cuMemcpyDtoD( (CUdeviceptr)dest, (CUdeviceptr)const_cast<void*>(src), size);
+    CudaRes("cuMemcpyD2D",ret);
+  }
+
 
   bool CudaMalloc(void **mem , size_t size )
   {
     CUresult ret;
+    if (DeviceParams::Instance().getHostTarget()) {
+      *mem = malloc(size);
+      return *mem != NULL;
+    }
 #ifndef QDP_USE_CUDA_MANAGED_MEMORY
     ret = cuMemAlloc( (CUdeviceptr*)mem,size);
 #else
@@ -530,6 +683,10 @@ namespace QDP {
     QDP_debug_deep( "CudaFree %p", mem );
 #endif
     CUresult ret;
+    if (DeviceParams::Instance().getHostTarget()) {
+      free(const_cast<void*>(mem));
+      return;
+    }
     ret = cuMemFree((CUdeviceptr)const_cast<void*>(mem));
     CudaRes("cuMemFree",ret);
   }
@@ -539,6 +696,8 @@ namespace QDP {
 #ifdef GPU_DEBUG_DEEP
     QDP_debug_deep( "cudaThreadSynchronize" );
 #endif
+    if (DeviceParams::Instance().getHostTarget())
+      return;
     cuCtxSynchronize();
   }
 
@@ -547,6 +706,8 @@ namespace QDP {
 #ifdef GPU_DEBUG_DEEP
     QDP_debug_deep( "cudaDeviceSynchronize" );
 #endif
+    if (DeviceParams::Instance().getHostTarget())
+      return;
     CUresult ret = cuCtxSynchronize();
     CudaRes("cuCtxSynchronize",ret);
   }
@@ -1,5 +1,9 @@
 #include "qdp.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace QDP {
 
 #if 0
@@ -73,5 +77,190 @@ namespace QDP {
   }
 
 
+  //
+  // Host layout <-> coalesced device layout
+  //
+  // Per site the host layout holds E = lim_rea*lim_col*lim_spi words
+  // while the device layout holds E arrays of sitesOnNode words. The
+  // conversion is a transpose of a sites x E matrix with the component
+  // index permuted (reality fastest on the host, slowest on the
+  // device). The sites are cut in tiles that are spread across the
+  // host threads. Inside a tile the component loop is outermost, so the
+  // device side is streamed contiguously while the host side rows of
+  // the tile stay in cache. Where E allows it 2x2 (64 bit words) or 4x4
+  // (32 bit words) blocks are transposed in SSE registers.
+  //
+  namespace {
+
+    struct transpose_args_t;
+    typedef void (*transpose_kernel_t)( const transpose_args_t& a , int lo , int hi );
+
+    struct transpose_args_t {
+      bool        toDev;
+      char*       out;
+      const char* in;
+      size_t      E;
+      size_t      N;
+      int         tile;
+      const int*  comp;   // device component of host component e
+      transpose_kernel_t kernel;
+    };
+
+
+    template<class W>
+    void transpose_scalar( const transpose_args_t& a , int lo , int hi )
+    {
+      W*       out = (W*)a.out;
+      const W* in  = (const W*)a.in;
+
+      for ( size_t e = 0 ; e < a.E ; ++e ) {
+	size_t d = a.comp[e] * a.N;
+	if (a.toDev)
+	  for ( size_t site = lo ; site < (size_t)hi ; ++site )
+	    out[ d + site ] = in[ site * a.E + e ];
+	else
+	  for ( size_t site = lo ; site < (size_t)hi ; ++site )
+	    out[ site * a.E + e ] = in[ d + site ];
+      }
+    }
+
+
+#ifdef __SSE2__
+    // 64 bit words, requires even E
+    void transpose_2x2( const transpose_args_t& a , int lo , int hi )
+    {
+      uint64_t*       out = (uint64_t*)a.out;
+      const uint64_t* in  = (const uint64_t*)a.in;
+      const size_t E = a.E;
+
+      int hi2 = lo + ( (hi - lo) & ~1 );
+
+      for ( size_t e = 0 ; e < E ; e += 2 ) {
+	size_t d0 = a.comp[e]     * a.N;
+	size_t d1 = a.comp[e + 1] * a.N;
+	for ( size_t site = lo ; site < (size_t)hi2 ; site += 2 ) {
+	  if (a.toDev) {
+	    __m128i x0 = _mm_loadu_si128( (const __m128i*)( in + site * E + e ) );
+	    __m128i x1 = _mm_loadu_si128( (const __m128i*)( in + (site + 1) * E + e ) );
+	    _mm_storeu_si128( (__m128i*)( out + d0 + site ) , _mm_unpacklo_epi64( x0 , x1 ) );
+	    _mm_storeu_si128( (__m128i*)( out + d1 + site ) , _mm_unpackhi_epi64( x0 , x1 ) );
+	  } else {
+	    __m128i x0 = _mm_loadu_si128( (const __m128i*)( in + d0 + site ) );
+	    __m128i x1 = _mm_loadu_si128( (const __m128i*)( in + d1 + site ) );
+	    _mm_storeu_si128( (__m128i*)( out + site * E + e ) ,       _mm_unpacklo_epi64( x0 , x1 ) );
+	    _mm_storeu_si128( (__m128i*)( out + (site + 1) * E + e ) , _mm_unpackhi_epi64( x0 , x1 ) );
+	  }
+	}
+      }
+
+      if (hi2 < hi)
+	transpose_scalar<uint64_t>( a , hi2 , hi );
+    }
+
+
+    // 32 bit words, requires E divisible by 4
+    void transpose_4x4( const transpose_args_t& a , int lo , int hi )
+    {
+      uint32_t*       out = (uint32_t*)a.out;
+      const uint32_t* in  = (const uint32_t*)a.in;
+      const size_t E = a.E;
+
+      int hi4 = lo + ( (hi - lo) & ~3 );
+
+      for ( size_t e = 0 ; e < E ; e += 4 ) {
+	size_t d[4];
+	for ( int k = 0 ; k < 4 ; ++k )
+	  d[k] = a.comp[e + k] * a.N;
+
+	for ( size_t site = lo ; site < (size_t)hi4 ; site += 4 ) {
+	  __m128i r[4];
+	  for ( int k = 0 ; k < 4 ; ++k )
+	    r[k] = _mm_loadu_si128( (const __m128i*)( a.toDev ? in + (site + k) * E + e : in + d[k] + site ) );
+
+	  __m128i t0 = _mm_unpacklo_epi32( r[0] , r[1] );
+	  __m128i t1 = _mm_unpacklo_epi32( r[2] , r[3] );
+	  __m128i t2 = _mm_unpackhi_epi32( r[0] , r[1] );
+	  __m128i t3 = _mm_unpackhi_epi32( r[2] , r[3] );
+
+	  __m128i c[4];
+	  c[0] = _mm_unpacklo_epi64( t0 , t1 );
+	  c[1] = _mm_unpackhi_epi64( t0 , t1 );
+	  c[2] = _mm_unpacklo_epi64( t2 , t3 );
+	  c[3] = _mm_unpackhi_epi64( t2 , t3 );
+
+	  for ( int k = 0 ; k < 4 ; ++k )
+	    _mm_storeu_si128( (__m128i*)( a.toDev ? out + d[k] + site : out + (site + k) * E + e ) , c[k] );
+	}
+      }
+
+      if (hi4 < hi)
+	transpose_scalar<uint32_t>( a , hi4 , hi );
+    }
+#endif
+
+
+    void transpose_func( int lo , int hi , int myId , transpose_args_t* a )
+    {
+      for ( int t = lo ; t < hi ; ++t ) {
+	int s0 = t * a->tile;
+	int s1 = std::min( (size_t)(s0 + a->tile) , a->N );
+	a->kernel( *a , s0 , s1 );
+      }
+    }
+
+  } // namespace
+
+
+  void datalayout_transpose( bool toDev , void * out , const void * in , size_t word_size ,
+			     int lim_rea , int lim_col , int lim_spi , int sites )
+  {
+    transpose_args_t a;
+    a.toDev = toDev;
+    a.out   = (char*)out;
+    a.in    = (const char*)in;
+    a.E     = (size_t)lim_rea * lim_col * lim_spi;
+    a.N     = sites;
+
+    std::vector<int> comp( a.E );
+    for ( int reality = 0 ; reality < lim_rea ; reality++ )
+      for ( int color = 0 ; color < lim_col ; color++ )
+	for ( int spin = 0 ; spin < lim_spi ; spin++ )
+	  comp[ reality + lim_rea * color + lim_rea * lim_col * spin ] = spin + lim_spi * color + lim_spi * lim_col * reality;
+    a.comp = comp.data();
+
+    // About 16kB of host side data per tile, a multiple of 16 sites
+    a.tile = std::max( (int)( 16384 / ( a.E * word_size ) ) & ~15 , 16 );
+
+    switch (word_size) {
+    case 8:
+#ifdef __SSE2__
+      a.kernel = a.E % 2 == 0 ? transpose_2x2 : transpose_scalar<uint64_t>;
+#else
+      a.kernel = transpose_scalar<uint64_t>;
+#endif
+      break;
+    case 4:
+#ifdef __SSE2__
+      a.kernel = a.E % 4 == 0 ? transpose_4x4 : transpose_scalar<uint32_t>;
+#else
+      a.kernel = transpose_scalar<uint32_t>;
+#endif
+      break;
+    case 2:
+      a.kernel = transpose_scalar<uint16_t>;
+      break;
+    case 1:
+      a.kernel = transpose_scalar<uint8_t>;
+      break;
+    default:
+      QDP_error_exit("datalayout_transpose: unsupported word size %d",(int)word_size);
+    }
+
+    int tiles = ( sites + a.tile - 1 ) / a.tile;
+
+    dispatch_to_threads( tiles , a , transpose_func );
+  }
+
+
 
 } // namespace
@@ -3,6 +3,7 @@
  */
 
 #include "qdp.h"
+#include <mutex>
 
 #if defined(QDP_DEBUG_MEMORY)
 #include <stack>
@@ -47,6 +48,10 @@ namespace Allocator {
   // Anonymous namespace
   namespace {
     MapT the_alignment_map;
+
+    // Cache entries are created and destroyed from several host
+    // threads, the map is only locked while it is updated
+    std::mutex mtx_alignment_map;
   }
 
   // The type returned on map insertion, allows me to check
@@ -86,6 +91,8 @@ namespace Allocator {
     // Work out the aligned pointer
     aligned = (unsigned char *)( ( (unsigned long)unaligned + (QDP_ALIGNMENT_SIZE-1) ) & ~(QDP_ALIGNMENT_SIZE - 1));
 
+    std::lock_guard<std::mutex> lock( mtx_alignment_map );
+
 #if defined(QDP_DEBUG_MEMORY)
     // Current location
     FuncInfo_t& info = infostack.top();
@@ -112,30 +119,35 @@ namespace Allocator {
   //! Free an aligned pointer, which was allocated by us.
   void 
   QDPDefaultAllocator::free(void *mem) { 
-    unsigned char* unaligned; 
+    unsigned char* unaligned = NULL;
+
+    {
+      std::lock_guard<std::mutex> lock( mtx_alignment_map );
 
-    // Look up the original unaligned pointer in the memory. 
-    MapT::iterator iter = the_alignment_map.find((unsigned char*)mem);
-    if( iter != the_alignment_map.end() ) 
-    { 
+      // Look up the original unaligned pointer in the memory. 
+      MapT::iterator iter = the_alignment_map.find((unsigned char*)mem);
+      if( iter != the_alignment_map.end() ) 
+      { 
 #if defined(QDP_DEBUG_MEMORY)
-      // Find the original unaligned pointer
-      unaligned = iter->second.unaligned;
+	// Find the original unaligned pointer
+	unaligned = iter->second.unaligned;
 #else
-      // Find the original unaligned pointer
-      unaligned = iter->second;
+	// Find the original unaligned pointer
+	unaligned = iter->second;
 #endif
       
-      // Remove its entry from the map
-      the_alignment_map.erase(iter);
-
-      // Delete the actual unaligned pointer
-      delete [] unaligned;
+	// Remove its entry from the map
+	the_alignment_map.erase(iter);
+      }
     }
-    else { 
+
+    if (!unaligned) {
       QDPIO::cerr << "Pointer not found in map" << endl;
       QDP_abort(1);
     }
+
+    // Delete the actual unaligned pointer
+    delete [] unaligned;
   }
 
 
@@ -146,6 +158,7 @@ namespace Allocator {
   {
      if ( Layout::primaryNode() )
      {
+       std::lock_guard<std::mutex> lock( mtx_alignment_map );
        size_t sum = 0;
        typedef MapT::const_iterator CI;
        QDPIO::cout << "Dumping memory map" << endl;
@@ -164,6 +177,7 @@ namespace Allocator {
   void
   QDPDefaultAllocator::pushFunc(const char* func, int line)
   {
+    std::lock_guard<std::mutex> lock( mtx_alignment_map );
     infostack.push(FuncInfo_t(func,line));
   }
 
@@ -171,6 +185,7 @@ namespace Allocator {
   void
   QDPDefaultAllocator::popFunc()
   {
+    std::lock_guard<std::mutex> lock( mtx_alignment_map );
     if (infostack.empty())
     {
       QDPIO::cerr << __func__ << ": invalid pop" << endl;
@@ -198,6 +213,7 @@ namespace Allocator {
   {
      if ( Layout::primaryNode() )
      {
+       std::lock_guard<std::mutex> lock( mtx_alignment_map );
        typedef MapT::const_iterator CI;
        QDPIO::cout << "Dumping memory map" << endl;
        for( CI j = the_alignment_map.begin();
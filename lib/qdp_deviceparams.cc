@@ -24,6 +24,11 @@ namespace QDP {
 
 
   void DeviceParams::autoDetect() {
+    if (hostTarget) {
+      autoDetectHost();
+      return;
+    }
+
     unifiedAddressing = CudaGetConfig(CU_DEVICE_ATTRIBUTE_UNIFIED_ADDRESSING) == 1;
     asyncTransfers = CudaGetConfig(CU_DEVICE_ATTRIBUTE_GPU_OVERLAP) == 1;
     smem = CudaGetConfig( CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_BLOCK );
@@ -41,7 +46,9 @@ namespace QDP {
     major = ma;
     minor = mi;
     divRnd = major >= 2;
+    device_name = CudaGetDeviceName();
 
+    QDP_info_primary("Device                                  = %s",device_name.c_str());
     QDP_info_primary("Compute capability (major)              = %d",major);
     QDP_info_primary("Compute capability (minor)              = %d",minor);
     QDP_info_primary("Divide with IEEE 754 compliant rounding = %d",divRnd);
@@ -57,6 +64,30 @@ namespace QDP {
     QDP_info_primary("max_blockz                              = %d",max_blockz);
   }
 
+  //
+  // On the host target a 'thread' is one site of the outer site loop
+  // which is split across the cores. Grid/block limits only matter to
+  // the launch geometry bookkeeping and are set to values that never
+  // constrain it.
+  //
+  void DeviceParams::autoDetectHost() {
+    unifiedAddressing = true;
+    asyncTransfers = false;
+    smem = 1 << 24;     // shared memory of a block is a buffer of the host thread
+    smem_default = 0;
+    max_gridx = max_gridy = max_gridz = 1 << 30;
+    max_blockx = max_blocky = max_blockz = 1024;
+    major = 0;
+    minor = 0;
+    divRnd = true;
+    device_name = llvm::sys::getHostCPUName().str();
+
+    QDP_info_primary("Host target: generating code for %s (%s)",
+		     llvm::sys::getProcessTriple().c_str(),
+		     llvm::sys::getHostCPUName().str().c_str());
+    QDP_info_primary("Host target: number of threads            = %d",qdpNumThreads());
+  }
+
   void DeviceParams::setSM(int sm) {
     QDP_info_primary("Compiling LLVM IR to PTX for compute capability sm_%d (instead of autodetect)",sm);
     major = sm / 10;
@@ -0,0 +1,134 @@
+#include "qdp.h"
+#include "qdp_jit_pool.h"
+
+namespace QDP {
+
+  void JitCompilePool::setThreads( int n )
+  {
+    if (!workers.empty())
+      QDP_error_exit("JIT compile pool: cannot change the number of threads after start");
+    threads = n;
+  }
+
+
+  void JitCompilePool::worker()
+  {
+    llvm::LLVMContext context;
+
+    while (true) {
+      job_t job;
+      {
+	std::unique_lock<std::mutex> lock(mtx);
+	cv.wait( lock , [this]{ return stop || !jobs.empty(); } );
+	if (stop && jobs.empty())
+	  return;
+	job = std::move( jobs.front() );
+	jobs.pop_front();
+      }
+      job( context );
+    }
+  }
+
+
+  std::shared_future<std::string> JitCompilePool::submit( const std::string& bitcode , const std::string& db_id )
+  {
+    assert( threads > 0 );
+
+    job_t job( [bitcode,db_id]( llvm::LLVMContext& context ) {
+	std::string ptx = llvm_compile_bitcode( context , bitcode );
+	if (!db_id.empty())
+	  llvm_ptx_db_store( db_id , ptx );
+	return ptx;
+      });
+    std::shared_future<std::string> ret = job.get_future().share();
+
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      if (workers.empty()) {
+	QDP_info_primary("JIT compile pool: starting %d threads",threads);
+	for (int i = 0 ; i < threads ; ++i)
+	  workers.emplace_back( &JitCompilePool::worker , this );
+      }
+      jobs.push_back( std::move(job) );
+    }
+    cv.notify_one();
+
+    return ret;
+  }
+
+
+  void JitCompilePool::shutdown()
+  {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      stop = true;
+    }
+    cv.notify_all();
+    for (std::thread& t : workers)
+      t.join();
+    workers.clear();
+  }
+
+
+
+  struct jit_pending_t {
+    std::shared_future<std::string> ptx;
+    std::string fname;
+    CUfunction  func;
+  };
+
+  // Handles of placeholders have the lowest bit set, a loaded kernel
+  // is recognized without lookup
+  namespace {
+    int pending_count = 0;
+
+    jit_pending_t* jit_pending( CUfunction f )
+    {
+      if ( pending_count == 0 || !( reinterpret_cast<uintptr_t>( f ) & 1 ) )
+	return NULL;
+      return reinterpret_cast<jit_pending_t*>( reinterpret_cast<uintptr_t>( f ) & ~(uintptr_t)1 );
+    }
+  }
+
+
+  CUfunction jit_pending_function( std::shared_future<std::string> ptx , const std::string& fname )
+  {
+    jit_pending_t* p = new jit_pending_t;
+    p->ptx   = ptx;
+    p->fname = fname;
+    p->func  = NULL;
+    pending_count++;
+
+    return reinterpret_cast<CUfunction>( reinterpret_cast<uintptr_t>( p ) | 1 );
+  }
+
+
+  CUfunction jit_resolve_function( CUfunction f )
+  {
+    jit_pending_t* p = jit_pending( f );
+    if (!p)
+      return f;
+
+    if (!p->func) {
+      std::string ptx = p->ptx.get();
+      p->func = get_fptr_from_ptx( p->fname.c_str() , ptx );
+    }
+    return p->func;
+  }
+
+
+  CUfunction jit_loaded_function( CUfunction f )
+  {
+    jit_pending_t* p = jit_pending( f );
+    if (!p)
+      return f;
+
+    CUfunction func = jit_resolve_function( f );
+    llvm_move_function_id( f , func );
+
+    delete p;
+    pending_count--;
+    return func;
+  }
+
+}
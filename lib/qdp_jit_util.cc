@@ -13,16 +13,21 @@ namespace QDP {
     long lattice2dev  = 0;   // changing lattice data layout to device format
     long lattice2host = 0;   // changing lattice data layout to host format
     long jitted       = 0;   // functions not in DB, thus jit-built
+    long fused        = 0;   // statements evaluated in fused kernels
+    long fused_reads  = 0;   // reads of lattices written earlier in the same fused kernel
   }
 
 
   void jit_stats_lattice2dev()  { ++JITSTATS::lattice2dev; }
   void jit_stats_lattice2host() { ++JITSTATS::lattice2host; }
   void jit_stats_jitted()       { ++JITSTATS::jitted; }
+  void jit_stats_fused( int stmts , int reads ) { JITSTATS::fused += stmts; JITSTATS::fused_reads += reads; }
 
   long get_jit_stats_lattice2dev()  { return JITSTATS::lattice2dev; }
   long get_jit_stats_lattice2host() { return JITSTATS::lattice2host; }
   long get_jit_stats_jitted()       { return JITSTATS::jitted; }
+  long get_jit_stats_fused()        { return JITSTATS::fused; }
+  long get_jit_stats_fused_reads()  { return JITSTATS::fused_reads; }
 
 
   // seedMultiply
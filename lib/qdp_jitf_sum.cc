@@ -11,20 +11,16 @@ namespace QDP {
     int lo = 0;
     int hi = size;
 
-    JitParam jit_lo( QDP_get_global_cache().addJitParamInt( lo ) );
-    JitParam jit_hi( QDP_get_global_cache().addJitParamInt( hi ) );
-  
-    std::vector<int> ids;
-    ids.push_back( jit_lo.get_id() );
-    ids.push_back( jit_hi.get_id() );
-    ids.push_back( siteTableId );
-    ids.push_back( in_id );
-    ids.push_back( out_id );
+    QDPJitArgs args;
+    args.addInt( lo );
+    args.addInt( hi );
+    args.addId( siteTableId );
+    args.addId( in_id );
+    args.addId( out_id );
  
-    std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
-    kernel_geom_t now = getGeom( hi-lo , threads );
+    QDP_get_global_cache().setKernelReadOnly( { siteTableId , in_id } );
 
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &args[0] , 0);
+    jit_launch_explicit( function , hi-lo , threads , shared_mem_usage , args );
   }
 
 
@@ -38,20 +34,18 @@ namespace QDP {
   {
     int sizes_id = QDP_get_global_cache().add( sizes.size()*sizeof(int) , QDPCache::Flags::OwnHostMemory , QDPCache::Status::host , sizes.slice() , NULL , NULL );
 
-    JitParam jit_numsubsets( QDP_get_global_cache().addJitParamInt( numsubsets ) );
-    JitParam jit_tables(     QDP_get_global_cache().addMulti(       table_ids  ) );
+    JitParam jit_tables( QDP_get_global_cache().addMulti( table_ids ) );
 						      
-    std::vector<int> ids;
-    ids.push_back( jit_numsubsets.get_id() );
-    ids.push_back( sizes_id );
-    ids.push_back( jit_tables.get_id() );
-    ids.push_back( in_id );
-    ids.push_back( out_id );
+    QDPJitArgs args;
+    args.addInt( numsubsets );
+    args.addId( sizes_id );
+    args.addId( jit_tables.get_id() );
+    args.addId( in_id );
+    args.addId( out_id );
  
-    std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
-    kernel_geom_t now = getGeom( size , threads );
+    QDP_get_global_cache().setKernelReadOnly( { sizes_id , in_id } );
 
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &args[0] , 0);
+    jit_launch_explicit( function , size , threads , shared_mem_usage , args );
 
     QDP_get_global_cache().signoff(sizes_id);
   }
@@ -67,18 +61,15 @@ namespace QDP {
   {
     int sizes_id = QDP_get_global_cache().add( sizes.size()*sizeof(int) , QDPCache::Flags::OwnHostMemory , QDPCache::Status::host , sizes.slice() , NULL , NULL );
 
-    JitParam jit_numsubsets( QDP_get_global_cache().addJitParamInt( numsubsets ) );
-						      
-    std::vector<int> ids;
-    ids.push_back( jit_numsubsets.get_id() );
-    ids.push_back( sizes_id );
-    ids.push_back( in_id );
-    ids.push_back( out_id );
+    QDPJitArgs args;
+    args.addInt( numsubsets );
+    args.addId( sizes_id );
+    args.addId( in_id );
+    args.addId( out_id );
  
-    std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
-    kernel_geom_t now = getGeom( size , threads );
+    QDP_get_global_cache().setKernelReadOnly( { sizes_id , in_id } );
 
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &args[0] , 0);
+    jit_launch_explicit( function , size , threads , shared_mem_usage , args );
 
     QDP_get_global_cache().signoff(sizes_id);
   }
@@ -93,19 +84,15 @@ namespace QDP {
     int lo = 0;
     int hi = size;
 
-    JitParam jit_lo( QDP_get_global_cache().addJitParamInt( lo ) );
-    JitParam jit_hi( QDP_get_global_cache().addJitParamInt( hi ) );
-  
-    std::vector<int> ids;
-    ids.push_back( jit_lo.get_id() );
-    ids.push_back( jit_hi.get_id() );
-    ids.push_back( in_id );
-    ids.push_back( out_id );
+    QDPJitArgs args;
+    args.addInt( lo );
+    args.addInt( hi );
+    args.addId( in_id );
+    args.addId( out_id );
  
-    std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
-    kernel_geom_t now = getGeom( hi-lo , threads );
+    QDP_get_global_cache().setKernelReadOnly( { in_id } );
 
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &args[0] , 0);
+    jit_launch_explicit( function , hi-lo , threads , shared_mem_usage , args );
   }
 
 
@@ -119,19 +106,15 @@ namespace QDP {
     int lo = 0;
     int hi = size;
 
-    JitParam jit_lo( QDP_get_global_cache().addJitParamInt( lo ) );
-    JitParam jit_hi( QDP_get_global_cache().addJitParamInt( hi ) );
-  
-    std::vector<int> ids;
-    ids.push_back( jit_lo.get_id() );
-    ids.push_back( jit_hi.get_id() );
-    ids.push_back( in_id );
-    ids.push_back( out_id );
+    QDPJitArgs args;
+    args.addInt( lo );
+    args.addInt( hi );
+    args.addId( in_id );
+    args.addId( out_id );
  
-    std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
-    kernel_geom_t now = getGeom( hi-lo , threads );
+    QDP_get_global_cache().setKernelReadOnly( { in_id } );
 
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &args[0] , 0);
+    jit_launch_explicit( function , hi-lo , threads , shared_mem_usage , args );
   }
 
 
@@ -143,19 +126,15 @@ namespace QDP {
     int lo = 0;
     int hi = size;
 
-    JitParam jit_lo( QDP_get_global_cache().addJitParamInt( lo ) );
-    JitParam jit_hi( QDP_get_global_cache().addJitParamInt( hi ) );
-  
-    std::vector<int> ids;
-    ids.push_back( jit_lo.get_id() );
-    ids.push_back( jit_hi.get_id() );
-    ids.push_back( in_id );
-    ids.push_back( out_id );
+    QDPJitArgs args;
+    args.addInt( lo );
+    args.addInt( hi );
+    args.addId( in_id );
+    args.addId( out_id );
  
-    std::vector<void*> args( QDP_get_global_cache().get_kernel_args(ids) );
-    kernel_geom_t now = getGeom( hi-lo , threads );
+    QDP_get_global_cache().setKernelReadOnly( { in_id } );
 
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &args[0] , 0);
+    jit_launch_explicit( function , hi-lo , threads , shared_mem_usage , args );
   }
 
   
@@ -2,6 +2,8 @@
 #include "qdp_config.h"
 
 #include "qdp_libdevice.h"
+#include "qdp_ptx_db.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 //#include "nvvm.h"
 #include "llvm/InitializePasses.h"
 #include "llvm/IR/DataLayout.h"
@@ -22,7 +24,17 @@
 
 #include "llvm/Transforms/Utils/Cloning.h"
 
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/DynamicLibrary.h"
+
 #include <memory>
+#include <cmath>
+
+// isfinite for kernels on the host target. libm's finite/finitef are
+// deprecated, std::isfinite has no symbol the JIT could resolve.
+extern "C" int qdp_jit_isfinitef( float x ) { return std::isfinite( x ); }
+extern "C" int qdp_jit_isfinite( double x ) { return std::isfinite( x ); }
 
 namespace QDP {
 
@@ -42,10 +54,39 @@ namespace QDP {
   std::map<CUfunction,std::string> mapCUFuncPTX;
 
   std::string getPTXfromCUFunc(CUfunction f) {
-    return mapCUFuncPTX[f];
+    return mapCUFuncPTX[ jit_resolve_function(f) ];
+  }
+
+  // Loaded kernels that take 'sites per thread' (see llvm_build_driver)
+  std::set<CUfunction> setCUFuncSpt;
+
+  bool llvm_function_takes_spt(CUfunction f) {
+    return setCUFuncSpt.count( jit_resolve_function(f) ) > 0;
+  }
+
+  // Kernel identity (see get_ptx_db_id) of the functions handed out
+  // by the build functions, used to key the autotuning DB
+  std::map<CUfunction,std::string> mapCUFuncId;
+
+  std::string getIdfromCUFunc(CUfunction f) {
+    std::map<CUfunction,std::string>::iterator it = mapCUFuncId.find(f);
+    if (it == mapCUFuncId.end())
+      return "";
+    return it->second;
+  }
+
+  // A placeholder got replaced by the loaded kernel (jit_loaded_function)
+  void llvm_move_function_id( CUfunction from , CUfunction to ) {
+    std::map<CUfunction,std::string>::iterator it = mapCUFuncId.find(from);
+    if (it == mapCUFuncId.end())
+      return;
+    mapCUFuncId[to] = it->second;
+    mapCUFuncId.erase(it);
   }
 
   bool function_created;
+  bool function_uses_block;   // kernel uses thread block features (shared memory, barriers, ..)
+  bool function_block_reduce; // kernel exchanges data through jit_block_reduce only
 
   std::vector< llvm::Type* > vecParamType;
   std::vector< llvm::Value* > vecArgument;
@@ -55,6 +96,8 @@ namespace QDP {
   llvm::Value *r_arg_myId;
   llvm::Value *r_arg_ordered;
   llvm::Value *r_arg_start;
+  llvm::Value *r_arg_idx;
+  llvm::Value *r_arg_block;   // host target: jit_host_block_t*
 
   llvm::Type* llvm_type<float>::value;
   llvm::Type* llvm_type<double>::value;
@@ -88,11 +131,23 @@ namespace QDP {
     bool DisableSLPVectorization = false;
   }
 
+  namespace llvm_host {
+    // The execution engines own the generated host code
+    std::vector< std::unique_ptr< llvm::ExecutionEngine > > engines;
+  }
+
   namespace ptx_db {
-    bool db_enabled = false;
+    bool db_enabled = false;   // look up kernels before building them (PTX DB or pre-warm)
+    bool db_file = false;      // PTX DB file in use
     std::string dbname = "dummy.dat";
-    typedef std::map< std::string , std::string > DBType;
-    DBType db;
+    PTXDB db;
+  }
+
+  namespace llvm_prewarm {
+    bool enabled = false;
+    std::string fname;
+    PTXDB manifest;   // kernel id -> bitcode
+    std::map< std::string , std::shared_future<std::string> > pending;
   }
 
 
@@ -100,26 +155,52 @@ namespace QDP {
     return ptx_db::dbname;
   }
   bool get_ptx_db_enabled() {
-    return ptx_db::db_enabled;
+    return ptx_db::db_file;
   }
   int get_ptx_db_size() {
     return ptx_db::db.size();
   }
 
-  std::string get_ptx_db_id( const std::string& pretty )
+  // Bump when the calling convention of the generated kernels changes
+  const int kernel_abi = 3;
+
+  // The gather and the kernels of expressions with a shift read or
+  // write the halo buffers, their code depends on -halo-single
+  bool kernel_touches_halo( const std::string& pretty )
+  {
+    return pretty.find("function_gather_build") != std::string::npos ||
+      pretty.find("FnMap") != std::string::npos;
+  }
+
+  std::string get_kernel_id( const std::string& pretty )
   {
     std::ostringstream oss;
-    
-    oss << "sm_" <<  DeviceParams::Instance().getMajor() << DeviceParams::Instance().getMinor() << "_";
+
+    oss << "abi" << kernel_abi << "_";
 
     for ( int i = 0 ; i < Nd ; ++i )
       oss << Layout::subgridLattSize()[i] << "_";
 
+    // Halo kernels read and write the halo buffers in the wire precision
+    if (DeviceParams::Instance().getHaloSingle() && kernel_touches_halo( pretty ))
+      oss << "hs_";
+
     oss << pretty;
 
     return oss.str();
   }
 
+  std::string get_ptx_db_id( const std::string& pretty )
+  {
+    std::ostringstream oss;
+    
+    oss << "sm_" <<  DeviceParams::Instance().getMajor() << DeviceParams::Instance().getMinor() << "_";
+
+    oss << get_kernel_id( pretty );
+
+    return oss.str();
+  }
+
 
   CUfunction get_fptr_from_ptx( const char* fname , const std::string& kernel )
   {
@@ -148,6 +229,11 @@ namespace QDP {
     if (ret)
       QDP_error_exit("Error returned from cuModuleGetFunction. Abort.");
 
+    CUdeviceptr spt_ptr;
+    size_t spt_bytes;
+    if ( cuModuleGetGlobal( &spt_ptr , &spt_bytes , cuModule , "qdp_jit_spt" ) == CUDA_SUCCESS )
+      setCUFuncSpt.insert( func );
+
     mapCUFuncPTX[func] = kernel;
 
     return func;
@@ -159,27 +245,79 @@ namespace QDP {
   CUfunction llvm_ptx_db( const char * pretty )
   {
     std::string id = get_ptx_db_id( pretty );
-    
-    ptx_db::DBType::iterator it = ptx_db::db.find( id );
+    std::string ptx;
+    CUfunction func = NULL;
 
-    if ( it != ptx_db::db.end() )
+    std::map< std::string , std::shared_future<std::string> >::iterator it = llvm_prewarm::pending.find( get_kernel_id( pretty ) );
+
+    if ( ptx_db::db_file && ptx_db::db.find( id , ptx ) )
       {
-	return get_fptr_from_ptx( "generic.ptx" , it->second );
+	func = get_fptr_from_ptx( "generic.ptx" , ptx );
       }
-    else
+    else if ( it != llvm_prewarm::pending.end() )
       {
-	return NULL;
+	// Being compiled in the background from the pre-warm manifest
+	std::shared_future<std::string> f = it->second;
+	llvm_prewarm::pending.erase( it );
+	func = jit_pending_function( f , "generic.ptx" );
       }
+    else if ( ptx_db::db_file && ptx_db::db.wait_or_lease( id , ptx ) )
+      {
+	// Another rank compiled it while we were waiting. Otherwise we
+	// hold the lease and compile it ourselves.
+	func = get_fptr_from_ptx( "generic.ptx" , ptx );
+      }
+
+    if (func)
+      mapCUFuncId[ func ] = id;
+
+    return func;
+  }
+
+
+  void llvm_ptx_db_store( const std::string& id , const std::string& ptx )
+  {
+    // Append kernel to the DB and let waiting ranks pick it up. Called
+    // from the JIT compile pool for kernels compiled in the background.
+    ptx_db::db.append( id , ptx );
+    ptx_db::db.release_lease( id );
   }
 
 
 
   void llvm_set_ptxdb( const char * c_str ) {
     ptx_db::db_enabled = true;
+    ptx_db::db_file = true;
     ptx_db::dbname = std::string( c_str );
   }
+
+
+  void llvm_set_prewarm( const char * c_str ) {
+    ptx_db::db_enabled = true;
+    llvm_prewarm::enabled = true;
+    llvm_prewarm::fname = std::string( c_str );
+  }
+
+
+  void llvm_set_threads( int n ) {
+    JitCompilePool::Instance().setThreads( n );
+  }
   
 
+  void llvm_set_target( const char * c_str ) {
+    std::string str(c_str);
+    if (str == "host") {
+      DeviceParams::Instance().setHostTarget(true);
+      return;
+    }
+    if (str == "nvptx") {
+      DeviceParams::Instance().setHostTarget(false);
+      return;
+    }
+    QDP_error_exit("unknown llvm-target argument: %s",c_str);
+  }
+
+
   void llvm_set_opt( const char * c_str ) {
     std::string str(c_str);
     if (str.find("DisableInline") != string::npos) {
@@ -344,10 +482,77 @@ namespace QDP {
   }
 
 
+  llvm::Function *llvm_declare_libm( const char * name , llvm::Type* ret , llvm::Type* arg , int nargs )
+  {
+    std::vector< llvm::Type* > args( nargs , arg );
+    llvm::FunctionType *funcType = llvm::FunctionType::get( ret , args , false );
+    return llvm::cast<llvm::Function>( Mod->getOrInsertFunction( name , funcType ) );
+  }
+
+
+  //
+  // On the host target the math functions are resolved
+  // against the process' libm when the module is JIT'ed
+  //
+  void llvm_setup_host_math_functions() 
+  {
+    llvm::Type* f32 = llvm::Type::getFloatTy(TheContext);
+    llvm::Type* f64 = llvm::Type::getDoubleTy(TheContext);
+    llvm::Type* i32 = llvm::Type::getInt32Ty(TheContext);
+
+    func_sin_f32 = llvm_declare_libm( "sinf" , f32 , f32 , 1 );
+    func_acos_f32 = llvm_declare_libm( "acosf" , f32 , f32 , 1 );
+    func_asin_f32 = llvm_declare_libm( "asinf" , f32 , f32 , 1 );
+    func_atan_f32 = llvm_declare_libm( "atanf" , f32 , f32 , 1 );
+    func_ceil_f32 = llvm_declare_libm( "ceilf" , f32 , f32 , 1 );
+    func_floor_f32 = llvm_declare_libm( "floorf" , f32 , f32 , 1 );
+    func_cos_f32 = llvm_declare_libm( "cosf" , f32 , f32 , 1 );
+    func_cosh_f32 = llvm_declare_libm( "coshf" , f32 , f32 , 1 );
+    func_exp_f32 = llvm_declare_libm( "expf" , f32 , f32 , 1 );
+    func_log_f32 = llvm_declare_libm( "logf" , f32 , f32 , 1 );
+    func_log10_f32 = llvm_declare_libm( "log10f" , f32 , f32 , 1 );
+    func_sinh_f32 = llvm_declare_libm( "sinhf" , f32 , f32 , 1 );
+    func_tan_f32 = llvm_declare_libm( "tanf" , f32 , f32 , 1 );
+    func_tanh_f32 = llvm_declare_libm( "tanhf" , f32 , f32 , 1 );
+    func_fabs_f32 = llvm_declare_libm( "fabsf" , f32 , f32 , 1 );
+    func_sqrt_f32 = llvm_declare_libm( "sqrtf" , f32 , f32 , 1 );
+    func_isfinite_f32 = llvm_declare_libm( "qdp_jit_isfinitef" , i32 , f32 , 1 );
+
+    func_pow_f32 = llvm_declare_libm( "powf" , f32 , f32 , 2 );
+    func_atan2_f32 = llvm_declare_libm( "atan2f" , f32 , f32 , 2 );
+
+    func_sin_f64 = llvm_declare_libm( "sin" , f64 , f64 , 1 );
+    func_acos_f64 = llvm_declare_libm( "acos" , f64 , f64 , 1 );
+    func_asin_f64 = llvm_declare_libm( "asin" , f64 , f64 , 1 );
+    func_atan_f64 = llvm_declare_libm( "atan" , f64 , f64 , 1 );
+    func_ceil_f64 = llvm_declare_libm( "ceil" , f64 , f64 , 1 );
+    func_floor_f64 = llvm_declare_libm( "floor" , f64 , f64 , 1 );
+    func_cos_f64 = llvm_declare_libm( "cos" , f64 , f64 , 1 );
+    func_cosh_f64 = llvm_declare_libm( "cosh" , f64 , f64 , 1 );
+    func_exp_f64 = llvm_declare_libm( "exp" , f64 , f64 , 1 );
+    func_log_f64 = llvm_declare_libm( "log" , f64 , f64 , 1 );
+    func_log10_f64 = llvm_declare_libm( "log10" , f64 , f64 , 1 );
+    func_sinh_f64 = llvm_declare_libm( "sinh" , f64 , f64 , 1 );
+    func_tan_f64 = llvm_declare_libm( "tan" , f64 , f64 , 1 );
+    func_tanh_f64 = llvm_declare_libm( "tanh" , f64 , f64 , 1 );
+    func_fabs_f64 = llvm_declare_libm( "fabs" , f64 , f64 , 1 );
+    func_sqrt_f64 = llvm_declare_libm( "sqrt" , f64 , f64 , 1 );
+    func_isfinite_f64 = llvm_declare_libm( "qdp_jit_isfinite" , i32 , f64 , 1 );
+
+    func_pow_f64 = llvm_declare_libm( "pow" , f64 , f64 , 2 );
+    func_atan2_f64 = llvm_declare_libm( "atan2" , f64 , f64 , 2 );
+  }
+
+
   void llvm_setup_math_functions() 
   {
     //QDPIO::cout << "Setup math functions..\n";
 
+    if (DeviceParams::Instance().getHostTarget()) {
+      llvm_setup_host_math_functions();
+      return;
+    }
+
     // Cloning a module takes more time than creating the module from scratch
     // So, I am creating the libdevice module from the embedded bitcode.
     //
@@ -442,46 +647,35 @@ namespace QDP {
     QDPIO::cout << "LLVM optimization level : " << llvm_opt::opt_level << "\n";
     QDPIO::cout << "NVPTX Flush to zero     : " << llvm_opt::nvptx_FTZ << "\n";
 
-    if (ptx_db::db_enabled) {
-      // Load DB
-      QDPIO::cout << "Checking for PTX DB " << ptx_db::dbname << "\n";
-      std::ifstream f(ptx_db::dbname);
-      if (f.good()) 
-	{
-	  QDPIO::cout << "Reading in PTX DB " << ptx_db::dbname << "\n";
-	  BinaryFileReader db( ptx_db::dbname );
-
-	  while ( ! db.fail() )
-	    {
-	      int size1;
-	      db.read( size1 );
-	      if (db.fail())
-		break;
-	      char* buf1 = new char[size1];
-	      db.readArray( buf1 , 1 , size1 );
-	      if (db.fail())
-		break;
-
-	      int size2;
-	      db.read( size2 );
-	      if (db.fail())
-		break;
-	      char* buf2 = new char[size2];
-	      db.readArray( buf2 , 1 , size2 );
-	      if (db.fail())
-		break;
-
-	      QDPIO::cout << "ptx_db: read key_size=" << size1 << " ptx_size=" << size2 << "\n";
-
-	      std::string key(buf1,size1);
-	      std::string val(buf2,size2);
-	      ptx_db::db.insert( std::make_pair( key , val ) );
-
-	      delete[] buf1;
-	      delete[] buf2;
-	    }
-	  db.close();
-	}
+    if (DeviceParams::Instance().getHostTarget()) {
+      QDPIO::cout << "LLVM target             : host (" << llvm::sys::getProcessTriple() << ")\n";
+
+      // Make the symbols of the running process (libm) visible to the JIT
+      llvm::sys::DynamicLibrary::LoadLibraryPermanently( nullptr );
+      llvm::sys::DynamicLibrary::AddSymbol( "qdp_jit_isfinitef" , (void*)&qdp_jit_isfinitef );
+      llvm::sys::DynamicLibrary::AddSymbol( "qdp_jit_isfinite" , (void*)&qdp_jit_isfinite );
+
+      if (ptx_db::db_enabled) {
+	QDPIO::cout << "PTX DB and pre-warm manifest are not used with the host target\n";
+	ptx_db::db_enabled = false;
+	ptx_db::db_file = false;
+	llvm_prewarm::enabled = false;
+      }
+    }
+
+    if (llvm_prewarm::enabled) {
+      if (JitCompilePool::Instance().getThreads() == 0)
+	JitCompilePool::Instance().setThreads( std::max( 1u , std::thread::hardware_concurrency() ) );
+      QDPIO::cout << "Opening pre-warm manifest " << llvm_prewarm::fname << "\n";
+      llvm_prewarm::manifest.open( llvm_prewarm::fname );
+    }
+
+    QDPIO::cout << "JIT compile threads     : " << JitCompilePool::Instance().getThreads() << "\n";
+
+    if (ptx_db::db_file) {
+      // Index DB, the PTX is read on demand
+      QDPIO::cout << "Opening PTX DB " << ptx_db::dbname << "\n";
+      ptx_db::db.open( ptx_db::dbname );
 
     } // ptx db
 
@@ -520,6 +714,8 @@ namespace QDP {
     vecParamType.clear();
     vecArgument.clear();
     function_created = false;
+    function_uses_block = false;
+    function_block_reduce = false;
 
     llvm_setup_math_functions();
 
@@ -533,11 +729,22 @@ namespace QDP {
     assert( !function_created );
     assert( vecParamType.size() > 0 );
 
+    // The kernel takes the site index as an additional last argument.
+    // It gets called from the driver 'main' (see llvm_build_driver and
+    // llvm_host_build_driver) which is the entry point.
+    std::vector< llvm::Type* > types( vecParamType );
+    types.push_back( llvm::Type::getInt32Ty(TheContext) );
+
+    // On the host target the block geometry follows (jit_host_block_t*)
+    bool host = DeviceParams::Instance().getHostTarget();
+    if (host)
+      types.push_back( llvm::Type::getInt8PtrTy(TheContext) );
+
     llvm::FunctionType *funcType = 
       llvm::FunctionType::get( builder->getVoidTy() , 
-			       llvm::ArrayRef<llvm::Type*>( vecParamType.data() , vecParamType.size() ) , 
+			       llvm::ArrayRef<llvm::Type*>( types.data() , types.size() ) , 
 			       false); // no vararg
-    mainFunc = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, "main", Mod.get());
+    mainFunc = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, "kernel", Mod.get());
 
     unsigned Idx = 0;
     for (llvm::Function::arg_iterator AI = mainFunc->arg_begin(), AE = mainFunc->arg_end() ; AI != AE ; ++AI, ++Idx) {
@@ -545,6 +752,9 @@ namespace QDP {
       vecArgument.push_back( &*AI );
     }
 
+    r_arg_idx   = host ? vecArgument.end()[-2] : vecArgument.back();
+    r_arg_block = host ? vecArgument.back() : NULL;
+
     llvm::BasicBlock* entry = llvm::BasicBlock::Create(TheContext, "entrypoint", mainFunc);
     builder->SetInsertPoint(entry);
 
@@ -854,9 +1064,29 @@ namespace QDP {
   // }
 
 
+  // Host target: loads a field of the jit_host_block_t argument
+  llvm::Value* llvm_host_block_field( size_t offset , llvm::Type* ty )
+  {
+    if (!function_created)
+      llvm_create_function();
+    llvm::Value* ptr = builder->CreateGEP( r_arg_block , llvm_create_value( (int)offset ) );
+    return builder->CreateLoad( builder->CreateBitCast( ptr , llvm::PointerType::get( ty , 0 ) ) );
+  }
+
+
   llvm::Value* llvm_get_shared_ptr( llvm::Type *ty ) {
 
-    //
+    function_uses_block = true;
+
+    // Host target: The threads of a block run one after the other, so
+    // shared memory works for the per-thread slots of jit_block_reduce
+    // only.
+    if (DeviceParams::Instance().getHostTarget()) {
+      if (!function_block_reduce)
+	QDP_error_exit("Shared memory is only available to block reductions on the host target");
+      return builder->CreateBitCast( llvm_host_block_field( offsetof( jit_host_block_t , shared ) , llvm::Type::getInt8PtrTy(TheContext) ) ,
+				     llvm::PointerType::get( ty , 0 ) );
+    }
 
     llvm::GlobalVariable *gv = new llvm::GlobalVariable ( *Mod , 
 							  llvm::ArrayType::get(ty,0) ,
@@ -1046,6 +1276,13 @@ namespace QDP {
 
   void llvm_bar_sync()
   {
+    function_uses_block = true;
+
+    // Host target: The threads of a block run one after the other, a
+    // barrier can't be honored. jit_block_reduce doesn't use them there.
+    if (DeviceParams::Instance().getHostTarget())
+      QDP_error_exit("Barriers are not available on the host target");
+
     llvm::FunctionType *IntrinFnTy = llvm::FunctionType::get(llvm::Type::getVoidTy(TheContext), false);
 
     llvm::AttrBuilder ABuilder;
@@ -1065,8 +1302,40 @@ namespace QDP {
   
 
 
+  // Host target: The special registers follow from the site index and
+  // the block geometry, idx = ctaid.x * ntid.x + tid.x (1-dim. grid).
+  llvm::Value * llvm_host_special( const std::string& name )
+  {
+    llvm::Type* i32 = llvm::Type::getInt32Ty(TheContext);
+
+    llvm::Value* r_ntid = llvm_host_block_field( offsetof( jit_host_block_t , ntid ) , i32 );
+
+    if (name == "llvm.nvvm.read.ptx.sreg.tid.x")
+      return builder->CreateURem( r_arg_idx , r_ntid );
+    if (name == "llvm.nvvm.read.ptx.sreg.ntid.x")
+      return r_ntid;
+    if (name == "llvm.nvvm.read.ptx.sreg.ctaid.x")
+      return builder->CreateUDiv( r_arg_idx , r_ntid );
+    if (name == "llvm.nvvm.read.ptx.sreg.nctaid.x")
+      return llvm_host_block_field( offsetof( jit_host_block_t , nctaid ) , i32 );
+    if (name == "llvm.nvvm.read.ptx.sreg.ctaid.y")
+      return llvm_create_value(0);
+    if (name == "llvm.nvvm.read.ptx.sreg.nctaid.y")
+      return llvm_create_value(1);
+
+    QDP_error_exit("Special register %s is not available on the host target",name.c_str());
+    return NULL;
+  }
+
+
+  // Reads a PTX special register. The kernel is not marked as using
+  // thread block features, llvm_build_driver reads the registers
+  // through this too.
   llvm::Value * llvm_special( const char * name )
   {
+    if (DeviceParams::Instance().getHostTarget())
+      return llvm_host_special( name );
+
     llvm::FunctionType *IntrinFnTy = llvm::FunctionType::get(llvm::Type::getInt32Ty(TheContext), false);
 
     llvm::AttrBuilder ABuilder;
@@ -1084,20 +1353,25 @@ namespace QDP {
 
 
 
-  llvm::Value * llvm_call_special_tidx() { return llvm_special("llvm.nvvm.read.ptx.sreg.tid.x"); }
-  llvm::Value * llvm_call_special_ntidx() { return llvm_special("llvm.nvvm.read.ptx.sreg.ntid.x"); }
-  llvm::Value * llvm_call_special_ctaidx() { return llvm_special("llvm.nvvm.read.ptx.sreg.ctaid.x"); }
-  llvm::Value * llvm_call_special_nctaidx() { return llvm_special("llvm.nvvm.read.ptx.sreg.nctaid.x"); }
-  llvm::Value * llvm_call_special_ctaidy() { return llvm_special("llvm.nvvm.read.ptx.sreg.ctaid.y"); }
+  void llvm_set_block_reduce() { function_block_reduce = true; }
+
+
+  // A kernel reading the launch geometry relies on one site per thread,
+  // it gets no strided loop in the driver (see llvm_build_driver)
+  llvm::Value * llvm_call_special_tidx()    { function_uses_block = true; return llvm_special("llvm.nvvm.read.ptx.sreg.tid.x"); }
+  llvm::Value * llvm_call_special_ntidx()   { function_uses_block = true; return llvm_special("llvm.nvvm.read.ptx.sreg.ntid.x"); }
+  llvm::Value * llvm_call_special_ctaidx()  { function_uses_block = true; return llvm_special("llvm.nvvm.read.ptx.sreg.ctaid.x"); }
+  llvm::Value * llvm_call_special_nctaidx() { function_uses_block = true; return llvm_special("llvm.nvvm.read.ptx.sreg.nctaid.x"); }
+  llvm::Value * llvm_call_special_ctaidy()  { function_uses_block = true; return llvm_special("llvm.nvvm.read.ptx.sreg.ctaid.y"); }
+  llvm::Value * llvm_call_special_nctaidy() { function_uses_block = true; return llvm_special("llvm.nvvm.read.ptx.sreg.nctaid.y"); }
 
 
+  // The site index is an argument of the kernel. It's computed in
+  // the driver from the launch geometry.
   llvm::Value * llvm_thread_idx() { 
-    llvm::Value * tidx = llvm_call_special_tidx();
-    llvm::Value * ntidx = llvm_call_special_ntidx();
-    llvm::Value * ctaidx = llvm_call_special_ctaidx();
-    llvm::Value * ctaidy = llvm_call_special_ctaidy();
-    llvm::Value * nctaidx = llvm_call_special_nctaidx();
-    return llvm_add( llvm_mul( llvm_add( llvm_mul( ctaidy , nctaidx ) , ctaidx ) , ntidx ) , tidx );
+    if (!function_created)
+      llvm_create_function();
+    return r_arg_idx;
   }
   
 
@@ -1217,13 +1491,13 @@ namespace QDP {
 
     //  } // ann. namespace
 
-  void optimize_module( std::unique_ptr< llvm::TargetMachine >& TM )
+  void optimize_module( std::unique_ptr< llvm::TargetMachine >& TM , llvm::Module& M )
   {
     //QDPIO::cout << "optimize module...\n";
     
     llvm::legacy::PassManager Passes;
 
-    llvm::Triple ModuleTriple(Mod->getTargetTriple());
+    llvm::Triple ModuleTriple(M.getTargetTriple());
 
     llvm::TargetLibraryInfoImpl TLII(ModuleTriple);
 
@@ -1233,7 +1507,7 @@ namespace QDP {
 
     std::unique_ptr<llvm::legacy::FunctionPassManager> FPasses;
 
-    FPasses.reset(new llvm::legacy::FunctionPassManager(Mod.get()));
+    FPasses.reset(new llvm::legacy::FunctionPassManager(&M));
     FPasses->add(createTargetTransformInfoWrapperPass( TM->getTargetIRAnalysis() ) );
 
     //QDPIO::cout << "no optimization passes!!\n";
@@ -1241,18 +1515,20 @@ namespace QDP {
 
     if (FPasses) {
       FPasses->doInitialization();
-      for (llvm::Function &F : *Mod)
+      for (llvm::Function &F : M)
 	FPasses->run(F);
       FPasses->doFinalization();
     }
 
     Passes.add(llvm::createVerifierPass());
 
-    Passes.run(*Mod);
+    Passes.run(M);
   }
   
 
-  std::string get_PTX_from_Module_using_llvm()
+  // Runs on the worker threads of the JIT compile pool too. Must
+  // only touch M and its context.
+  std::string get_PTX_from_Module_using_llvm( llvm::Module& M )
   {
     //QDPIO::cout << "get PTX using NVPTC..\n";
 
@@ -1337,13 +1613,13 @@ namespace QDP {
 
     llvm::legacy::PassManager PM;
     //FOS <<  "target datalayout = \"e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v16:16:16-v32:32:32-v64:64:64-v128:128:128-n16:32:64\";\n";
-    Mod->setTargetTriple( "nvptx64-nvidia-cuda" );
+    M.setTargetTriple( "nvptx64-nvidia-cuda" );
 
-    llvm::TargetLibraryInfoImpl TLII(Triple(Mod->getTargetTriple()));
+    llvm::TargetLibraryInfoImpl TLII(Triple(M.getTargetTriple()));
     PM.add(new TargetLibraryInfoWrapperPass(TLII));
     //PM.add(new llvm::TargetLibraryInfoWrapperPass(llvm::Triple(Mod->getTargetTriple())));
 
-    Mod->setDataLayout(target_machine->createDataLayout());
+    M.setDataLayout(target_machine->createDataLayout());
     //Mod->setDataLayout("e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v16:16:16-v32:32:32-v64:64:64-v128:128:128-n16:32:64");
 
     //setFunctionAttributes("sm_30", "", *Mod);  // !!!!!
@@ -1351,7 +1627,7 @@ namespace QDP {
     //QDPIO::cout << "BEFORE OPT ---------------\n";
     //Mod->dump();
     
-    optimize_module( target_machine );
+    optimize_module( target_machine , M );
 
     //QDPIO::cout << "AFTER OPT ---------------\n";
     //Mod->dump();
@@ -1391,7 +1667,7 @@ namespace QDP {
     //QDPIO::cout << "(module right before PTX codegen)------\n";
 	
     //QDPIO::cout << "PTX code generation\n";
-    PM.run(*Mod);
+    PM.run(M);
     //bos.flush();
 
     //QDPIO::cout << "PTX generated2: " << bos.str().str() << " (end)\n";
@@ -1441,7 +1717,7 @@ namespace QDP {
   // LLVM 4.0
   bool all_but_main(const llvm::GlobalValue & gv)
   {
-    return gv.getName().str() == "main";
+    return gv.getName().str() == "main" || gv.getName().str() == "qdp_jit_spt";
   }
 
 
@@ -1451,7 +1727,9 @@ namespace QDP {
     Mod->dump();
   }
 
-  std::string llvm_get_ptx_kernel(const char* fname)
+  // Internalize, resolve __nvvm_reflect and strip the unused parts
+  // of libdevice. Cheap, done on the calling thread.
+  void llvm_prepare_module( llvm::Module& M )
   {
     //QDPIO::cout << "get PTX..\n";
     //QDPIO::cout << "enter get_ptx_kernel------\n";
@@ -1466,14 +1744,20 @@ namespace QDP {
     llvm::legacy::PassManager OurPM;
     OurPM.add( llvm::createInternalizePass( all_but_main ) );
     OurPM.add( llvm::createNVVMReflectPass());
-    OurPM.run( *Mod );
+    OurPM.run( M );
 
 
     //QDP_info_primary("Running optimization passes on module");
 
     llvm::legacy::PassManager PM;
     PM.add( llvm::createGlobalDCEPass() );
-    PM.run( *Mod );
+    PM.run( M );
+  }
+
+
+  std::string llvm_get_ptx_kernel( llvm::Module& M )
+  {
+    llvm_prepare_module( M );
 
 
     //QDPIO::cout << "------------------------------------------------ new module\n";
@@ -1486,7 +1770,7 @@ namespace QDP {
     //llvm_print_module(Mod,"ir_internalized_reflected_globalDCE.ll");
 
     //std::string str = get_PTX_from_Module_using_nvvm( Mod );
-    std::string str = get_PTX_from_Module_using_llvm();
+    std::string str = get_PTX_from_Module_using_llvm( M );
 
 #if 0
     // Write PTX string to file
@@ -1515,49 +1799,327 @@ namespace QDP {
 
 
 
+  //
+  // GPU target: Builds the entry point 'main' which takes the kernel
+  // arguments. The global thread index is computed from the launch
+  // geometry.
+  //
+  // Kernels that use thread block features (shared memory, barriers,
+  // special registers) are called once with the site index equal to
+  // the global thread index. Such kernels are launched with an explicit
+  // geometry (CudaLaunchKernel).
+  //
+  // All other kernels get an additional last argument 'sites per
+  // thread' and are called for the sites
+  //
+  //   idx = thread_idx + k * number_of_threads ,  k = 0 .. spt-1
+  //
+  // They are launched by jit_launch which picks spt. Accesses
+  // stay coalesced across the threads of a warp for each k. An early
+  // return in the kernel acts as 'continue'. The module of such a
+  // kernel defines the global 'qdp_jit_spt', this is how the launcher
+  // tells them apart also for kernels from the PTX DB.
+  //
+  llvm::Function* llvm_build_driver()
+  {
+    llvm::Function* kernel = mainFunc;
+    kernel->addFnAttr( llvm::Attribute::AlwaysInline );
+
+    bool strided = !function_uses_block;
+
+    llvm::Type* i32 = llvm::Type::getInt32Ty(TheContext);
+
+    std::vector< llvm::Type* > types( vecParamType );
+    if (strided) {
+      types.push_back( i32 );
+      new llvm::GlobalVariable( *Mod , i32 , false , llvm::GlobalValue::ExternalLinkage , llvm::ConstantInt::get( i32 , 1 ) ,
+				"qdp_jit_spt" , nullptr , llvm::GlobalValue::NotThreadLocal , 1 );
+    }
+
+    llvm::FunctionType *funcType = llvm::FunctionType::get( builder->getVoidTy() , 
+							    llvm::ArrayRef<llvm::Type*>( types.data() , types.size() ) , 
+							    false );
+    llvm::Function* driver = llvm::Function::Create( funcType , llvm::Function::ExternalLinkage, "main", Mod.get() );
+
+    std::vector< llvm::Value* > params;
+    for (llvm::Function::arg_iterator AI = driver->arg_begin(), AE = driver->arg_end() ; AI != AE ; ++AI)
+      params.push_back( &*AI );
+
+    llvm::BasicBlock* bb_entry = llvm::BasicBlock::Create(TheContext, "entrypoint", driver);
+    builder->SetInsertPoint( bb_entry );
+
+    llvm::Value * tidx = llvm_special("llvm.nvvm.read.ptx.sreg.tid.x");
+    llvm::Value * ntidx = llvm_special("llvm.nvvm.read.ptx.sreg.ntid.x");
+    llvm::Value * ctaidx = llvm_special("llvm.nvvm.read.ptx.sreg.ctaid.x");
+    llvm::Value * ctaidy = llvm_special("llvm.nvvm.read.ptx.sreg.ctaid.y");
+    llvm::Value * nctaidx = llvm_special("llvm.nvvm.read.ptx.sreg.nctaid.x");
+    llvm::Value * r_idx_thread = llvm_add( llvm_mul( llvm_add( llvm_mul( ctaidy , nctaidx ) , ctaidx ) , ntidx ) , tidx );
+
+    if (!strided) {
+      params.push_back( r_idx_thread );
+      builder->CreateCall( kernel , params );
+      builder->CreateRetVoid();
+      return driver;
+    }
+
+    llvm::Value* r_spt = params.back();
+    params.pop_back();
+
+    llvm::Value * nctaidy = llvm_special("llvm.nvvm.read.ptx.sreg.nctaid.y");
+    llvm::Value * r_nthreads = llvm_mul( llvm_mul( nctaidx , nctaidy ) , ntidx );
+
+    llvm::BasicBlock* bb_cond  = llvm::BasicBlock::Create(TheContext, "cond", driver);
+    llvm::BasicBlock* bb_body  = llvm::BasicBlock::Create(TheContext, "body", driver);
+    llvm::BasicBlock* bb_exit  = llvm::BasicBlock::Create(TheContext, "exit", driver);
+
+    builder->CreateBr( bb_cond );
+
+    builder->SetInsertPoint( bb_cond );
+    llvm::PHINode* r_k = builder->CreatePHI( i32 , 2 );
+    r_k->addIncoming( llvm_create_value(0) , bb_entry );
+    builder->CreateCondBr( builder->CreateICmpSLT( r_k , r_spt ) , bb_body , bb_exit );
+
+    builder->SetInsertPoint( bb_body );
+    params.push_back( llvm_add( r_idx_thread , llvm_mul( r_k , r_nthreads ) ) );
+    builder->CreateCall( kernel , params );
+    r_k->addIncoming( builder->CreateNSWAdd( r_k , llvm_create_value(1) ) , bb_body );
+    builder->CreateBr( bb_cond );
+
+    builder->SetInsertPoint( bb_exit );
+    builder->CreateRetVoid();
+
+    return driver;
+  }
+
+
+  //
+  // Host target: Builds the driver
+  //
+  //   void main( void** args , int lo , int hi , jit_host_block_t* block )
+  //
+  // which unpacks the kernel arguments (same layout as for cuLaunchKernel)
+  // and calls the kernel for each site in [lo,hi) in increasing order. An
+  // early return in the kernel acts as 'continue'. 'block' is only used
+  // by kernels with thread block features (jit_launch_host_block).
+  //
+  void llvm_host_build_driver()
+  {
+    llvm::Function* kernel = mainFunc;
+    kernel->addFnAttr( llvm::Attribute::AlwaysInline );
+
+    llvm::Type* i32 = llvm::Type::getInt32Ty(TheContext);
+    llvm::Type* args_type = llvm::PointerType::get( llvm::Type::getInt8PtrTy(TheContext) , 0 );
+
+    llvm::FunctionType *funcType = llvm::FunctionType::get( builder->getVoidTy() , { args_type , i32 , i32 , llvm::Type::getInt8PtrTy(TheContext) } , false );
+    llvm::Function* driver = llvm::Function::Create( funcType , llvm::Function::ExternalLinkage, "main", Mod.get() );
+
+    llvm::Function::arg_iterator AI = driver->arg_begin();
+    llvm::Value* r_args  = &*AI++;
+    llvm::Value* r_lo    = &*AI++;
+    llvm::Value* r_hi    = &*AI++;
+    llvm::Value* r_block = &*AI;
+
+    llvm::BasicBlock* bb_entry = llvm::BasicBlock::Create(TheContext, "entrypoint", driver);
+    llvm::BasicBlock* bb_cond  = llvm::BasicBlock::Create(TheContext, "cond", driver);
+    llvm::BasicBlock* bb_body  = llvm::BasicBlock::Create(TheContext, "body", driver);
+    llvm::BasicBlock* bb_exit  = llvm::BasicBlock::Create(TheContext, "exit", driver);
+
+    builder->SetInsertPoint( bb_entry );
+
+    std::vector< llvm::Value* > params;
+    for ( unsigned i = 0 ; i < vecParamType.size() ; ++i ) {
+      llvm::Type* type = vecParamType[i];
+      // bool arguments are passed as one byte
+      llvm::Type* type_mem = type->isIntegerTy(1) ? builder->getInt8Ty() : type;
+      llvm::Value* slot = builder->CreateLoad( builder->CreateGEP( r_args , llvm_create_value( (int)i ) ) );
+      llvm::Value* val = builder->CreateLoad( builder->CreateBitCast( slot , llvm::PointerType::get( type_mem , 0 ) ) );
+      if (type != type_mem)
+	val = builder->CreateTrunc( val , type );
+      params.push_back( val );
+    }
+    builder->CreateBr( bb_cond );
+
+    builder->SetInsertPoint( bb_cond );
+    llvm::PHINode* r_idx = builder->CreatePHI( i32 , 2 );
+    r_idx->addIncoming( r_lo , bb_entry );
+    builder->CreateCondBr( builder->CreateICmpSLT( r_idx , r_hi ) , bb_body , bb_exit );
+
+    builder->SetInsertPoint( bb_body );
+    params.push_back( r_idx );
+    params.push_back( r_block );
+    builder->CreateCall( kernel , params );
+    r_idx->addIncoming( builder->CreateNSWAdd( r_idx , llvm_create_value(1) ) , bb_body );
+    builder->CreateBr( bb_cond );
+
+    builder->SetInsertPoint( bb_exit );
+    builder->CreateRetVoid();
+  }
+
+
+  CUfunction llvm_get_host_function()
+  {
+    llvm_host_build_driver();
+
+    llvm::legacy::PassManager OurPM;
+    OurPM.add( llvm::createInternalizePass( all_but_main ) );
+    OurPM.add( llvm::createGlobalDCEPass() );
+    OurPM.run( *Mod );
+
+    std::string triple = llvm::sys::getProcessTriple();
+
+    std::string Error;
+    const llvm::Target *TheTarget = llvm::TargetRegistry::lookupTarget( triple , Error );
+    if (!TheTarget)
+      QDP_error_exit("Error looking up host target %s: %s",triple.c_str(),Error.c_str());
+
+    llvm::SubtargetFeatures Features;
+    llvm::StringMap<bool> HostFeatures;
+    if (llvm::sys::getHostCPUFeatures(HostFeatures))
+      for (auto &F : HostFeatures)
+	Features.AddFeature( F.first() , F.second );
+
+    std::unique_ptr<llvm::TargetMachine> target_machine(TheTarget->createTargetMachine(
+										       triple,
+										       llvm::sys::getHostCPUName(),
+										       Features.getString(),
+										       llvm::TargetOptions(),
+										       getRelocModel(),
+										       None,
+										       llvm::CodeGenOpt::Aggressive, true ));
+    assert(target_machine.get() && "Could not allocate target machine!");
+
+    Mod->setTargetTriple( triple );
+    Mod->setDataLayout( target_machine->createDataLayout() );
+
+    optimize_module( target_machine , *Mod );
+
+    std::string ErrStr;
+    llvm::ExecutionEngine* engine = llvm::EngineBuilder( std::move( Mod ) )
+      .setErrorStr( &ErrStr )
+      .setEngineKind( llvm::EngineKind::JIT )
+      .setMCJITMemoryManager( llvm::make_unique<llvm::SectionMemoryManager>() )
+      .create( target_machine.release() );
+
+    if (!engine)
+      QDP_error_exit("Could not create execution engine: %s",ErrStr.c_str());
+
+    engine->finalizeObject();
+
+    uint64_t addr = engine->getFunctionAddress("main");
+    if (!addr)
+      QDP_error_exit("Could not find the driver function in the generated host code");
+
+    llvm_host::engines.emplace_back( engine );
+
+    // The handle is the entry point itself
+    return reinterpret_cast<CUfunction>( addr );
+  }
+
+
+  std::string llvm_module_bitcode( llvm::Module& M )
+  {
+    std::string str;
+    llvm::raw_string_ostream rss(str);
+    llvm::WriteBitcodeToFile( &M , rss );
+    rss.flush();
+    return str;
+  }
+
+
+  // Called on the worker threads of the JIT compile pool
+  std::string llvm_compile_bitcode( llvm::LLVMContext& context , const std::string& bitcode )
+  {
+    std::unique_ptr<llvm::MemoryBuffer> buf = llvm::MemoryBuffer::getMemBuffer( bitcode , "kernel" , false );
+
+    llvm::Expected<std::unique_ptr<llvm::Module> > ModuleOrErr = llvm::parseBitcodeFile( buf->getMemBufferRef() , context );
+    if (llvm::Error Err = ModuleOrErr.takeError())
+      QDP_error_exit("Reading kernel bitcode failed: %s",llvm::toString(std::move(Err)).c_str());
+
+    return get_PTX_from_Module_using_llvm( *ModuleOrErr.get() );
+  }
+
+
+  // Submits the kernels of the pre-warm manifest recorded for the
+  // current local volume. Called once the layout is known.
+  void llvm_prewarm_start()
+  {
+    if (!llvm_prewarm::enabled)
+      return;
+
+    std::string prefix = get_kernel_id("");
+
+    int count = 0;
+    std::vector< std::string > keys = llvm_prewarm::manifest.keys();
+    for ( const std::string& key : keys ) {
+      if ( key.compare( 0 , prefix.size() , prefix ) != 0 )
+	continue;
+      if ( llvm_prewarm::pending.count( key ) )
+	continue;
+
+      std::string pretty = key.substr( prefix.size() );
+      if ( pretty.compare( 0 , 3 , "hs_" ) == 0 )
+	pretty = pretty.substr( 3 );
+
+      // Recorded with the other -halo-single setting
+      if ( get_kernel_id( pretty ) != key )
+	continue;
+
+      std::string bitcode;
+      if ( !llvm_prewarm::manifest.find( key , bitcode ) )
+	continue;
+
+      // With a shared DB only the rank holding the lease compiles the
+      // kernel, the others pick it up from the DB when needed
+      std::string ptx_db_id = get_ptx_db_id( pretty );
+      if ( ptx_db::db_file && !ptx_db::db.lease( ptx_db_id ) )
+	continue;
+
+      llvm_prewarm::pending[ key ] = JitCompilePool::Instance().submit( bitcode , ptx_db::db_file ? ptx_db_id : "" );
+      ++count;
+    }
+    QDPIO::cout << "Pre-warming " << count << " kernels\n";
+  }
+
+
   CUfunction llvm_get_cufunction(const char* fname, const char* pretty_cstr)
   {
-    addKernelMetadata( mainFunc );
+    if (DeviceParams::Instance().getHostTarget())
+      return llvm_get_host_function();
+
+    addKernelMetadata( llvm_build_driver() );
 
     std::string pretty( pretty_cstr );
 
     // llvm::FunctionType *funcType = mainFunc->getFunctionType();
     // funcType->dump();
 
-    std::string ptx_kernel = llvm_get_ptx_kernel(fname);
-
-    CUfunction func = get_fptr_from_ptx( fname , ptx_kernel );
-
-    if ( ptx_db::db_enabled ) {
+    std::string id = get_ptx_db_id( pretty );
 
-      std::string id = get_ptx_db_id( pretty );
+    if ( JitCompilePool::Instance().getThreads() > 0 || llvm_prewarm::enabled ) {
 
-      // Add kernel
-      //QDPIO::cout << "add kernel for id = " << id << "\n";
+      llvm_prepare_module( *Mod );
+      std::string bitcode = llvm_module_bitcode( *Mod );
 
-      if ( ptx_db::db.find( id ) != ptx_db::db.end() ) {
-	QDPIO::cout << "internal error: key already exists in DB but wasn't found before\n" << id << "\n";
-	QDP_abort(1);
+      if ( llvm_prewarm::enabled ) {
+	std::string kernel_id = get_kernel_id( pretty );
+	if ( !llvm_prewarm::manifest.contains( kernel_id ) )
+	  llvm_prewarm::manifest.append( kernel_id , bitcode );
       }
 
-      ptx_db::db[ id ] = ptx_kernel;
+      // Optimization and code generation in the background. The
+      // kernel gets loaded when first launched.
+      CUfunction func = jit_pending_function( JitCompilePool::Instance().submit( bitcode , ptx_db::db_file ? id : "" ) , fname );
+      mapCUFuncId[ func ] = id;
+      return func;
+    }
 
-      // Store DB
-      //QDPIO::cout << "storing PTX DB " << ptx_db::dbname << "\n";
-      BinaryFileWriter db( ptx_db::dbname );
-      for ( ptx_db::DBType::iterator it = ptx_db::db.begin() ; it != ptx_db::db.end() ; ++it ) 
-	{
-	  int size1 = it->first.size();
-	  db.write(size1);
-	  db.writeArrayPrimaryNode( it->first.c_str() , 1 , size1 );
+    std::string ptx_kernel = llvm_get_ptx_kernel( *Mod );
 
-	  int size2 = it->second.size();
-	  db.write(size2);
-	  db.writeArrayPrimaryNode( it->second.c_str() , 1 , size2 );
-	}
-      db.close();
+    CUfunction func = get_fptr_from_ptx( fname , ptx_kernel );
+    mapCUFuncId[ func ] = id;
 
-    } // ptx db
+    if ( ptx_db::db_file )
+      llvm_ptx_db_store( id , ptx_kernel );
 
     return func;
   }
@@ -1565,6 +2127,7 @@ namespace QDP {
 
 
 
+
   llvm::Value* llvm_call_f32( llvm::Function* func , llvm::Value* lhs )
   {
     llvm::Value* lhs_f32 = llvm_cast( llvm_type<float>::value , lhs );
@@ -39,6 +39,8 @@ struct NearestNeighborMapFunc : public ArrayMapFunc
 
   virtual int numArray() const {return Nd;}
 
+  virtual bool isShift() const {return true;}
+
 private:
   int sgnum(int x) const {return (x > 0) ? 1 : -1;}
 }; 
@@ -70,6 +72,13 @@ struct PackageArrayMapFunc : public MapFunc
       return pmap(coord, isign, dir);
     }
 
+  virtual bool isShift(int& d, int& sign) const
+    {
+      d = dir;
+      sign = 1;
+      return pmap.isShift();
+    }
+
 private:
   const ArrayMapFunc& pmap;
   const int dir;
@@ -110,6 +119,14 @@ struct PackageBiDirectionalMapFunc : public MapFunc
       return pmap(coord, mult*isign);
     }
 
+  virtual bool isShift(int& d, int& sign) const
+    {
+      if (!pmap.isShift(d, sign))
+	return false;
+      sign *= mult;
+      return true;
+    }
+
 private:
   const MapFunc& pmap;
   const int mult;
@@ -148,6 +165,13 @@ struct PackageArrayBiDirectionalMapFunc : public MapFunc
       return pmap(coord, mult*isign, dir);
     }
 
+  virtual bool isShift(int& d, int& sign) const
+    {
+      d = dir;
+      sign = mult;
+      return pmap.isShift();
+    }
+
 private:
   const ArrayMapFunc& pmap;
   const int mult;
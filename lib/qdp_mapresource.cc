@@ -2,6 +2,169 @@
 
 namespace QDP {
 
+  // One message to (or from) a neighbor node carrying the halos of
+  // several shifts back to back. Keyed by the node and the resources
+  // of the parts, two groups in flight never share a buffer. The least
+  // recently used messages are freed beyond max_halo_messages.
+  struct HaloMessage
+  {
+    void *          buf;
+    int             size;
+    QMP_msgmem_t    mem;
+    QMP_msghandle_t mh;
+    bool            busy;    // started and not yet waited for
+    int             users;   // resources assigned, qmp_wait not yet called
+    unsigned long   stamp;   // last use
+  };
+
+
+  namespace {
+    std::vector<const FnMapRsrc*> vecStaged;   // send_receive called, QMP_start not yet
+
+    typedef std::map< std::pair< int , std::vector<const FnMapRsrc*> > , HaloMessage* > MapHaloMessage;
+    MapHaloMessage mapSendMsg;
+    MapHaloMessage mapRecvMsg;
+    unsigned long halo_stamp = 0;
+
+    // Per direction
+    enum { max_halo_messages = 64 };
+
+    // Aggregated messages are kept apart from the single-shift ones
+    // (tag 0), the parts of a group could otherwise match a plain
+    // message to the same node
+    enum { halo_aggregate_tag = 1 };
+
+    bool async_copies() {
+      return !DeviceParams::Instance().getGPUDirect() && DeviceParams::Instance().getAsyncTransfers();
+    }
+
+
+    void free_message(HaloMessage* msg)
+    {
+      QMP_free_msghandle( msg->mh );
+      QMP_free_msgmem( msg->mem );
+      CudaHostFree( msg->buf );
+      delete msg;
+    }
+
+
+    // Messages in flight or assigned to a staged resource stay. Called
+    // from start_pending after the transfer stream is synced, no copy
+    // from a receive buffer is pending.
+    void evict_messages(MapHaloMessage& m)
+    {
+      while ( m.size() >= max_halo_messages ) {
+	auto lru = m.end();
+	for ( auto i = m.begin() ; i != m.end() ; ++i )
+	  if ( !i->second->busy && i->second->users == 0 &&
+	       ( lru == m.end() || i->second->stamp < lru->second->stamp ) )
+	    lru = i;
+	if ( lru == m.end() )
+	  return;
+	free_message( lru->second );
+	m.erase( lru );
+      }
+    }
+
+
+    HaloMessage* get_message(MapHaloMessage& m, bool send, int node, const std::vector<const FnMapRsrc*>& parts)
+    {
+      auto key = std::make_pair( node , parts );
+      auto i = m.find( key );
+      if (i != m.end()) {
+	i->second->stamp = ++halo_stamp;
+	return i->second;
+      }
+
+      evict_messages( m );
+
+      HaloMessage* msg = new HaloMessage;
+      msg->size = 0;
+      for ( auto r : parts )
+	msg->size += send ? r->dstnum : r->srcnum;
+      msg->busy = false;
+      msg->users = 0;
+      msg->stamp = ++halo_stamp;
+
+      CudaHostAlloc( &msg->buf , msg->size , 0 );
+
+      msg->mem = QMP_declare_msgmem( msg->buf , msg->size );
+      if( msg->mem == (QMP_msgmem_t)NULL )
+	QDP_error_exit("QMP_declare_msgmem for aggregated halo failed\n");
+
+      msg->mh = send ?
+	QMP_declare_send_to( msg->mem , node , halo_aggregate_tag ) :
+	QMP_declare_receive_from( msg->mem , node , halo_aggregate_tag );
+      if( msg->mh == (QMP_msghandle_t)NULL )
+	QDP_error_exit("QMP_declare for aggregated halo failed\n");
+
+      m[ key ] = msg;
+      return msg;
+    }
+
+
+    void wait_message(HaloMessage* msg)
+    {
+      if (!msg->busy)
+	return;
+      QMP_status_t err;
+      if ((err = QMP_wait(msg->mh)) != QMP_SUCCESS)
+	QDP_error_exit(QMP_error_string(err));
+      msg->busy = false;
+    }
+
+
+    // Assign the staged resources to aggregated messages. Only shifts
+    // are considered: their neighbors are the same on every node, so
+    // the receiving node builds the matching message from its own
+    // staged list. A resource is aggregated when its destination and
+    // its source node are both used by more than one resource.
+    void aggregate_staged()
+    {
+      if (DeviceParams::Instance().getGPUDirect() || vecStaged.size() < 2)
+	return;
+
+      std::map<int,int> sends, recvs;
+      for ( auto r : vecStaged ) {
+	if (!r->shift)
+	  return;
+	sends[ r->destnode ]++;
+	recvs[ r->srcnode ]++;
+      }
+
+      std::map< int , std::vector<const FnMapRsrc*> > groupSend, groupRecv;
+      for ( auto r : vecStaged ) {
+	if ( sends[ r->destnode ] > 1 && recvs[ r->srcnode ] > 1 ) {
+	  groupSend[ r->destnode ].push_back( r );
+	  groupRecv[ r->srcnode ].push_back( r );
+	}
+      }
+
+      for ( auto& g : groupSend ) {
+	HaloMessage* msg = get_message( mapSendMsg , true , g.first , g.second );
+	int offset = 0;
+	for ( auto r : g.second ) {
+	  msg->users++;
+	  r->aggSend = msg;
+	  r->aggSendOffset = offset;
+	  memcpy( (char*)msg->buf + offset , r->send_buf , r->dstnum );
+	  offset += r->dstnum;
+	}
+      }
+
+      for ( auto& g : groupRecv ) {
+	HaloMessage* msg = get_message( mapRecvMsg , false , g.first , g.second );
+	int offset = 0;
+	for ( auto r : g.second ) {
+	  msg->users++;
+	  r->aggRecv = msg;
+	  r->aggRecvOffset = offset;
+	  offset += r->srcnum;
+	}
+      }
+    }
+  }
+
 
   void FnMapRsrc::setup(int _destNode,int _srcNode,int _sendMsgSize,int _rcvMsgSize) {
 
@@ -10,6 +173,9 @@ namespace QDP {
     srcnum=_rcvMsgSize;
     dstnum=_sendMsgSize;
 
+    destnode = _destNode;
+    srcnode = _srcNode;
+
     int srcnode = _srcNode;
     int dstnode = _destNode;
 
@@ -82,12 +248,28 @@ namespace QDP {
 
 
   void FnMapRsrc::qmp_wait() const {
-    QMP_status_t err;
-    if ((err = QMP_wait(mh)) != QMP_SUCCESS)
-      QDP_error_exit(QMP_error_string(err));
+    if (staged)
+      start_pending();
+
+    const void * recv = recv_buf;
+
+    if (aggRecv) {
+      wait_message( aggRecv );
+      wait_message( aggSend );
+      recv = (const char*)aggRecv->buf + aggRecvOffset;
+      aggRecv->users--;
+      aggSend->users--;
+      aggRecv = aggSend = nullptr;
+    } else {
+      QMP_status_t err;
+      if ((err = QMP_wait(mh)) != QMP_SUCCESS)
+	QDP_error_exit(QMP_error_string(err));
+    }
 
-    if (!DeviceParams::Instance().getGPUDirect()) {
-      CudaMemcpyH2D( recv_buf_dev , recv_buf , srcnum );
+    if (async_copies()) {
+      CudaMemcpyH2DAsync( recv_buf_dev , recv , srcnum );
+    } else if (!DeviceParams::Instance().getGPUDirect()) {
+      CudaMemcpyH2D( recv_buf_dev , recv , srcnum );
     }
 
 #if QDP_DEBUG >= 3
@@ -96,9 +278,8 @@ namespace QDP {
   }
 
 
-  void FnMapRsrc::send_receive() const {
+  void FnMapRsrc::send_receive(bool shift_) const {
 
-    QMP_status_t err;
 #if QDP_DEBUG >= 3
     QDP_info("Map: send = 0x%x  recv = 0x%x",send_buf,recv_buf);
     QDP_info("Map: establish send=%d recv=%d",destnodes[0],srcenodes[0]);
@@ -121,13 +302,63 @@ namespace QDP {
     QDP_info("D2H %d bytes receive buffer",dstnum);
 #endif
 
-    if (!DeviceParams::Instance().getGPUDirect()) {
+    // The copy overlaps the gather of the next shift. It is ordered
+    // after this gather by an event, not by the launch returning.
+    if (async_copies()) {
+      CudaTransferWaitKernel();
+      CudaMemcpyD2HAsync( send_buf , send_buf_dev , dstnum );
+    } else if (!DeviceParams::Instance().getGPUDirect()) {
       CudaMemcpyD2H( send_buf , send_buf_dev , dstnum );
     }
 
-    // Launch the faces
-    if ((err = QMP_start(mh)) != QMP_SUCCESS)
-      QDP_error_exit(QMP_error_string(err));
+    shift = shift_;
+    staged = true;
+    vecStaged.push_back( this );
+  }
+
+
+  void FnMapRsrc::start_pending() {
+    if (vecStaged.empty())
+      return;
+
+    if (async_copies())
+      CudaSyncTransferStream();
+
+    aggregate_staged();
+
+    // Launch the faces, an aggregated message with its first part
+    QMP_status_t err;
+    for ( auto r : vecStaged ) {
+      if (r->aggRecv) {
+	for ( HaloMessage* msg : { r->aggRecv , r->aggSend } ) {
+	  if (msg->busy)
+	    continue;
+	  if ((err = QMP_start(msg->mh)) != QMP_SUCCESS)
+	    QDP_error_exit(QMP_error_string(err));
+	  msg->busy = true;
+	}
+      } else {
+	if ((err = QMP_start(r->mh)) != QMP_SUCCESS)
+	  QDP_error_exit(QMP_error_string(err));
+      }
+      r->staged = false;
+    }
+    vecStaged.clear();
+  }
+
+
+  void FnMapRsrc::sync_received() {
+    if (async_copies())
+      CudaSyncTransferStream();
+  }
+
+
+  void FnMapRsrc::cleanup_aggregates() {
+    for ( MapHaloMessage* m : { &mapSendMsg , &mapRecvMsg } ) {
+      for ( auto& i : *m )
+	free_message( i.second );
+      m->clear();
+    }
   }
 
 
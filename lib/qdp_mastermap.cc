@@ -26,25 +26,6 @@ namespace QDP {
 
 
 
-  void MasterMap::remove_neg_in_subset(multi1d<int>& out, const multi1d<int>& orig, int s_no ) const 
-  {
-    const Subset& subset = MasterSet::Instance().getSubset(s_no);
-
-    multi1d<int> c(Layout::sitesOnNode());
-
-    int num=0;
-    for(int i=0 ; i<Layout::sitesOnNode() ; ++i) 
-      if (orig[i] >= 0 && subset.isElement(i))
-	c[num++]=i;
-
-    out.resize( num );
-
-    for(int i=0; i < num; ++i)
-      out[i] = c[i];
-  }
-
-
-
   void MasterMap::uniquify_list_inplace(multi1d<int>& out , const multi1d<int>& ll) const
   {
     multi1d<int> d(ll.size());
@@ -89,75 +70,93 @@ namespace QDP {
   }
 
 
+  // A map that is made again may receive on other sites, the
+  // combinations with it are built anew
   void MasterMap::registrate_work(const Map& map, const Subset& subset) {
 
     int id = map.getId();
     int s_no = subset.getId();
 
-    if (powerSet[ s_no].size() > id) {
+    if ( s_no >= (int)mapTables.size() )
       return;
+
+    std::map< int , Tables >& m = mapTables[s_no];
+    for ( std::map< int , Tables >::iterator t = m.begin() ; t != m.end() ; ) {
+      if ( t->first & id ) {
+	drop( t->second );
+	m.erase( t++ );
+      } else {
+	++t;
+      }
     }
-    
-    {
-      if (powerSet[ s_no].size() < id)
-	{
-	  int tmp = id;
-	  int log2id = 0;
-	  while (tmp >>= 1) ++log2id;
-	  assert(log2id > 0);
-	  log2id--;
-	  assert( vecPMap.size() > log2id );
-	  registrate_work( *vecPMap.at(log2id) , subset );
-	}
-
-      assert( powerSet[ s_no].size() == id );
-
-      powerSet[s_no].resize( id << 1 );
-      powerSetC[s_no].resize( id << 1 );
-      idInner[s_no].resize( id << 1 );
-      idFace[s_no].resize( id << 1 );
-
-      for (int i = 0 ; i < id ; ++i ) {
-	
-	multi1d<int> ct(Layout::sitesOnNode()); // complement, inner region
-	multi1d<int> pt(Layout::sitesOnNode()); // positive, union of receive sites
-	for(int q=0 ; q<Layout::sitesOnNode() ; ++q) {
-	  ct[q]=q;
-	  pt[q]=-1;
-	}
-
-	for (int q = 0 ; q < powerSet[s_no][i]->size() ; ++q ) {    // !!
-	  ct[ (*powerSet[s_no][i])[q] ] = -1;
-	  pt[ (*powerSet[s_no][i])[q] ] = (*powerSet[s_no][i])[q];
-	}
-
-	map.getRoffsetsId( subset ); // make sure the lazy part was computed!
-	for (int q = 0; q < map.roffset( subset ).size() ; ++q ) {
-	  ct[ map.roffset( subset )[q] ] = -1;
-	  pt[ map.roffset( subset )[q] ] = map.roffset( subset )[q];
-	}
-
-	powerSet[s_no][i|id] = new multi1d<int>;
-	powerSetC[s_no][i|id]= new multi1d<int>;
-
-	remove_neg_in_subset( *powerSetC[s_no][i|id] , ct , s_no );
-	remove_neg_in_subset( *powerSet[s_no][i|id] , pt , s_no );
-
-	assert( idFace.size() > s_no );
-	assert( idFace[s_no].size() > (i|id) );
-
-	assert( idInner.size() > s_no );
-	assert( idInner[s_no].size() > (i|id) );
-
-	idFace[s_no][i|id] = QDP_get_global_cache().registrateOwnHostMem( powerSet[s_no][i|id]->size() * sizeof(int) , 
-									  powerSet[s_no][i|id]->slice() , NULL );
-
-	idInner[s_no][i|id] = QDP_get_global_cache().registrateOwnHostMem( powerSetC[s_no][i|id]->size() * sizeof(int) , 
-									   powerSetC[s_no][i|id]->slice() , NULL );
+  }
+
+
+  void MasterMap::build(Tables& t,const Subset& subset,int bitmask) {
+
+    // Receive sites of all maps in the combination
+    std::vector<bool> recv( Layout::sitesOnNode() , false );
+
+    for ( int k = 0 ; k < (int)vecPMap.size() ; ++k ) {
+      if ( !( bitmask & ( 1 << k ) ) )
+	continue;
+      const Map& map = *vecPMap[k];
+      map.getRoffsetsId( subset ); // make sure the lazy part was computed!
+      const multi1d<int>& r = map.roffset( subset );
+      for (int q = 0; q < r.size() ; ++q )
+	recv[ r[q] ] = true;
+    }
+
+    for (int i = 0 ; i < Layout::sitesOnNode() ; ++i )
+      if ( subset.isElement(i) )
+	( recv[i] ? t.face : t.inner ).push_back( i );
+
+    t.inner.shrink_to_fit();
+    t.face.shrink_to_fit();
+
+    t.idFace  = QDP_get_global_cache().registrateOwnHostMem( t.face.size() * sizeof(int) , t.face.data() , NULL );
+    t.idInner = QDP_get_global_cache().registrateOwnHostMem( t.inner.size() * sizeof(int) , t.inner.data() , NULL );
+  }
+
+
+  void MasterMap::drop(Tables& t) {
+    QDP_get_global_cache().signoff( t.idFace );
+    QDP_get_global_cache().signoff( t.idInner );
+  }
+
 
+  MasterMap::Tables& MasterMap::tables(const Subset& s,int bitmask) {
+    assert( s.getId() >= 0 && "subset Id out of range");
+    assert( bitmask > 0 && bitmask < ( 1 << vecPMap.size() ) && "bitmask out of range");
+
+    if ( s.getId() >= (int)mapTables.size() )
+      mapTables.resize( s.getId() + 1 );
+
+    std::map< int , Tables >& m = mapTables[ s.getId() ];
+
+    std::map< int , Tables >::iterator t = m.find( bitmask );
+    if ( t == m.end() ) {
+      // Make room by dropping the least recently used combination
+      if ( m.size() >= max_tables ) {
+	std::map< int , Tables >::iterator lru = m.begin();
+	for ( std::map< int , Tables >::iterator i = m.begin() ; i != m.end() ; ++i )
+	  if ( i->second.lastUse < lru->second.lastUse )
+	    lru = i;
+	drop( lru->second );
+	m.erase( lru );
       }
+
+      Tables tmp;
+      build( tmp , s , bitmask );
+      t = m.insert( std::make_pair( bitmask , Tables() ) ).first;
+      t->second.inner.swap( tmp.inner );
+      t->second.face.swap( tmp.face );
+      t->second.idInner = tmp.idInner;
+      t->second.idFace  = tmp.idFace;
     }
 
+    t->second.lastUse = ++use;
+    return t->second;
   }
 
 
@@ -168,25 +167,17 @@ namespace QDP {
   }
 
   
-  int MasterMap::getIdInner(const Subset& s,int bitmask) const {
-    assert( s.getId() >= 0 && (unsigned)s.getId() < idInner.size() && "subset Id out of range");
-    assert( bitmask > 0 && (unsigned)bitmask < idInner[s.getId()].size() && "bitmask out of range");
-    return idInner[s.getId()][bitmask]; 
+  int MasterMap::getIdInner(const Subset& s,int bitmask) {
+    return tables(s,bitmask).idInner;
   }
-  int MasterMap::getIdFace(const Subset& s,int bitmask) const {
-    assert( s.getId() >= 0 && (unsigned)s.getId() < idFace.size() && "subset Id out of range");
-    assert( bitmask > 0 && (unsigned)bitmask < idFace[s.getId()].size() && "bitmask out of range");
-    return idFace[s.getId()][bitmask];
+  int MasterMap::getIdFace(const Subset& s,int bitmask) {
+    return tables(s,bitmask).idFace;
   }
-  int MasterMap::getCountInner(const Subset& s,int bitmask) const {
-    assert( s.getId() >= 0 && (unsigned)s.getId() < powerSet.size() && "subset Id out of range");
-    assert( bitmask > 0 && (unsigned)bitmask < powerSetC[s.getId()].size() && "bitmask out of range");
-    return powerSetC[s.getId()][bitmask]->size(); 
+  int MasterMap::getCountInner(const Subset& s,int bitmask) {
+    return tables(s,bitmask).inner.size();
   }
-  int MasterMap::getCountFace(const Subset& s,int bitmask) const {
-    assert( s.getId() >= 0 && (unsigned)s.getId() < powerSet.size() && "subset Id out of range");
-    assert( bitmask > 0 && (unsigned)bitmask < powerSet[s.getId()].size() && "bitmask out of range");
-    return powerSet[s.getId()][bitmask]->size(); 
+  int MasterMap::getCountFace(const Subset& s,int bitmask) {
+    return tables(s,bitmask).face.size();
   }
 
 
@@ -37,6 +37,8 @@ namespace COUNT {
   bool setPoolSize = false;
   bool setGeomP = false;
   bool setIOGeomP = false;
+  std::string host_mmap_dir;
+  int host_mmap_min = 64;           // MiB
   multi1d<int> logical_geom(Nd);   // apriori logical geometry of the machine
   multi1d<int> logical_iogeom(Nd); // apriori logical 	
 
@@ -239,8 +241,6 @@ namespace COUNT {
     //QDP_info_primary("Finished multiplying gamma matrices");
 #endif
 
-    CudaInit();
-
     // This defaults to mvapich2
 #if 0
     // This is deprecated - direct envvars try several variables
@@ -296,6 +296,21 @@ namespace COUNT {
 	  for(int i=1; i < Nd; i++) 
 	    fprintf(stderr,",-1");
 	  fprintf(stderr,"] logical machine geometry\n");
+
+	  fprintf(stderr,"    -tunedb   %%s file for persistent autotuning results\n");
+	  fprintf(stderr,"    -tune-strategy %%s [halving] autotuning search (halving, coordinate, exhaustive)\n");
+	  fprintf(stderr,"    -tune-budget %%d [500] time in ms spent on autotuning trials per kernel\n");
+	  fprintf(stderr,"    -cache-policy %%s [lru] device memory eviction policy: lru, size, clean, lfu\n");
+	  fprintf(stderr,"    -pool-compact    compact the device memory pool before evicting\n");
+	  fprintf(stderr,"    -prefetch        upload the arguments of the expected next kernel ahead of time\n");
+	  fprintf(stderr,"    -scalar-arena    allocate device scalars from generational slabs\n");
+	  fprintf(stderr,"    -halo-single     send the halos of double precision shifts in single precision\n");
+	  fprintf(stderr,"    -host-mmap %%s  keep host copies of large fields in memory mapped files in this directory\n");
+	  fprintf(stderr,"    -host-mmap-min %%d [64] smallest field in MiB kept in a mapped file\n");
+	  fprintf(stderr,"    -cache-telemetry %%s write the device memory time series at exit (CSV, or JSON with per-kernel and per-site tables for *.json)\n");
+	  fprintf(stderr,"    -llvm-target %%s [nvptx] code generation target (nvptx, host)\n");
+	  fprintf(stderr,"    -llvm-threads %%d [0] background threads for PTX code generation\n");
+	  fprintf(stderr,"    -llvm-prewarm %%s manifest of kernels to compile ahead of use\n");
 				
 #ifdef USE_REMOTE_QIO
 	  fprintf(stderr,"    -cd       %%s [.] set working dir for QIO interface\n");
@@ -337,6 +352,10 @@ namespace COUNT {
 	  {
 	    DeviceParams::Instance().setGPUDirect(true);
 	  }
+	else if (strcmp((*argv)[i], "-halo-single")==0) 
+	  {
+	    DeviceParams::Instance().setHaloSingle(true);
+	  }
 	else if (strcmp((*argv)[i], "-envvar")==0) 
 	  {
 	    char buffer[1024];
@@ -386,6 +405,76 @@ namespace COUNT {
 	    sscanf((*argv)[++i], "%s", &tmp[0]);
 	    llvm_set_ptxdb(tmp);
 	  }
+	else if (strcmp((*argv)[i], "-tunedb")==0) 
+	  {
+	    char tmp[1024];
+	    sscanf((*argv)[++i], "%s", &tmp[0]);
+	    jit_tune_set_db(tmp);
+	  }
+	else if (strcmp((*argv)[i], "-tune-strategy")==0) 
+	  {
+	    char tmp[1024];
+	    sscanf((*argv)[++i], "%s", &tmp[0]);
+	    jit_tune_set_strategy(tmp);
+	  }
+	else if (strcmp((*argv)[i], "-tune-budget")==0) 
+	  {
+	    int ms;
+	    sscanf((*argv)[++i], "%d", &ms);
+	    jit_tune_set_budget(ms);
+	  }
+	else if (strcmp((*argv)[i], "-cache-policy")==0) 
+	  {
+	    char tmp[1024];
+	    sscanf((*argv)[++i], "%s", &tmp[0]);
+	    QDP_get_global_cache().setEvictionPolicy(tmp);
+	  }
+	else if (strcmp((*argv)[i], "-pool-compact")==0) 
+	  {
+	    QDP_get_global_cache().setPoolCompaction(true);
+	  }
+	else if (strcmp((*argv)[i], "-prefetch")==0) 
+	  {
+	    QDP_get_global_cache().setPrefetchLookahead(true);
+	  }
+	else if (strcmp((*argv)[i], "-scalar-arena")==0) 
+	  {
+	    QDP_get_global_cache().setScalarArena(true);
+	  }
+	else if (strcmp((*argv)[i], "-host-mmap")==0) 
+	  {
+	    char tmp[1024];
+	    sscanf((*argv)[++i], "%s", &tmp[0]);
+	    host_mmap_dir = tmp;
+	  }
+	else if (strcmp((*argv)[i], "-host-mmap-min")==0) 
+	  {
+	    sscanf((*argv)[++i], "%d", &host_mmap_min);
+	  }
+	else if (strcmp((*argv)[i], "-cache-telemetry")==0) 
+	  {
+	    char tmp[1024];
+	    sscanf((*argv)[++i], "%s", &tmp[0]);
+	    QDP_get_global_cache().setTelemetryFile(tmp);
+	  }
+	else if (strcmp((*argv)[i], "-llvm-threads")==0) 
+	  {
+	    int n;
+	    sscanf((*argv)[++i], "%d", &n);
+	    llvm_set_threads(n);
+	  }
+	else if (strcmp((*argv)[i], "-llvm-prewarm")==0) 
+	  {
+	    char tmp[1024];
+	    sscanf((*argv)[++i], "%s", &tmp[0]);
+	    llvm_set_prewarm(tmp);
+	  }
+	else if (strcmp((*argv)[i], "-llvm-target")==0) 
+	  {
+	    char tmp[1024];
+	    sscanf((*argv)[++i], "%s", &tmp[0]);
+	    llvm_set_target(tmp);
+	  }
 	else if (strcmp((*argv)[i], "-geom")==0) 
 	  {
 	    setGeomP = true;
@@ -443,6 +532,12 @@ namespace COUNT {
       }
 		
 
+    if (!host_mmap_dir.empty())
+      QDP_get_global_cache().setHostMmap( host_mmap_dir , (size_t)host_mmap_min * 1024 * 1024 );
+
+    // The code generation target must be known before touching the driver
+    CudaInit();
+
     if (!setPoolSize) {
       // It'll be set later in CudaGetDeviceProps
       //QDP_error_exit("Run-time argument -poolsize <size> missing. Please consult README.");
@@ -595,6 +690,8 @@ namespace COUNT {
 		QDPIO::cout << "lattices changed to device layout:     " << get_jit_stats_lattice2dev() << "\n";
 		QDPIO::cout << "lattices changed to host layout:       " << get_jit_stats_lattice2host() << "\n";
 		QDPIO::cout << "functions jit-compiled:                " << get_jit_stats_jitted() << "\n";
+		QDPIO::cout << "statements in fused kernels:           " << get_jit_stats_fused() << "\n";
+		QDPIO::cout << "fused reads of earlier results:        " << get_jit_stats_fused_reads() << "\n";
 		if (get_ptx_db_enabled())
 		  {
 		    QDPIO::cout << "PTX DB, file:                          " << get_ptx_db_fname() << "\n";
@@ -604,7 +701,18 @@ namespace COUNT {
 		  {
 		    QDPIO::cout << "PTX DB: (not used)\n";
 		  }
+		if (jit_tune_db_enabled())
+		  {
+		    QDPIO::cout << "Tune DB, file:                         " << jit_tune_db_fname() << "\n";
+		    QDPIO::cout << "Tune DB, size (number of entries):     " << jit_tune_db_size() << "\n";
+		    QDPIO::cout << "Tune DB, kernels started tuned:        " << jit_tune_db_hits() << "\n";
+		  }
+		QDP_get_global_cache().printEvictionStats();
+		QDP_get_global_cache().printMemoryReport();
 		
+		JitCompilePool::Instance().shutdown();
+		QDP_get_global_cache().prefetchShutdown();
+
 		FnMapRsrcMatrix::Instance().cleanup();
 
 #if defined(QDP_USE_HDF5)
@@ -363,6 +363,9 @@ namespace QDP
 	  QDP_error_exit("Layout::create - Layout problems, the layout functions do not work correctly with this lattice size");
       }
 #endif
+      // Kernel ids depend on the local volume
+      llvm_prewarm_start();
+
       // Initialize various defaults
       initDefaults();
 
@@ -40,6 +40,33 @@ namespace QDP {
   }
 
 
+  namespace {
+    // Node and linear index of the site that coord is mapped from
+    // (isign > 0, the source) or to (isign < 0). A nearest neighbor
+    // shift is applied to coord in place, without the map function.
+    void map_site(const MapFunc& func, int shift_dir, int shift_sign, multi1d<int>& coord, int isign, int& node, int* line)
+    {
+      if (shift_dir >= 0)
+	{
+	  const int n = Layout::lattSize()[shift_dir];
+	  const int x = coord[shift_dir];
+	  coord[shift_dir] = (x + (isign > 0 ? shift_sign : -shift_sign) + n) % n;
+	  node = Layout::nodeNumber(coord);
+	  if (line)
+	    *line = Layout::linearSiteIndex(coord);
+	  coord[shift_dir] = x;
+	}
+      else
+	{
+	  multi1d<int> mcoord = func(coord,isign);
+	  node = Layout::nodeNumber(mcoord);
+	  if (line)
+	    *line = Layout::linearSiteIndex(mcoord);
+	}
+    }
+  }
+
+
   void Map::make(const MapFunc& func)
   {
 #if QDP_DEBUG >= 3
@@ -53,8 +80,13 @@ namespace QDP {
     dstnode.resize(nodeSites);
 
     // LAZY
-    lazy_fcoord.resize(nodeSites);
-    lazy_bcoord.resize(nodeSites);
+    lazy_fline.resize(nodeSites);
+
+    int shift_dir = -1;
+    int shift_sign = 0;
+    if (!func.isShift(shift_dir, shift_sign))
+      shift_dir = -1;
+    shiftP = shift_dir >= 0;
 
     // Loop over the sites on this node
     for(int linear=0; linear < nodeSites; ++linear) 
@@ -63,18 +95,13 @@ namespace QDP {
 	multi1d<int> coord = Layout::siteCoords(my_node, linear);
 	  
 	// Source neighbor for this destination site
-	multi1d<int> fcoord = func(coord,+1);
-	  
+	int fnode;
+	map_site(func, shift_dir, shift_sign, coord, +1, fnode, &lazy_fline[linear]);
+
 	// Destination neighbor receiving data from this site
 	// This functions as the inverse map
-	multi1d<int> bcoord = func(coord,-1);
-
-	// LAZY, save for later
-	lazy_fcoord[linear] = fcoord;
-	lazy_bcoord[linear] = bcoord;
-
-	int fnode = Layout::nodeNumber(fcoord);
-	int bnode = Layout::nodeNumber(bcoord);
+	int bnode;
+	map_site(func, shift_dir, shift_sign, coord, -1, bnode, NULL);
 
 	// Source linear site and node
 	srcnode[linear]  = fnode;
@@ -165,11 +192,12 @@ namespace QDP {
       QDP_error_exit("Map: for now only allow receives from 1 node");
 
     
-    lazy_destnodes0_fcoord.resize( nodeSites );
+    lazy_destnodes0_fnode.resize( nodeSites );
+    lazy_destnodes0_fline.resize( nodeSites );
     for(int i=0; i < nodeSites; ++i)
       {
 	multi1d<int> coord = Layout::siteCoords(destnodes[0], i);
-	lazy_destnodes0_fcoord[i] = func(coord,+1);
+	map_site(func, shift_dir, shift_sign, coord, +1, lazy_destnodes0_fnode[i], &lazy_destnodes0_fline[i]);
       }
 
   } // make (not lazy part)
@@ -213,7 +241,7 @@ namespace QDP {
       {
 	if (srcnode[linear] == my_node)
 	  {
-	    goffsets[s_no][linear] = Layout::linearSiteIndex(lazy_fcoord[linear]);
+	    goffsets[s_no][linear] = lazy_fline[linear];
 	  }
 	else
 	  {
@@ -292,10 +320,8 @@ namespace QDP {
     int si=0;
     for(int i=0; i < nodeSites; ++i) 
       {
-	multi1d<int> fcoord = lazy_destnodes0_fcoord[i];
-	    
-	int fnode = Layout::nodeNumber(fcoord);
-	int fline = Layout::linearSiteIndex(fcoord);
+	int fnode = lazy_destnodes0_fnode[i];
+	int fline = lazy_destnodes0_fline[i];
 
 	if ( MasterSet::Instance().getSubset(s_no).isElement(i)  &&  fnode == my_node )
 	  soffsets[s_no][si++] = fline;
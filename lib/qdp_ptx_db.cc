@@ -0,0 +1,443 @@
+#include "qdp.h"
+#include "qdp_ptx_db.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <csignal>
+
+namespace QDP {
+
+  namespace {
+    const uint32_t PTXDB_MAGIC = 0x42445850;  // "PXDB"
+
+    struct record_t {
+      uint32_t magic;
+      uint32_t key_size;
+      uint64_t ptx_size;
+      uint32_t crc;
+      uint32_t pad;
+    };
+
+    uint32_t record_crc( const char* key , size_t key_size , const char* ptx , size_t ptx_size )
+    {
+      QDPUtil::n_uint32_t crc = QDPUtil::crc32( 0 , key , key_size );
+      return QDPUtil::crc32( crc , ptx , ptx_size );
+    }
+  }
+
+
+  PTXDB::PTXDB(): fd(-1), map_ptr(NULL), map_size(0), valid_end(0), lease_timeout(600), use_leases(true) {}
+
+  PTXDB::~PTXDB()
+  {
+    close();
+  }
+
+
+  void PTXDB::open( const std::string& fname_ , bool use_leases_ )
+  {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+    close();
+    fname = fname_;
+    use_leases = use_leases_;
+
+    fd = ::open( fname.c_str() , O_RDWR | O_CREAT | O_APPEND , 0644 );
+    if (fd < 0)
+      QDP_error_exit("PTX DB: could not open %s: %s",fname.c_str(),strerror(errno));
+
+    if (use_leases && mkdir( (fname + ".lock").c_str() , 0755 ) != 0 && errno != EEXIST)
+      QDP_error_exit("PTX DB: could not create lease directory %s.lock: %s",fname.c_str(),strerror(errno));
+
+    remap();
+
+    // A file that doesn't start with a record is from an older version
+    // of the DB. Its contents are dropped with the first append.
+    if (!scan()) {
+      if (valid_end == 0)
+	QDP_info("PTX DB: %s is not in the indexed log format (written by an older version?), rebuilding it",fname.c_str());
+      else
+	QDPIO::cout << "PTX DB: ignoring " << map_size - valid_end << " bytes of truncated or foreign data at the end of " << fname << "\n";
+    }
+
+    QDPIO::cout << "PTX DB: " << index.size() << " kernels indexed in " << fname << "\n";
+  }
+
+
+  void PTXDB::close()
+  {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+    // Don't make other ranks wait for kernels we won't append
+    while (!leases.empty())
+      release_lease( *leases.begin() );
+
+    if (map_ptr)
+      munmap( map_ptr , map_size );
+    if (fd >= 0)
+      ::close( fd );
+    fd = -1;
+    map_ptr = NULL;
+    map_size = 0;
+    valid_end = 0;
+    index.clear();
+    bodies.clear();
+  }
+
+
+  void PTXDB::remap()
+  {
+    if (map_ptr)
+      munmap( map_ptr , map_size );
+    map_ptr = NULL;
+    map_size = 0;
+
+    struct stat st;
+    if (fstat( fd , &st ) != 0)
+      QDP_error_exit("PTX DB: could not stat %s: %s",fname.c_str(),strerror(errno));
+
+    map_size = st.st_size;
+    if (map_size > 0) {
+      void* p = mmap( NULL , map_size , PROT_READ , MAP_SHARED , fd , 0 );
+      if (p == MAP_FAILED)
+	QDP_error_exit("PTX DB: could not map %s: %s",fname.c_str(),strerror(errno));
+      map_ptr = (char*)p;
+      madvise( map_ptr , map_size , MADV_RANDOM );
+    }
+  }
+
+
+  // Walks the record headers starting at the end of the last
+  // valid record. Returns false if the log has an invalid tail.
+  bool PTXDB::scan()
+  {
+    size_t pos = valid_end;
+    while ( pos + sizeof(record_t) <= map_size ) {
+      record_t rec;
+      memcpy( &rec , map_ptr + pos , sizeof(record_t) );
+
+      if ( rec.magic != PTXDB_MAGIC )
+	break;
+
+      size_t end = pos + sizeof(record_t) + rec.key_size + rec.ptx_size;
+      if ( end > map_size || end < pos )
+	break;
+
+      std::string key( map_ptr + pos + sizeof(record_t) , rec.key_size );
+      if ( index.count( key ) == 0 ) {
+	entry_t e;
+	e.offset = pos;
+	e.loaded = false;
+	index[ key ] = e;
+      }
+
+      pos = end;
+    }
+    valid_end = pos;
+    return valid_end == map_size;
+  }
+
+
+  void PTXDB::refresh()
+  {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+    struct stat st;
+    if (fstat( fd , &st ) != 0)
+      QDP_error_exit("PTX DB: could not stat %s: %s",fname.c_str(),strerror(errno));
+
+    if ( (size_t)st.st_size == map_size )
+      return;
+
+    // An invalid tail here might as well be an append in progress
+    remap();
+    if ( valid_end > map_size )
+      valid_end = 0;
+    scan();
+  }
+
+
+  bool PTXDB::check_record( size_t offset , std::string& ptx ) const
+  {
+    record_t rec;
+    memcpy( &rec , map_ptr + offset , sizeof(record_t) );
+
+    const char* key_ptr = map_ptr + offset + sizeof(record_t);
+    const char* ptx_ptr = key_ptr + rec.key_size;
+
+    if ( record_crc( key_ptr , rec.key_size , ptx_ptr , rec.ptx_size ) != rec.crc )
+      return false;
+
+    ptx.assign( ptx_ptr , rec.ptx_size );
+    return true;
+  }
+
+
+  std::vector< std::string > PTXDB::keys() const
+  {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+    std::vector< std::string > ret;
+    for ( std::map< std::string , entry_t >::const_iterator it = index.begin() ; it != index.end() ; ++it )
+      ret.push_back( it->first );
+    return ret;
+  }
+
+
+  bool PTXDB::contains( const std::string& key ) const
+  {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+    return index.count( key ) > 0;
+  }
+
+
+  bool PTXDB::find( const std::string& key , std::string& ptx )
+  {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+    std::map< std::string , entry_t >::iterator it = index.find( key );
+    if ( it == index.end() )
+      return false;
+
+    if ( ! it->second.loaded ) {
+      std::string body;
+      if ( ! check_record( it->second.offset , body ) ) {
+	QDPIO::cout << "PTX DB: checksum mismatch, dropping entry " << key << "\n";
+	index.erase( it );
+	return false;
+      }
+      bodies[ key ] = body;
+      it->second.loaded = true;
+    }
+
+    ptx = bodies[ key ];
+    return true;
+  }
+
+
+  void PTXDB::lock()
+  {
+    struct flock fl;
+    fl.l_type   = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start  = 0;
+    fl.l_len    = 0;
+    while ( fcntl( fd , F_SETLKW , &fl ) != 0 )
+      if (errno != EINTR)
+	QDP_error_exit("PTX DB: could not lock %s: %s",fname.c_str(),strerror(errno));
+  }
+
+
+  void PTXDB::unlock()
+  {
+    struct flock fl;
+    fl.l_type   = F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start  = 0;
+    fl.l_len    = 0;
+    fcntl( fd , F_SETLK , &fl );
+  }
+
+
+  void PTXDB::append( const std::string& key , const std::string& ptx )
+  {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+    lock();
+
+    // Writers hold the lock, so an invalid tail now is a leftover
+    // from a crashed writer
+    refresh();
+    if ( valid_end != map_size ) {
+      if ( ftruncate( fd , valid_end ) != 0 )
+	QDP_error_exit("PTX DB: could not truncate %s: %s",fname.c_str(),strerror(errno));
+      remap();
+    }
+
+    // Another rank might have appended it meanwhile (broken lease)
+    if ( contains( key ) ) {
+      unlock();
+      return;
+    }
+
+    record_t rec;
+    rec.magic    = PTXDB_MAGIC;
+    rec.key_size = key.size();
+    rec.ptx_size = ptx.size();
+    rec.crc      = record_crc( key.data() , key.size() , ptx.data() , ptx.size() );
+    rec.pad      = 0;
+
+    // One write per record, so that concurrent readers never see
+    // a header without its payload (other than after a crash)
+    std::string buf( (const char*)&rec , sizeof(record_t) );
+    buf += key;
+    buf += ptx;
+
+    const char* p = buf.data();
+    size_t left = buf.size();
+    while (left > 0) {
+      ssize_t n = ::write( fd , p , left );
+      if (n < 0) {
+	if (errno == EINTR)
+	  continue;
+	QDP_error_exit("PTX DB: could not append to %s: %s",fname.c_str(),strerror(errno));
+      }
+      p += n;
+      left -= n;
+    }
+
+    unlock();
+
+    entry_t e;
+    e.offset = 0;
+    e.loaded = true;
+    index[ key ] = e;
+    bodies[ key ] = ptx;
+  }
+
+
+  std::string PTXDB::lease_name( const std::string& key ) const
+  {
+    char buf[64];
+    snprintf( buf , sizeof(buf) , "/%08x_%zu" , (unsigned)QDPUtil::crc32( 0 , key.data() , key.size() ) , key.size() );
+    return fname + ".lock" + buf;
+  }
+
+
+  namespace {
+    std::string lease_owner()
+    {
+      char host[256];
+      if ( gethostname( host , sizeof(host) ) != 0 )
+	host[0] = 0;
+      host[sizeof(host)-1] = 0;
+      return std::string( host ) + " " + std::to_string( (long)getpid() ) + "\n";
+    }
+
+    // The lease holder ran on this host and is gone
+    bool lease_owner_dead( const std::string& name )
+    {
+      char buf[300];
+      int lfd = ::open( name.c_str() , O_RDONLY );
+      if (lfd < 0)
+	return false;
+      ssize_t n = ::read( lfd , buf , sizeof(buf) - 1 );
+      ::close( lfd );
+      if (n <= 0)
+	return false;
+      buf[n] = 0;
+
+      char host[256];
+      long pid;
+      if ( sscanf( buf , "%255s %ld" , host , &pid ) != 2 )
+	return false;
+
+      std::string me = lease_owner();
+      if ( me.compare( 0 , me.find(' ') , host ) != 0 )
+	return false;
+      return kill( (pid_t)pid , 0 ) != 0 && errno == ESRCH;
+    }
+  }
+
+
+  // The lease file holds host and pid of the holder
+  bool PTXDB::try_lease( const std::string& key )
+  {
+    // Every rank produces the records itself
+    if (!use_leases)
+      return true;
+
+    std::string name = lease_name( key );
+
+    for ( int attempt = 0 ; attempt < 2 ; ++attempt ) {
+      int lfd = ::open( name.c_str() , O_WRONLY | O_CREAT | O_EXCL , 0644 );
+      if (lfd >= 0) {
+	std::string owner = lease_owner();
+	if ( ::write( lfd , owner.data() , owner.size() ) < 0 )
+	  QDP_info("PTX DB: could not write lease %s: %s",name.c_str(),strerror(errno));
+	::close( lfd );
+	leases.insert( key );
+	return true;
+      }
+      if (errno != EEXIST)
+	QDP_error_exit("PTX DB: could not create lease %s: %s",name.c_str(),strerror(errno));
+
+      // Break stale leases left by ranks that died while compiling
+      struct stat st;
+      if ( stat( name.c_str() , &st ) == 0 && time(NULL) - st.st_mtime < lease_timeout && !lease_owner_dead( name ) )
+	return false;
+      unlink( name.c_str() );
+    }
+    return false;
+  }
+
+
+  // Only leases taken by this process are released, a lease file of
+  // the same key belongs to another rank otherwise
+  void PTXDB::release_lease( const std::string& key )
+  {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+    if ( leases.erase( key ) )
+      unlink( lease_name( key ).c_str() );
+  }
+
+
+  bool PTXDB::wait_or_lease( const std::string& key , std::string& ptx )
+  {
+    if ( find( key , ptx ) )
+      return true;
+
+    refresh();
+    if ( find( key , ptx ) )
+      return true;
+
+    time_t deadline = time(NULL) + lease_timeout;
+
+    while (true) {
+      {
+	// Not held while sleeping, the compile pool appends meanwhile
+	std::lock_guard<std::recursive_mutex> guard(mtx);
+	if ( try_lease( key ) ) {
+	  // The previous holder might have appended it just now
+	  refresh();
+	  if ( find( key , ptx ) ) {
+	    release_lease( key );
+	    return true;
+	  }
+	  return false;
+	}
+      }
+
+      // The holder is alive but doesn't get it done, compile it here
+      // without lease. append skips it if the holder was faster.
+      if ( time(NULL) > deadline ) {
+	QDP_info("PTX DB: gave up waiting for another rank to compile %s",lease_name( key ).c_str());
+	return false;
+      }
+
+      usleep( 100000 );
+
+      refresh();
+      if ( find( key , ptx ) )
+	return true;
+    }
+  }
+
+
+  bool PTXDB::lease( const std::string& key )
+  {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+
+    refresh();
+    if ( contains( key ) || ! try_lease( key ) )
+      return false;
+
+    // The previous holder might have appended it just now
+    refresh();
+    if ( contains( key ) ) {
+      release_lease( key );
+      return false;
+    }
+    return true;
+  }
+
+}
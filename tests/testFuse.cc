@@ -0,0 +1,83 @@
+#include "qdp.h"
+#include "testFuse.h"
+#include "unittest.h"
+
+using namespace QDP;
+using namespace std;
+using namespace Assertions;
+
+
+namespace {
+  // Relative difference, the kernels may contract multiply-adds differently
+  template<class T>
+  double rel_diff( const OLattice<T>& x , const OLattice<T>& y )
+  {
+    double diff = toDouble( norm2( x - y ) );
+    double norm = toDouble( norm2( y ) );
+    QDPIO::cout << endl << "Diff = " << diff << "  norm = " << norm << endl;
+    return norm > 0.0 ? diff / norm : diff;
+  }
+}
+
+
+// A statement reads the result of the previous one
+void
+testFuseAll::run()
+{
+  LatticeColorMatrixD b, c, e;
+  gaussian(b);
+  gaussian(c);
+  gaussian(e);
+
+  LatticeColorMatrixD a_u, d_u;
+  a_u = b + c;
+  d_u = a_u * e;
+
+  LatticeColorMatrixD a_f, d_f;
+  jit_fuse( all , fuse_assign( a_f , b + c ) , fuse_assign( d_f , a_f * e ) );
+
+  assertion( rel_diff( a_f , a_u ) < 1.0e-24 );
+  assertion( rel_diff( d_f , d_u ) < 1.0e-24 );
+}
+
+
+// Sites outside the subset keep their values
+void
+testFuseSubset::run()
+{
+  LatticeColorMatrixD b, e, a0, d0;
+  gaussian(b);
+  gaussian(e);
+  gaussian(a0);
+  gaussian(d0);
+
+  LatticeColorMatrixD a_u = a0, d_u = d0;
+  a_u[rb[1]] += b;
+  d_u[rb[1]] = a_u * e;
+
+  LatticeColorMatrixD a_f = a0, d_f = d0;
+  jit_fuse( rb[1] , fuse_add_assign( a_f , b ) , fuse_assign( d_f , a_f * e ) );
+
+  assertion( rel_diff( a_f , a_u ) < 1.0e-24 );
+  assertion( rel_diff( d_f , d_u ) < 1.0e-24 );
+}
+
+
+// A shift makes jit_fuse evaluate the statements one by one
+void
+testFuseShift::run()
+{
+  LatticeColorMatrixD b, c;
+  gaussian(b);
+  gaussian(c);
+
+  LatticeColorMatrixD a_u, d_u;
+  a_u = b * c;
+  d_u = shift( a_u , FORWARD , 0 ) + b;
+
+  LatticeColorMatrixD a_f, d_f;
+  jit_fuse( all , fuse_assign( a_f , b * c ) , fuse_assign( d_f , shift( a_f , FORWARD , 0 ) + b ) );
+
+  assertion( rel_diff( a_f , a_u ) < 1.0e-24 );
+  assertion( rel_diff( d_f , d_u ) < 1.0e-24 );
+}
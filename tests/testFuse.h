@@ -0,0 +1,13 @@
+#ifndef TEST_FUSE_H
+#define TEST_FUSE_H
+
+#ifndef UNITTEST_H
+#include "unittest.h"
+#endif
+
+// Fused statements (jit_fuse) against the same statements evaluated one by one
+class testFuseAll      : public TestFixture { public: void run(void); };
+class testFuseSubset   : public TestFixture { public: void run(void); };
+class testFuseShift    : public TestFixture { public: void run(void); };
+
+#endif
@@ -0,0 +1,250 @@
+#include "unittest.h"
+#include "testPoolAllocator.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <map>
+#include <algorithm>
+#include <iterator>
+
+using namespace QDP;
+using namespace std;
+using namespace Assertions;
+
+// Host memory in place of device memory. Each test instantiates its
+// own N, QDPPoolAllocator is a singleton per Allocator.
+template<int N>
+struct MallocAllocator {
+  enum { ALIGNMENT_SIZE = 4096 };
+
+  static bool allocate( void** ptr , const size_t n_bytes ) {
+    *ptr = std::malloc( n_bytes );
+    return *ptr != NULL;
+  }
+
+  static void free( const void *mem ) {
+    std::free( const_cast<void*>( mem ) );
+  }
+
+  static void copy( void* dest , const void* src , size_t n_bytes ) {
+    std::memcpy( dest , src , n_bytes );
+  }
+};
+
+static const size_t page = 4096;
+
+static void* offset( void* p , size_t n ) { return (void*)( (size_t)p + n ); }
+
+
+// Freed blocks merge with free neighbours on both sides, allocation
+// takes the smallest block that fits
+void
+testPoolCoalesce::run(void)
+{
+  typedef QDPPoolAllocator< MallocAllocator<0> > Pool;
+  Pool& pool = Pool::Instance();
+  pool.setPoolSize( 256 * page );
+
+  void *a, *b, *c;
+  assertion( pool.allocate( &a , page ) );
+  assertion( pool.allocate( &b , page ) );
+  assertion( pool.allocate( &c , 1 ) );
+  assertion( b == offset( a , page ) );
+  assertion( c == offset( b , page ) );
+
+  // Hole in front, c merges with the rest of the pool
+  pool.free( a );
+  pool.free( c );
+
+  // Best fit: the hole, not the large block
+  void* d;
+  assertion( pool.allocate( &d , page ) );
+  assertion( d == a );
+  pool.free( d );
+
+  // b merges with the hole and the rest, the whole pool is one block
+  pool.free( b );
+  void* e;
+  assertion( pool.allocate( &e , pool.getPoolSize() ) );
+  assertion( e == a );
+  pool.free( e );
+}
+
+
+// Largest gap between the live blocks of a pool at [base,base+size)
+static size_t largest_gap( const std::map< size_t , size_t >& live , size_t base , size_t size )
+{
+  size_t gap = 0;
+  size_t end = base;
+  for ( auto& l : live ) {
+    gap = std::max( gap , l.first - end );
+    end = l.first + l.second;
+  }
+  return std::max( gap , base + size - end );
+}
+
+
+// Random allocate and free. Live blocks must not overlap, an
+// allocation may fail only if no gap fits, and once everything is
+// freed the pool is one block again.
+void
+testPoolRandom::run(void)
+{
+  typedef QDPPoolAllocator< MallocAllocator<1> > Pool;
+  Pool& pool = Pool::Instance();
+  pool.setPoolSize( 1024 * page );
+
+  void* base;
+  assertion( pool.allocate( &base , page ) );
+  pool.free( base );
+
+  std::mt19937 rng( 1234 );
+  std::map< size_t , size_t > live;   // address -> size
+
+  for (int step = 0 ; step < 20000 ; ++step) {
+    if ( live.empty() || rng() % 2 ) {
+      size_t n_bytes = 1 + rng() % ( 32 * page );
+      size_t size = ( n_bytes + page - 1 ) & ~( page - 1 );
+      void* p;
+      if ( pool.allocate( &p , n_bytes ) ) {
+	std::map< size_t , size_t >::iterator it = live.insert( std::make_pair( (size_t)p , size ) ).first;
+	if ( it != live.begin() )
+	  assertion( std::prev( it )->first + std::prev( it )->second <= it->first );
+	if ( std::next( it ) != live.end() )
+	  assertion( it->first + size <= std::next( it )->first );
+      } else {
+	assertion( largest_gap( live , (size_t)base , pool.getPoolSize() ) < size );
+      }
+    } else {
+      std::map< size_t , size_t >::iterator it = live.begin();
+      std::advance( it , rng() % live.size() );
+      pool.free( (void*)it->first );
+      live.erase( it );
+    }
+  }
+
+  for ( auto& l : live )
+    pool.free( (void*)l.first );
+
+  void* p;
+  assertion( pool.allocate( &p , pool.getPoolSize() ) );
+  pool.free( p );
+}
+
+
+// Compaction slides the movable blocks down, keeps their contents and
+// leaves a pinned block in place
+void
+testPoolCompact::run(void)
+{
+  typedef QDPPoolAllocator< MallocAllocator<3> > Pool;
+  Pool& pool = Pool::Instance();
+  pool.setPoolSize( 64 * page );
+
+  // Blocks of 1..8 pages, contents tell them apart
+  std::vector<void*> blocks( 8 );
+  for (int i = 0 ; i < 8 ; ++i) {
+    assertion( pool.allocate( &blocks[i] , (i+1) * page ) );
+    std::memset( blocks[i] , i , (i+1) * page );
+  }
+  for (int i = 0 ; i < 8 ; i += 2)
+    pool.free( blocks[i] );
+
+  void* pinned = blocks[3];
+  std::map<void*,int> index;
+  for (int i = 1 ; i < 8 ; i += 2)
+    index[ blocks[i] ] = i;
+
+  size_t moved = pool.compact( [&]( void* p ) { return p != pinned; } ,
+			       [&]( void* from , void* to ) { blocks[ index[from] ] = to; } );
+
+  // Blocks 1 and 3 end at page 6 and 10, 5 and 7 follow 3 directly:
+  // a hole of 4 pages before 3 and the rest from page 24 on
+  assertEquals( moved , ( 2 + 6 + 8 ) * page );
+  assertion( blocks[3] == pinned );
+  assertEquals( pool.getFreeBytes() , 44 * page );
+  assertEquals( pool.getLargestFree() , pool.getPoolSize() - 24 * page );
+
+  for (int i = 1 ; i < 8 ; i += 2) {
+    const char* p = (const char*)blocks[i];
+    for (size_t j = 0 ; j < (i+1) * page ; ++j)
+      assertEquals( (int)p[j] , i );
+  }
+
+  for (int i = 1 ; i < 8 ; i += 2)
+    pool.free( blocks[i] );
+  assertEquals( pool.getLargestFree() , pool.getPoolSize() );
+}
+
+
+// Random sequence of lattice field sized requests. Allocations are
+// twice as likely as frees until max_live blocks are live. A request
+// fails when no block fits, as on a full GPU.
+template<class A>
+static double replay( A& pool , const std::vector<size_t>& sizes , int ops , int max_live , int& failed )
+{
+  std::mt19937 rng( 4321 );
+  std::vector<void*> live;
+  failed = 0;
+
+  StopWatch swatch;
+  swatch.reset();
+  swatch.start();
+  for (int i = 0 ; i < ops ; ++i) {
+    if ( live.empty() || ( live.size() < (size_t)max_live && rng() % 3 ) ) {
+      void* p;
+      if ( pool.allocate( &p , sizes[ rng() % sizes.size() ] ) )
+	live.push_back( p );
+      else
+	failed++;
+    } else {
+      size_t k = rng() % live.size();
+      pool.free( live[k] );
+      live[k] = live.back();
+      live.pop_back();
+    }
+  }
+  for ( auto p : live )
+    pool.free( p );
+  swatch.stop();
+
+  return swatch.getTimeInSeconds();
+}
+
+
+void
+time_POOL_ALLOCATOR::run(void)
+{
+  const int ops      = 100000;
+  const int max_live = 2000;
+
+  size_t v = Layout::sitesOnNode();
+  std::vector<size_t> sizes;
+  sizes.push_back( v * sizeof( LatticeRealF::SubType_t ) );
+  sizes.push_back( v * sizeof( LatticeComplexD::SubType_t ) );
+  sizes.push_back( v * sizeof( LatticeColorMatrixF::SubType_t ) );
+  sizes.push_back( v * sizeof( LatticeColorMatrixD::SubType_t ) );
+  sizes.push_back( v * sizeof( LatticeFermionD::SubType_t ) );
+  sizes.push_back( v * sizeof( LatticePropagatorF::SubType_t ) );
+
+  // Room for about half of the blocks, so that fragmentation matters
+  size_t mean = 0;
+  for ( auto s : sizes )
+    mean += s / sizes.size();
+  const size_t pool_size = ( ( mean * max_live / 2 ) + page - 1 ) & ~( page - 1 );
+
+  typedef QDPPoolAllocator< MallocAllocator<2> > Pool;
+  Pool& pool = Pool::Instance();
+  pool.setPoolSize( pool_size );
+
+  int failed;
+  double t = replay( pool , sizes , ops , max_live , failed );
+
+  void* p;
+  assertion( pool.allocate( &p , pool.getPoolSize() ) );
+  pool.free( p );
+
+  QDPIO::cout << endl << "Timing " << ops << " random allocate/free, up to " << max_live << " live blocks, pool " << pool_size << " bytes" << endl;
+  QDPIO::cout << "\t " << t << " s, " << failed << " failed allocations" << endl;
+}
@@ -0,0 +1,16 @@
+#ifndef TEST_POOL_ALLOCATOR_H
+#define TEST_POOL_ALLOCATOR_H
+
+#ifndef UNITTEST_H
+#include "unittest.h"
+#endif
+
+// QDPPoolAllocator on host memory, no GPU needed
+class testPoolCoalesce  : public TestFixture { public: void run(void); };
+class testPoolRandom   : public TestFixture { public: void run(void); };
+class testPoolCompact  : public TestFixture { public: void run(void); };
+
+// Timing of random allocate/free with lattice field sizes
+class time_POOL_ALLOCATOR : public TestFixture { public: void run(void); };
+
+#endif
@@ -0,0 +1,211 @@
+#include "qdp.h"
+#include "testReductions.h"
+#include "unittest.h"
+#include <cmath>
+
+using namespace QDP;
+using namespace std;
+using namespace Assertions;
+
+//
+// The fields are integer valued functions of the coordinates, so the
+// host computes the exact values without reading them back.
+//
+//   x = 1 + sum_mu (mu+1) c_mu
+//   y = sum_mu (2-mu) c_mu - 3
+//
+// Besides the checkerboards the reductions run on an irregular subset
+// (c_0 < 3 and c_1 even) and on the time slices.
+//
+
+namespace {
+
+  double x_host( const multi1d<int>& c )
+  {
+    double r = 1;
+    for( int mu = 0 ; mu < Nd ; ++mu )
+      r += (mu + 1) * c[mu];
+    return r;
+  }
+
+  double y_host( const multi1d<int>& c )
+  {
+    double r = -3;
+    for( int mu = 0 ; mu < Nd ; ++mu )
+      r += (2 - mu) * c[mu];
+    return r;
+  }
+
+  void make_fields( LatticeRealD& x , LatticeRealD& y )
+  {
+    x = 1;
+    y = -3;
+    for( int mu = 0 ; mu < Nd ; ++mu ) {
+      x += Real( mu + 1 ) * LatticeReal( Layout::latticeCoordinate(mu) );
+      y += Real( 2 - mu ) * LatticeReal( Layout::latticeCoordinate(mu) );
+    }
+  }
+
+  class IrregularFunc : public SetFunc
+  {
+  public:
+    int operator() (const multi1d<int>& c) const { return ( c[0] < 3 && c[1] % 2 == 0 ) ? 1 : 0; }
+    int numSubsets() const { return 2; }
+  };
+
+  class TimeSliceFunc : public SetFunc
+  {
+  public:
+    int operator() (const multi1d<int>& c) const { return c[Nd-1]; }
+    int numSubsets() const { return Layout::lattSize()[Nd-1]; }
+  };
+
+  const Set& irregular()
+  {
+    static Set s;
+    static bool made = false;
+    if (!made) {
+      s.make( IrregularFunc() );
+      made = true;
+    }
+    return s;
+  }
+
+  // Calls f( coordinate ) for all sites of the lattice
+  template<class F>
+  void for_all_sites( F f )
+  {
+    multi1d<int> c( Nd );
+    for( int site = 0 ; site < Layout::vol() ; ++site ) {
+      int r = site;
+      for( int mu = 0 ; mu < Nd ; ++mu ) {
+	c[mu] = r % Layout::lattSize()[mu];
+	r /= Layout::lattSize()[mu];
+      }
+      f( c );
+    }
+  }
+
+  int parity( const multi1d<int>& c )
+  {
+    int p = 0;
+    for( int mu = 0 ; mu < Nd ; ++mu )
+      p += c[mu];
+    return p & 1;
+  }
+
+  bool close( double device , double host )
+  {
+    QDPIO::cout << endl << "Device = " << device << "  host = " << host << endl;
+    return fabs( device - host ) <= 1.0e-12 * std::max( 1.0 , fabs( host ) );
+  }
+}
+
+
+void
+testSumSubset::run()
+{
+  LatticeRealD x, y;
+  make_fields( x , y );
+
+  double h_rb1 = 0, h_irr = 0;
+  for_all_sites( [&]( const multi1d<int>& c ) {
+      if ( parity(c) == 1 )
+	h_rb1 += x_host(c);
+      if ( IrregularFunc()(c) == 1 )
+	h_irr += x_host(c);
+    } );
+
+  assertion( close( toDouble( sum( x , rb[1] ) ) , h_rb1 ) );
+  assertion( close( toDouble( sum( x , irregular()[1] ) ) , h_irr ) );
+}
+
+
+// Reductions of expressions (evaluated inside the reduction kernel)
+void
+testSumExpr::run()
+{
+  LatticeRealD x, y;
+  make_fields( x , y );
+
+  double h_sum = 0, h_norm = 0, h_norm_rb0 = 0;
+  for_all_sites( [&]( const multi1d<int>& c ) {
+      double d = x_host(c) - y_host(c);
+      if ( IrregularFunc()(c) == 1 ) {
+	h_sum  += x_host(c) * y_host(c) + x_host(c);
+	h_norm += d * d;
+      }
+      if ( parity(c) == 0 )
+	h_norm_rb0 += d * d;
+    } );
+
+  assertion( close( toDouble( sum( x * y + x , irregular()[1] ) ) , h_sum ) );
+  assertion( close( toDouble( norm2( x - y , irregular()[1] ) ) , h_norm ) );
+  assertion( close( toDouble( norm2( x - y , rb[0] ) ) , h_norm_rb0 ) );
+}
+
+
+void
+testSumMulti::run()
+{
+  LatticeRealD x, y;
+  make_fields( x , y );
+
+  Set timeslices;
+  timeslices.make( TimeSliceFunc() );
+
+  multi1d<double> h( Layout::lattSize()[Nd-1] );
+  h = 0;
+  for_all_sites( [&]( const multi1d<int>& c ) {
+      h[ c[Nd-1] ] += x_host(c) * y_host(c);
+    } );
+
+  multi1d<RealD> d = sumMulti( x * y , timeslices );
+
+  assertion( d.size() == h.size() );
+  for( int t = 0 ; t < h.size() ; ++t )
+    assertion( close( toDouble( d[t] ) , h[t] ) );
+}
+
+
+void
+testGlobalMax::run()
+{
+  LatticeRealD x, y;
+  make_fields( x , y );
+
+  double h = -1.0e30;
+  for_all_sites( [&]( const multi1d<int>& c ) {
+      h = std::max( h , y_host(c) );
+    } );
+
+  assertion( close( toDouble( globalMax( y ) ) , h ) );
+}
+
+
+// conj(x + i y) * (y + i x) = 2 x y + i ( x^2 - y^2 )
+void
+testLocalInnerProduct::run()
+{
+  LatticeRealD x, y;
+  make_fields( x , y );
+
+  LatticeComplexD a = cmplx( x , y );
+  LatticeComplexD b = cmplx( y , x );
+
+  double h_re = 0, h_im = 0;
+  for_all_sites( [&]( const multi1d<int>& c ) {
+      if ( IrregularFunc()(c) == 1 ) {
+	h_re += 2 * x_host(c) * y_host(c);
+	h_im += x_host(c) * x_host(c) - y_host(c) * y_host(c);
+      }
+    } );
+
+  DComplex ip = innerProduct( a , b , irregular()[1] );
+  assertion( close( toDouble( real( ip ) ) , h_re ) );
+  assertion( close( toDouble( imag( ip ) ) , h_im ) );
+
+  DComplex lip = sum( localInnerProduct( a , b ) , irregular()[1] );
+  assertion( close( toDouble( real( lip ) ) , h_re ) );
+  assertion( close( toDouble( imag( lip ) ) , h_im ) );
+}
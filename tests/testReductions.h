@@ -0,0 +1,15 @@
+#ifndef TEST_REDUCTIONS_H
+#define TEST_REDUCTIONS_H
+
+#ifndef UNITTEST_H
+#include "unittest.h"
+#endif
+
+// Reductions on the device against values computed on the host
+class testSumSubset        : public TestFixture { public: void run(void); };
+class testSumExpr          : public TestFixture { public: void run(void); };
+class testSumMulti         : public TestFixture { public: void run(void); };
+class testGlobalMax        : public TestFixture { public: void run(void); };
+class testLocalInnerProduct: public TestFixture { public: void run(void); };
+
+#endif
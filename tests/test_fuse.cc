@@ -0,0 +1,27 @@
+#include "qdp.h"
+#include "unittest.h"
+#include "testvol.h"
+
+#include "testFuse.h"
+
+using namespace QDP;
+
+int main(int argc, char **argv)
+{
+  // Initialize UnitTest jig
+  TestRunner  tests(&argc, &argv, nrow_in);
+  QDPIO::cout << "Volume= { " << Layout::lattSize()[0]
+	      << " , " << Layout::lattSize()[1]
+	      << " , " << Layout::lattSize()[2]
+	      << " , " << Layout::lattSize()[3] << " } " << endl;
+
+  tests.addTest(new testFuseAll(), "testFuseAll" );
+  tests.addTest(new testFuseSubset(), "testFuseSubset" );
+  tests.addTest(new testFuseShift(), "testFuseShift" );
+
+  // Run all tests
+  tests.run();
+
+  // Testjig is destroyed
+  tests.summary();
+}
@@ -0,0 +1,30 @@
+#include "qdp.h"
+#include "unittest.h"
+#include "testvol.h"
+
+#include "testPoolAllocator.h"
+
+using namespace QDP;
+
+// The pool works on host memory here. Without a GPU run with
+// -llvm-target host.
+int main(int argc, char **argv)
+{
+  // Initialize UnitTest jig
+  TestRunner  tests(&argc, &argv, nrow_in);
+  QDPIO::cout << "Volume= { " << Layout::lattSize()[0]
+	      << " , " << Layout::lattSize()[1]
+	      << " , " << Layout::lattSize()[2]
+	      << " , " << Layout::lattSize()[3] << " } " << endl;
+
+  tests.addTest(new testPoolCoalesce(), "testPoolCoalesce" );
+  tests.addTest(new testPoolRandom(), "testPoolRandom" );
+  tests.addTest(new testPoolCompact(), "testPoolCompact" );
+  tests.addTest(new time_POOL_ALLOCATOR(), "time_POOL_ALLOCATOR" );
+
+  // Run all tests
+  tests.run();
+
+  // Testjig is destroyed
+  tests.summary();
+}
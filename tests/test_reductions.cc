@@ -0,0 +1,29 @@
+#include "qdp.h"
+#include "unittest.h"
+#include "testvol.h"
+
+#include "testReductions.h"
+
+using namespace QDP;
+
+int main(int argc, char **argv)
+{
+  // Initialize UnitTest jig
+  TestRunner  tests(&argc, &argv, nrow_in);
+  QDPIO::cout << "Volume= { " << Layout::lattSize()[0]
+	      << " , " << Layout::lattSize()[1]
+	      << " , " << Layout::lattSize()[2]
+	      << " , " << Layout::lattSize()[3] << " } " << endl;
+
+  tests.addTest(new testSumSubset(), "testSumSubset" );
+  tests.addTest(new testSumExpr(), "testSumExpr" );
+  tests.addTest(new testSumMulti(), "testSumMulti" );
+  tests.addTest(new testGlobalMax(), "testGlobalMax" );
+  tests.addTest(new testLocalInnerProduct(), "testLocalInnerProduct" );
+
+  // Run all tests
+  tests.run();
+
+  // Testjig is destroyed
+  tests.summary();
+}
@@ -0,0 +1,80 @@
+#include "unittest.h"
+#include <cmath>
+#include "timeChangeLayout.h"
+
+using namespace std;
+
+static double N_SECS=2;
+
+// Time OLattice<T>::changeLayout in both directions and report the
+// bandwidth (bytes read plus bytes written)
+template<class T>
+void
+time_CHANGE_LAYOUT<T>::run(void)
+{
+  typedef typename T::SubType_t P;
+
+  size_t bytes = Layout::sitesOnNode() * sizeof(P);
+
+  std::vector<char> hst( bytes );
+  std::vector<char> dev( bytes );
+  std::vector<char> back( bytes );
+
+  for (size_t i = 0 ; i < bytes ; ++i)
+    hst[i] = (char)(i * 7 + 3);
+
+  // Round trip must reproduce the data
+  T::changeLayout( true  , dev.data()  , hst.data() );
+  T::changeLayout( false , back.data() , dev.data() );
+  Assertions::assertion( hst == back );
+
+  QDPIO::cout << endl << "Timing changeLayout, GetLimit shape ("
+	      << GetLimit<P,2>::Limit_v << ","
+	      << GetLimit<P,1>::Limit_v << ","
+	      << GetLimit<P,0>::Limit_v << "), word size "
+	      << sizeof(typename WordType<P>::Type_t) << endl;
+
+  for (int toDev = 1 ; toDev >= 0 ; --toDev) {
+    StopWatch swatch;
+    double n_secs = N_SECS;
+    int iters=1;
+    double time=0;
+    do {
+      swatch.reset();
+      swatch.start();
+
+      for(int i=0; i < iters; i++) {
+	if (toDev)
+	  T::changeLayout( true , dev.data() , hst.data() );
+	else
+	  T::changeLayout( false , hst.data() , dev.data() );
+      }
+      swatch.stop();
+      time=swatch.getTimeInSeconds();
+
+      // Average time over nodes
+      QDPInternal::globalSum(time);
+      time /= (double)Layout::numNodes();
+
+      if (time < n_secs)
+	iters *=2;
+    }
+    while ( time < (double)n_secs );
+
+    double gbs = 2.0 * bytes * iters / time / 1.0e9;
+
+    QDPIO::cout << "\t to " << (toDev ? "device" : "host  ") << " layout: " << gbs << " GB/s" << endl;
+  }
+}
+
+
+template class time_CHANGE_LAYOUT< LatticeRealF >;
+template class time_CHANGE_LAYOUT< LatticeRealD >;
+template class time_CHANGE_LAYOUT< LatticeComplexF >;
+template class time_CHANGE_LAYOUT< LatticeComplexD >;
+template class time_CHANGE_LAYOUT< LatticeColorMatrixF >;
+template class time_CHANGE_LAYOUT< LatticeColorMatrixD >;
+template class time_CHANGE_LAYOUT< LatticeFermionF >;
+template class time_CHANGE_LAYOUT< LatticeFermionD >;
+template class time_CHANGE_LAYOUT< LatticePropagatorF >;
+template class time_CHANGE_LAYOUT< LatticePropagatorD >;
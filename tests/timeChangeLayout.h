@@ -0,0 +1,13 @@
+#ifndef TIME_CHANGE_LAYOUT
+#define TIME_CHANGE_LAYOUT
+
+
+#ifndef UNITTEST_H
+#include "unittest.h"
+#endif
+
+// Host <-> device layout conversion of one lattice type
+template<class T>
+class time_CHANGE_LAYOUT : public TestFixture { public: void run(void); };
+
+#endif
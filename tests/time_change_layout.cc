@@ -0,0 +1,33 @@
+#include "unittest.h"
+#include "testvol.h"
+
+#include <string>
+#include "timeChangeLayout.h"
+
+using namespace QDP;
+using namespace std;
+
+int main(int argc, char **argv)
+{
+  // Initialize UnitTest jig
+  TestRunner  tests(&argc, &argv, nrow_in);
+  QDPIO::cout << "Volume= { " << Layout::lattSize()[0]
+	      << " , " << Layout::lattSize()[1]
+	      << " , " << Layout::lattSize()[2]
+	      << " , " << Layout::lattSize()[3] << " } " << endl;
+
+  tests.addTest(new time_CHANGE_LAYOUT< LatticeRealF >(),        "time_CHANGE_LAYOUT_RealF" );
+  tests.addTest(new time_CHANGE_LAYOUT< LatticeRealD >(),        "time_CHANGE_LAYOUT_RealD" );
+  tests.addTest(new time_CHANGE_LAYOUT< LatticeComplexF >(),     "time_CHANGE_LAYOUT_ComplexF" );
+  tests.addTest(new time_CHANGE_LAYOUT< LatticeComplexD >(),     "time_CHANGE_LAYOUT_ComplexD" );
+  tests.addTest(new time_CHANGE_LAYOUT< LatticeColorMatrixF >(), "time_CHANGE_LAYOUT_ColorMatrixF" );
+  tests.addTest(new time_CHANGE_LAYOUT< LatticeColorMatrixD >(), "time_CHANGE_LAYOUT_ColorMatrixD" );
+  tests.addTest(new time_CHANGE_LAYOUT< LatticeFermionF >(),     "time_CHANGE_LAYOUT_FermionF" );
+  tests.addTest(new time_CHANGE_LAYOUT< LatticeFermionD >(),     "time_CHANGE_LAYOUT_FermionD" );
+  tests.addTest(new time_CHANGE_LAYOUT< LatticePropagatorF >(),  "time_CHANGE_LAYOUT_PropagatorF" );
+  tests.addTest(new time_CHANGE_LAYOUT< LatticePropagatorD >(),  "time_CHANGE_LAYOUT_PropagatorD" );
+
+  tests.run();
+  // Testjig is destroyed
+  tests.summary();
+}